@@ -13,21 +13,28 @@ class HIRScheduler : Scheduler {
 public:
   HIRScheduler(mlir::func::FuncOp funcOp, llvm::raw_ostream &logger);
   int64_t getPortNumForMemoryOp(mlir::Operation *);
+  /// Returns the shared instance of the operator that implements this op, or
+  /// None if the op gets its own instance.
+  llvm::Optional<int64_t> getOperatorInstance(mlir::Operation *);
   mlir::LogicalResult init();
   using Scheduler::getTimeOffset;
 
 private:
   using Scheduler::logger;
+  mlir::LogicalResult checkOperatorII();
   mlir::LogicalResult insertMemAccessConstraints();
   mlir::LogicalResult insertMemoryDependence(MemOpInfo src, MemOpInfo dest);
   mlir::LogicalResult insertPortConflict(MemOpInfo src, MemOpInfo dest);
   mlir::LogicalResult insertSSADependencies();
+  mlir::LogicalResult insertOperatorConflicts();
   [[nodiscard]] MemPortResource *getOrAddRdPortResource(mlir::Value);
   [[nodiscard]] MemPortResource *getOrAddWrPortResource(mlir::Value);
   mlir::func::FuncOp funcOp;
   llvm::DenseMap<mlir::Value, MemPortResource *> mapMemref2RdPortResource;
   llvm::DenseMap<mlir::Value, MemPortResource *> mapMemref2WrPortResource;
   llvm::SmallVector<MemPortResource> portResources;
+  llvm::DenseMap<mlir::Operation *, OperatorResource *> mapOp2OperatorResource;
+  llvm::SmallVector<std::unique_ptr<OperatorResource>> operatorResources;
 };
 
 #endif
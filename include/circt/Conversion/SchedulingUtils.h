@@ -78,6 +78,9 @@ struct MemOpInfo : OpInfo {
 struct ArithOpInfo : OpInfo {
   ArithOpInfo(mlir::Operation *operation);
   ~ArithOpInfo() override {}
+  /// Ops that are lowered to comb ops. Others must be replaced by calls to the
+  /// operator library before scheduling.
+  static bool isSupported(mlir::Operation *operation);
   int64_t getDelay() override;
   bool isConstant() override;
 
@@ -201,11 +204,23 @@ struct MemPortResource : public Resource {
   size_t numPorts;
 };
 
+/// A limited number of instances of an operator (a module from the operator
+/// library) shared by all the ops of that kind.
+struct OperatorResource : public Resource {
+  OperatorResource(llvm::StringRef name, size_t numInstances)
+      : name(name), numInstances(numInstances) {}
+  virtual size_t getNumResources() override { return numInstances; }
+  virtual ~OperatorResource() override {}
+
+  std::string name;
+  size_t numInstances;
+};
+
 /// This struct captures the information about two resource-conflicting
 /// operations.
 struct Conflict {
   Conflict(mlir::Operation *op1, mlir::Operation *op2, int64_t commonII,
-           Resource *resource, int64_t depDelay)
+           Resource *resource, llvm::Optional<int64_t> depDelay)
       : op1(op1), op2(op2), commonII(commonII), resource(resource),
         depDelay(depDelay) {
 
@@ -224,8 +239,9 @@ struct Conflict {
   const int64_t commonII;
   Resource *const resource;
   /// The required delay if we assume that there is a true dependence from op1
-  /// to op2.
-  int64_t depDelay;
+  /// to op2. None if the conflict can only be avoided by using different
+  /// resources or different cycles modulo commonII.
+  llvm::Optional<int64_t> depDelay;
 };
 
 ///  This class calculates the final schedule while minimizing the required
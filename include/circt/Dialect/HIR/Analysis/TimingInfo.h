@@ -18,11 +18,23 @@ namespace hir {
 /// This class maintains the mapping between equivalent time variables.
 /// It is used to find alternate timevars which are equivalent but require
 /// smaller offset (and thus less shift registers).
+///
+/// Equivalent time vars form a forest. Every time var points directly to the
+/// root of its tree along with its offset from the root (if t2 = t1 + 10 and
+/// t1 = t0 + 5 then t2 -> (t0, 15)). Each root keeps its members sorted by
+/// offset, so a query is a binary search instead of a scan over all the
+/// equivalent time vars.
 class EquivalentTimeMap {
-  /// If t2 = t1+10 then this maps t1 -> 10,t2) so that if we find t1+11
-  /// somewhere, we can search for t1 and get t2+1 == t1+11.
-  DenseMap<Value, SmallVector<std::pair<int64_t, Value>>>
-      mapTimeVarToOffsetAndEquivalentTimeVar;
+  struct Member {
+    int64_t offset;
+    unsigned int lexicalOrder;
+    Value timeVar;
+  };
+
+  /// Maps a non-root time var to its root and its offset from the root.
+  DenseMap<Value, std::pair<Value, int64_t>> mapTimeVarToRootAndOffset;
+  /// Members of each tree sorted by (offset, lexical order).
+  DenseMap<Value, SmallVector<Member>> mapRootToSortedMembers;
 
   llvm::DenseMap<ScheduledOp, unsigned int> &mapOpToLexicalOrder;
   unsigned int getLexicalOrder(ScheduledOp);
@@ -33,6 +45,9 @@ public:
       llvm::DenseMap<ScheduledOp, unsigned int> &mapOpToLexicalOrder)
       : mapOpToLexicalOrder(mapOpToLexicalOrder) {}
   void registerEquivalentTime(Value timeVar, Time time);
+  /// Get the root of the tree containing timeVar and the offset of timeVar
+  /// from the root.
+  std::pair<Value, int64_t> getRootAndOffset(Value timeVar);
   /// Get an equivalent time with smaller offset.
   Time getEquivalentTimeWithSmallerOffset(ScheduledOp);
 };
@@ -43,15 +58,30 @@ public:
 ///   from another time-var).
 ///   - Mapping from a Value to a time instant. The value is valid at that time
 ///   instant.
+///
+/// TimingInfo is an MLIR analysis, so passes should query it with
+/// getAnalysis<TimingInfo>() and share the cached result instead of rebuilding
+/// it.
 class TimingInfo {
 public:
   TimingInfo(FuncOp);
+  TimingInfo(Operation *operation) : TimingInfo(cast<FuncOp>(operation)) {}
+  TimingInfo(const TimingInfo &) = delete;
+  TimingInfo &operator=(const TimingInfo &) = delete;
   bool isValidAtTime(Value v, hir::Time time);
   bool isAlwaysValid(Value);
-  Time getTime(Value);
+  /// Time at which the value is valid, or None if it is not known.
+  Optional<Time> getTime(Value);
   /// Get a new timevar based time which is equivalent to original time but has
   /// smaller offset (and thus requires less shift registers to implement).
   Time getOptimizedTime(hir::ScheduledOp);
+  /// Express the time relative to the root time var it is derived from. Two
+  /// times are comparable only if they have the same root.
+  Time getRootTime(Time);
+  /// Like getRootTime, but the region time vars of hir.if ops are replaced by
+  /// the start time of the if. This is only for verification. Ops must not be
+  /// retimed onto it, since the if regions are gated by the condition.
+  Time getUngatedRootTime(Time);
 
 private:
   void registerValue(Value, Time);
@@ -62,6 +92,8 @@ private:
 
 private:
   llvm::DenseMap<Value, hir::Time> mapValueToTime;
+  /// Start time of the hir.if that owns each region time var.
+  llvm::DenseMap<Value, hir::Time> mapRegionTimeVarToTime;
   llvm::SmallDenseSet<Value> setOfConstants;
   EquivalentTimeMap equivalentTimeMap;
   llvm::DenseMap<ScheduledOp, unsigned int> mapOpToLexicalOrder;
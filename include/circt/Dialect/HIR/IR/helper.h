@@ -18,6 +18,8 @@ unsigned clog2(int);
 
 bool isBuiltinSizedType(mlir::Type);
 bool isBusLikeType(mlir::Type);
+/// Bus-like types and fifos. Func args of these types carry hir.bus.ports.
+bool isChannelType(mlir::Type);
 llvm::Optional<int64_t> getConstantIntValue(mlir::Value var);
 mlir::LogicalResult isConstantIntValue(mlir::Value var);
 mlir::IntegerAttr getI64IntegerAttr(mlir::MLIRContext *context, int value);
@@ -42,6 +44,9 @@ llvm::Optional<int64_t> calcLinearIndex(mlir::ArrayRef<mlir::Value> indices,
                                         mlir::ArrayRef<int64_t> dims);
 
 llvm::Optional<int64_t> getHIRDelayAttr(mlir::DictionaryAttr dict);
+/// Index of the !hir.time result that a dynamic-latency result's delay is
+/// counted from. None if the delay is counted from the call's start time.
+llvm::Optional<int64_t> getHIRDelayFromAttr(mlir::DictionaryAttr dict);
 mlir::arith::ConstantOp emitConstantOp(mlir::OpBuilder &builder, int64_t value);
 llvm::Optional<mlir::ArrayAttr>
 extractMemrefPortsFromDict(mlir::DictionaryAttr dict);
@@ -50,6 +55,16 @@ llvm::Optional<int64_t> getMemrefPortRdLatency(mlir::Attribute port);
 llvm::Optional<int64_t> getMemrefPortWrLatency(mlir::Attribute port);
 bool isMemrefWrPort(mlir::Attribute port);
 bool isMemrefRdPort(mlir::Attribute port);
+/// Read and write latencies of a memref port such as {rd_latency = 1}. Decode
+/// the ports of a memref once instead of querying the port dict repeatedly.
+struct MemrefPortInfo {
+  llvm::Optional<int64_t> rdLatency;
+  llvm::Optional<int64_t> wrLatency;
+  bool isRdPort() const { return rdLatency.hasValue(); }
+  bool isWrPort() const { return wrLatency.hasValue(); }
+};
+MemrefPortInfo getMemrefPortInfo(mlir::Attribute port);
+llvm::SmallVector<MemrefPortInfo> getMemrefPortInfos(mlir::ArrayAttr ports);
 llvm::StringRef extractBusPortFromDict(mlir::DictionaryAttr dict);
 llvm::StringRef getInlineAttrName();
 void eraseOps(mlir::SmallVectorImpl<mlir::Operation *> &opsToErase);
@@ -62,6 +77,8 @@ llvm::Optional<mlir::StringRef> getOptionalName(mlir::Operation *operation,
                                                 int64_t resultNum);
 llvm::Optional<mlir::StringRef> getOptionalName(mlir::Value v);
 llvm::Optional<circt::Type> getElementType(circt::Type);
+/// Inserts the declaration into the parent ModuleOp. Only call this from passes
+/// anchored on the ModuleOp, never from a pass that runs per function.
 circt::Operation *
 declareExternalFuncForCall(circt::hir::CallOp callOp,
                            llvm::StringRef verilogName,
@@ -84,5 +101,20 @@ mlir::LogicalResult
 validatePositiveConstant(mlir::ArrayRef<mlir::Value> indices);
 mlir::Value emitIntegerBusOp(mlir::OpBuilder &builder, int64_t width);
 llvm::Optional<int64_t> getOptionalTimeOffset(mlir::Operation *);
+/// Returns the offset of (timeVar + offset) from base, if timeVar is derived
+/// from base through a chain of hir.time ops.
+llvm::Optional<int64_t> getTimeOffsetFrom(mlir::Value timeVar, int64_t offset,
+                                          mlir::Value base);
+/// Splits an index into base + constant offset. The offset is 0 if idx is not
+/// a comb.add or comb.sub with a constant operand.
+std::pair<mlir::Value, int64_t> splitConstantOffset(mlir::Value idx);
+/// Cycles from the start of the loop to its t_end, if the loop has constant
+/// bounds and a fixed II.
+llvm::Optional<int64_t> getStaticLatency(circt::hir::ForOp forOp);
+/// Passes `extraArgs` into the loop through iter_args that are carried
+/// unchanged, and replaces their uses inside the loop. Returns the new loop.
+circt::hir::ForOp
+addLoopInvariantIterArgs(circt::hir::ForOp forOp,
+                         mlir::ArrayRef<mlir::Value> extraArgs, int64_t ii);
 } // namespace helper
 #endif
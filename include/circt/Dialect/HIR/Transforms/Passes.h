@@ -24,7 +24,18 @@ std::unique_ptr<OperationPass<hir::FuncOp>> createSimplifyCtrlPass();
 std::unique_ptr<OperationPass<mlir::ModuleOp>> createMemrefLoweringPass();
 std::unique_ptr<OperationPass<hir::FuncOp>> createVerifySchedulePass();
 std::unique_ptr<OperationPass<hir::FuncOp>> createLoopUnrollPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createLoopFlattenPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createStencilWindowPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createWidenMemrefPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createDoubleBufferPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createOverlapLoopNestPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createSpeculateWhilePass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createInstrumentProfilePass();
+std::unique_ptr<OperationPass<mlir::ModuleOp>> createAnnotateProfilePass();
 std::unique_ptr<OperationPass<hir::FuncOp>> createOpFusionPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createMemoryMappingPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createIfConversionPass();
+std::unique_ptr<OperationPass<hir::FuncOp>> createScalarReplacementPass();
 
 void registerPassPipelines();
 void initHIRTransformationPasses();
@@ -23,6 +23,7 @@ namespace hw {
 
 std::unique_ptr<mlir::Pass> createPrintInstanceGraphPass();
 std::unique_ptr<mlir::Pass> createHWSpecializePass();
+std::unique_ptr<mlir::Pass> createHWDedupPass();
 
 /// Generate the code for registering passes.
 #define GEN_PASS_REGISTRATION
@@ -23,6 +23,7 @@ std::unique_ptr<mlir::Pass> createPrettifyVerilogPass();
 std::unique_ptr<mlir::Pass> createHWCleanupPass();
 std::unique_ptr<mlir::Pass> createHWStubExternalModulesPass();
 std::unique_ptr<mlir::Pass> createHWLegalizeModulesPass();
+std::unique_ptr<mlir::Pass> createHWRegisterFanoutPass();
 std::unique_ptr<mlir::Pass> createHWGeneratorCalloutPass();
 std::unique_ptr<mlir::Pass>
 createHWMemSimImplPass(bool replSeqMem = false,
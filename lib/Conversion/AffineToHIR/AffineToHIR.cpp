@@ -257,9 +257,13 @@ LogicalResult AffineToHIRImpl::visitOp(mlir::func::FuncOp op) {
 
   argNames.push_back(builder.getStringAttr("t"));
   if (op.isDeclaration()) {
-    builder.create<hir::FuncExternOp>(op->getLoc(), op.getSymName(), funcTy,
-                                      builder.getArrayAttr(argNames),
-                                      resultNamesAttr);
+    auto funcExternOp = builder.create<hir::FuncExternOp>(
+        op->getLoc(), op.getSymName(), funcTy, builder.getArrayAttr(argNames),
+        resultNamesAttr);
+    // Keep the operator library info for scheduling and resource estimation.
+    for (auto attrName : {"hir.ii", "hir.resource_cost"})
+      if (auto attr = op->getAttr(attrName))
+        funcExternOp->setAttr(attrName, attr);
     return success();
   }
 
@@ -481,6 +485,8 @@ MemKindEnumAttr toMemKindAttr(StringAttr memKindStrAttr) {
   if (str == "lutram")
     return MemKindEnumAttr::get(memKindStrAttr.getContext(),
                                 MemKindEnum::lutram);
+  if (str == "uram")
+    return MemKindEnumAttr::get(memKindStrAttr.getContext(), MemKindEnum::uram);
   assert(false);
 }
 
@@ -532,7 +538,14 @@ LogicalResult AffineToHIRImpl::visitOp(mlir::func::CallOp op) {
     operands.push_back(hirOperand.getValue());
   }
   StringAttr instanceName;
-  if (op->hasAttrOfType<StringAttr>("instance_name"))
+  // Calls bound to the same operator instance by the scheduler get the same
+  // instance name. hir-to-hw emits one hw.instance for them and muxes the
+  // inputs.
+  if (auto sharedInstance = scheduler->getOperatorInstance(op))
+    instanceName =
+        builder.getStringAttr(op.getCalleeAttr().getValue() + "_shared" +
+                              std::to_string(*sharedInstance));
+  else if (op->hasAttrOfType<StringAttr>("instance_name"))
     instanceName = builder.getStringAttr(
         op->getAttrOfType<StringAttr>("instance_name").str() + "_inst" +
         std::to_string(this->instNum++));
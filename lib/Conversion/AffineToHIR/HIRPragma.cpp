@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "../PassDetail.h"
+#include "OperatorLibrary.h"
 #include "circt/Conversion/HIRPragma.h"
 #include "circt/Dialect/Comb/CombOps.h"
 #include "circt/Dialect/HIR/IR/HIR.h"
@@ -17,8 +18,10 @@
 #include "circt/Scheduling/Problems.h"
 #include "mlir/Dialect/Affine/Analysis/AffineAnalysis.h"
 #include "mlir/Dialect/Affine/Analysis/AffineStructures.h"
+#include "mlir/Dialect/Affine/Analysis/LoopAnalysis.h"
 #include "mlir/Dialect/Affine/IR/AffineMemoryOpInterfaces.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Affine/LoopUtils.h"
 #include "mlir/Dialect/Arithmetic/IR/Arithmetic.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
@@ -39,6 +42,14 @@
 
 using namespace circt;
 namespace {
+/// An accumulation `acc = acc op x` through a one element memref in the body
+/// of a loop.
+struct Reduction {
+  mlir::AffineLoadOp loadOp;
+  Operation *combineOp;
+  mlir::AffineStoreOp storeOp;
+};
+
 struct HIRPragma : public HIRPragmaBase<HIRPragma> {
   void runOnOperation() override;
 
@@ -51,7 +62,11 @@ private:
   LogicalResult visitOp(mlir::func::CallOp);
   LogicalResult visitOp(mlir::arith::NegFOp);
   LogicalResult visitOp(mlir::LLVM::UndefOp);
-  LogicalResult visitArithFOp(Operation *operation);
+  LogicalResult visitArithOp(Operation *operation);
+  LogicalResult visitArithOp(Operation *operation, const OperatorImpl &impl);
+  LogicalResult setOperatorLimits(mlir::func::FuncOp);
+  LogicalResult splitReductions(mlir::AffineForOp);
+  Optional<int64_t> getLatency(Operation *operation);
   Optional<int> selectRdPort(Value mem);
   Optional<int> selectWrPort(Value mem);
   void safelyEraseOps();
@@ -60,6 +75,7 @@ private:
   SmallVector<Operation *> toErase;
   llvm::DenseMap<Value, int> mapMemref2PrevUsedRdPort;
   llvm::DenseMap<Value, int> mapMemref2PrevUsedWrPort;
+  OperatorLibrary library;
 };
 
 } // namespace
@@ -150,6 +166,11 @@ void HIRPragma::runOnOperation() {
   OpBuilder builder(&moduleOp.getBodyRegion());
   moduleOp->setAttrs(builder.getDictionaryAttr(
       builder.getNamedAttr("hir.hls", builder.getUnitAttr())));
+  if (!operatorLibrary.empty() &&
+      failed(library.load(operatorLibrary, moduleOp.getLoc()))) {
+    signalPassFailure();
+    return;
+  }
 
   std::list<mlir::func::FuncOp> hwAccelOps;
   // Hoist all declarations and put the hw functions in a set.
@@ -218,7 +239,7 @@ void HIRPragma::runOnOperation() {
             WalkResult::advance();
           } else if (isa<mlir::arith::ArithmeticDialect>(
                          operation->getDialect())) {
-            if (failed(visitArithFOp(operation)))
+            if (failed(visitArithOp(operation)))
               return WalkResult::interrupt();
           } else if (isa<mlir::scf::ForOp, mlir::scf::IfOp, mlir::scf::WhileOp,
                          mlir::memref::LoadOp, mlir::memref::StoreOp>(
@@ -398,6 +419,264 @@ LogicalResult HIRPragma::visitOp(mlir::func::FuncOp op) {
     op->setAttr("res_attrs", *newResultAttr);
   else if (op.isDeclaration() && op.getNumResults() > 0 && !*newResultAttr)
     return op->emitError("Could not find res_attrs.");
+  if (op.isDeclaration())
+    return success();
+  if (failed(setOperatorLimits(op)))
+    return failure();
+  if (!splitReductionLoops)
+    return success();
+  // Only innermost loops are unrolled.
+  SmallVector<mlir::AffineForOp> loops;
+  op.walk([&loops](mlir::AffineForOp forOp) {
+    if (forOp.getBody()->getOps<mlir::AffineForOp>().empty())
+      loops.push_back(forOp);
+  });
+  for (auto forOp : loops)
+    if (failed(splitReductions(forOp)))
+      return failure();
+  return success();
+}
+
+/// The scheduler shares the modules listed in `hir.operator_limits` between the
+/// calls to them. The limits come from the `hls.ALLOCATION` dictionary of the
+/// function and from the operator-limits option.
+LogicalResult HIRPragma::setOperatorLimits(mlir::func::FuncOp op) {
+  Builder builder(op);
+  NamedAttrList limits;
+  if (auto allocation = op->getAttrOfType<DictionaryAttr>("hls.ALLOCATION")) {
+    limits.append(allocation.getValue());
+    op->removeAttr("hls.ALLOCATION");
+  }
+  for (auto &limit : operatorLimits) {
+    auto nameAndCount = StringRef(limit).rsplit(':');
+    int64_t count;
+    if (nameAndCount.second.empty() ||
+        nameAndCount.second.getAsInteger(10, count))
+      return op->emitError("Expected <module>:<count> in operator-limits but "
+                           "found '")
+             << limit << "'.";
+    limits.set(nameAndCount.first, builder.getI64IntegerAttr(count));
+  }
+  if (!limits.empty())
+    op->setAttr("hir.operator_limits",
+                limits.getDictionary(op->getContext()));
+  return success();
+}
+
+/// Name of the module that implements a float op without an entry in the
+/// operator library, or an empty string for other ops.
+static std::string getFloatModuleName(Operation *operation) {
+  std::string typeStr =
+      "f" +
+      std::to_string(operation->getResult(0).getType().getIntOrFloatBitWidth());
+  if (isa<mlir::arith::AddFOp>(operation))
+    return "add_" + typeStr;
+  if (isa<mlir::arith::SubFOp>(operation))
+    return "sub_" + typeStr;
+  if (isa<mlir::arith::MulFOp>(operation))
+    return "mul_" + typeStr;
+  if (isa<mlir::arith::DivFOp>(operation))
+    return "div_" + typeStr;
+  return "";
+}
+
+/// Identity of an associative and commutative op, or a null attr if the op can
+/// not be reassociated.
+static Attribute getIdentity(Operation *operation) {
+  Builder builder(operation->getContext());
+  auto ty = operation->getResult(0).getType();
+  if (isa<mlir::arith::AddFOp>(operation))
+    return builder.getFloatAttr(ty, 0.0);
+  if (isa<mlir::arith::MulFOp>(operation))
+    return builder.getFloatAttr(ty, 1.0);
+  if (isa<mlir::arith::AddIOp>(operation))
+    return builder.getIntegerAttr(ty, 0);
+  if (isa<mlir::arith::MulIOp>(operation))
+    return builder.getIntegerAttr(ty, 1);
+  return Attribute();
+}
+
+static SmallVector<Reduction> findReductions(mlir::AffineForOp op) {
+  SmallVector<Reduction> reductions;
+  for (auto storeOp : op.getBody()->getOps<mlir::AffineStoreOp>()) {
+    auto mem = storeOp.getMemRef();
+    auto allocaOp = mem.getDefiningOp<mlir::memref::AllocaOp>();
+    if (!allocaOp || allocaOp.getType().getNumElements() != 1 ||
+        !storeOp.getMapOperands().empty())
+      continue;
+    auto *combineOp = storeOp.getValueToStore().getDefiningOp();
+    if (!combineOp || combineOp->getBlock() != op.getBody() ||
+        !getIdentity(combineOp) || !combineOp->hasOneUse())
+      continue;
+    mlir::AffineLoadOp loadOp;
+    for (auto operand : combineOp->getOperands())
+      if (auto acc = operand.getDefiningOp<mlir::AffineLoadOp>())
+        if (acc.getMemRef() == mem)
+          loadOp = acc;
+    if (!loadOp || loadOp->getBlock() != op.getBody() || !loadOp->hasOneUse() ||
+        !loadOp.getMapOperands().empty())
+      continue;
+    // The loop must not access the accumulator anywhere else.
+    if (llvm::any_of(mem.getUsers(), [&](Operation *user) {
+          return op->isAncestor(user) && user != loadOp && user != storeOp;
+        }))
+      continue;
+    reductions.push_back({loadOp, combineOp, storeOp});
+  }
+  return reductions;
+}
+
+/// Folds the affine.apply ops that unrolling creates for the induction variable
+/// into the map of the access, since affine-to-hir does not lower them.
+template <typename AffineMemOpTy>
+static void composeAccessMap(AffineMemOpTy op) {
+  AffineMap map = op.getAffineMap();
+  SmallVector<Value> operands(op.getMapOperands());
+  mlir::fullyComposeAffineMapAndOperands(&map, &operands);
+  mlir::canonicalizeMapAndOperands(&map, &operands);
+  op->setAttr(AffineMemOpTy::getMapAttrName(), AffineMapAttr::get(map));
+  op->setOperands(op.getMemRefOperandIndex() + 1, op.getMapOperands().size(),
+                  operands);
+}
+
+/// Latency of the module that the op is lowered to. Integer ops without an
+/// entry in the operator library become combinational comb ops.
+Optional<int64_t> HIRPragma::getLatency(Operation *operation) {
+  if (auto impl = library.lookup(operation))
+    return impl->latency;
+  if (isa<mlir::arith::AddIOp, mlir::arith::MulIOp>(operation))
+    return 0;
+  auto opName = getFloatModuleName(operation);
+  if (opName.empty())
+    return llvm::None;
+  auto funcDecl = dyn_cast_or_null<mlir::func::FuncOp>(
+      getOperation().lookupSymbol(opName));
+  if (!funcDecl)
+    return llvm::None;
+  auto resAttrs = funcDecl->getAttrOfType<ArrayAttr>("res_attrs");
+  if (!resAttrs || resAttrs.size() != 1)
+    return llvm::None;
+  return helper::getHIRDelayAttr(resAttrs[0].dyn_cast<DictionaryAttr>());
+}
+
+/// Splits the reductions of a pipelined loop over partial accumulators, so that
+/// the loop carried dependence through the accumulator does not limit the II.
+/// The accumulator register is read in the same cycle and written one cycle
+/// after the op finishes, so an accumulation needs latency + 1 cycles. The
+/// loop is unrolled by K = ceil((latency + 1) / II), each copy of the body
+/// accumulates into its own partial accumulator and the II is multiplied by K,
+/// which keeps the throughput and the memory port usage of the loop. The
+/// partial accumulators are combined by a tree of the same op after the loop.
+LogicalResult HIRPragma::splitReductions(mlir::AffineForOp op) {
+  auto iiAttr = op->getAttrOfType<IntegerAttr>("hls.PIPELINE_II");
+  auto tripCount = mlir::getConstantTripCount(op);
+  auto reductions = findReductions(op);
+  if (!iiAttr || !tripCount || reductions.empty())
+    return success();
+  // The unrolled copies of the induction variable must fold into the accesses.
+  if (!llvm::all_of(op.getInductionVar().getUsers(), [](Operation *user) {
+        return isa<mlir::AffineLoadOp, mlir::AffineStoreOp>(user);
+      }))
+    return success();
+
+  int64_t const ii = iiAttr.getInt();
+  uint64_t numPartials = 1;
+  for (auto &reduction : reductions) {
+    auto latency = getLatency(reduction.combineOp);
+    if (!latency)
+      continue;
+    numPartials = std::max(numPartials, (uint64_t)((*latency + ii) / ii));
+  }
+  if (numPartials <= 1)
+    return success();
+
+  // A factor that divides the trip count leaves no cleanup loop with the
+  // serial dependence.
+  while (*tripCount % numPartials)
+    numPartials++;
+  if (numPartials >= *tripCount) {
+    op.emitRemark("Could not split the reduction of this loop without fully "
+                  "unrolling it.");
+    return success();
+  }
+
+  OpBuilder builder(op);
+  SmallVector<SmallVector<Value>> partials;
+  for (auto &reduction : reductions) {
+    auto acc = reduction.loadOp.getMemRef();
+    auto allocaOp = acc.getDefiningOp<mlir::memref::AllocaOp>();
+    builder.setInsertionPoint(op);
+    Value identity = builder.create<mlir::arith::ConstantOp>(
+        op.getLoc(), getIdentity(reduction.combineOp));
+    SmallVector<Value> mems = {acc};
+    for (size_t i = 1; i < numPartials; i++) {
+      builder.setInsertionPoint(allocaOp);
+      Value mem = builder.clone(*allocaOp)->getResult(0);
+      builder.setInsertionPoint(op);
+      auto *initOp = builder.clone(*reduction.storeOp);
+      initOp->setOperand(0, identity);
+      initOp->setOperand(reduction.storeOp.getMemRefOperandIndex(), mem);
+      mems.push_back(mem);
+    }
+    partials.push_back(mems);
+  }
+
+  if (failed(mlir::loopUnrollByFactor(op, numPartials)))
+    return op.emitError("Could not unroll the loop to split its reduction.");
+  op->setAttr("hls.PIPELINE_II",
+              builder.getI64IntegerAttr(ii * (int64_t)numPartials));
+  for (auto applyOp : llvm::make_early_inc_range(
+           op.getBody()->getOps<mlir::AffineApplyOp>())) {
+    for (auto *user : llvm::make_early_inc_range(applyOp->getUsers())) {
+      if (auto loadOp = dyn_cast<mlir::AffineLoadOp>(user))
+        composeAccessMap(loadOp);
+      else
+        composeAccessMap(cast<mlir::AffineStoreOp>(user));
+    }
+    applyOp.erase();
+  }
+
+  // The i-th copy of the body accumulates into the i-th partial accumulator.
+  for (size_t r = 0; r < reductions.size(); r++) {
+    auto acc = partials[r][0];
+    size_t loadNum = 0;
+    size_t storeNum = 0;
+    for (auto &operation : *op.getBody()) {
+      if (auto loadOp = dyn_cast<mlir::AffineLoadOp>(operation)) {
+        if (loadOp.getMemRef() == acc)
+          loadOp->setOperand(loadOp.getMemRefOperandIndex(),
+                             partials[r][loadNum++]);
+      } else if (auto storeOp = dyn_cast<mlir::AffineStoreOp>(operation)) {
+        if (storeOp.getMemRef() == acc)
+          storeOp->setOperand(storeOp.getMemRefOperandIndex(),
+                              partials[r][storeNum++]);
+      }
+    }
+  }
+
+  builder.setInsertionPointAfter(op);
+  for (size_t r = 0; r < reductions.size(); r++) {
+    auto &reduction = reductions[r];
+    SmallVector<Value> values;
+    for (auto mem : partials[r]) {
+      auto *loadOp = builder.clone(*reduction.loadOp);
+      loadOp->setOperand(reduction.loadOp.getMemRefOperandIndex(), mem);
+      values.push_back(loadOp->getResult(0));
+    }
+    while (values.size() > 1) {
+      SmallVector<Value> nextValues;
+      for (size_t i = 0; i + 1 < values.size(); i += 2) {
+        auto *combineOp = builder.clone(*reduction.combineOp);
+        combineOp->setOperands({values[i], values[i + 1]});
+        nextValues.push_back(combineOp->getResult(0));
+      }
+      if (values.size() % 2)
+        nextValues.push_back(values.back());
+      values = nextValues;
+    }
+    auto *storeOp = builder.clone(*reduction.storeOp);
+    storeOp->setOperand(0, values[0]);
+  }
   return success();
 }
 
@@ -511,6 +790,8 @@ LogicalResult HIRPragma::visitOp(mlir::func::CallOp op) {
 }
 
 LogicalResult HIRPragma::visitOp(mlir::arith::NegFOp op) {
+  if (auto impl = library.lookup(op))
+    return visitArithOp(op, *impl);
   OpBuilder builder(op);
   builder.setInsertionPoint(op->getParentOfType<mlir::func::FuncOp>());
   auto funcOp = builder.create<mlir::func::FuncOp>(
@@ -547,24 +828,76 @@ LogicalResult HIRPragma::visitOp(mlir::LLVM::UndefOp op) {
   return success();
 }
 
-LogicalResult HIRPragma::visitArithFOp(Operation *operation) {
+/// Replaces the op with a call to the module that implements it in the
+/// operator library. The decl of the module is created on first use.
+LogicalResult HIRPragma::visitArithOp(Operation *operation,
+                                      const OperatorImpl &impl) {
+  auto funcTy = FunctionType::get(operation->getContext(),
+                                  operation->getOperandTypes(),
+                                  operation->getResultTypes());
+  auto funcDecl = dyn_cast_or_null<mlir::func::FuncOp>(
+      getOperation().lookupSymbol(impl.moduleName));
+  if (funcDecl && funcDecl.getFunctionType() != funcTy)
+    return operation->emitError("Type of ")
+           << impl.moduleName
+           << " in the operator library does not match this op.";
+
+  OpBuilder builder(operation);
+  if (!funcDecl) {
+    builder.setInsertionPoint(operation->getParentOfType<mlir::func::FuncOp>());
+    funcDecl = builder.create<mlir::func::FuncOp>(builder.getUnknownLoc(),
+                                                  impl.moduleName, funcTy);
+    funcDecl.setPrivate();
+    funcDecl->setAttr("hwAccel", builder.getUnitAttr());
+
+    auto zeroDelayAttr = builder.getDictionaryAttr(
+        builder.getNamedAttr("hir.delay", builder.getI64IntegerAttr(0)));
+    auto latencyAttr = builder.getDictionaryAttr(builder.getNamedAttr(
+        "hir.delay", builder.getI64IntegerAttr(impl.latency)));
+    SmallVector<Attribute> argAttrs(operation->getNumOperands(),
+                                    zeroDelayAttr);
+    SmallVector<Attribute> argNames;
+    for (size_t i = 0; i < operation->getNumOperands(); i++)
+      argNames.push_back(builder.getStringAttr(std::string(1, 'a' + i)));
+    funcDecl->setAttr("arg_attrs", builder.getArrayAttr(argAttrs));
+    funcDecl->setAttr("res_attrs", builder.getArrayAttr(latencyAttr));
+    funcDecl->setAttr("argNames", builder.getArrayAttr(argNames));
+    funcDecl->setAttr("resultNames", builder.getStrArrayAttr({"out"}));
+
+    // Used by the scheduler to keep loops from issuing the op faster than the
+    // module accepts new inputs.
+    funcDecl->setAttr("hir.ii", builder.getI64IntegerAttr(impl.ii));
+    SmallVector<NamedAttribute> cost;
+    for (auto &kv : impl.cost)
+      cost.push_back(builder.getNamedAttr(
+          kv.getKey(), builder.getI64IntegerAttr(kv.getValue())));
+    funcDecl->setAttr("hir.resource_cost", builder.getDictionaryAttr(cost));
+    builder.setInsertionPoint(operation);
+  }
+
+  auto callOp = builder.create<mlir::func::CallOp>(
+      operation->getLoc(), funcDecl, operation->getOperands());
+  operation->replaceAllUsesWith(callOp);
+  if (failed(visitOp(callOp)))
+    return failure();
+  toErase.push_back(operation);
+  return success();
+}
+
+LogicalResult HIRPragma::visitArithOp(Operation *operation) {
   assert(operation->getNumResults() == 1);
+  if (auto impl = library.lookup(operation))
+    return visitArithOp(operation, *impl);
 
-  std::string opName;
-  std::string typeStr =
-      "f" +
-      std::to_string(operation->getResult(0).getType().getIntOrFloatBitWidth());
+  // Integer ops without an entry in the operator library become comb ops.
+  if (isa<mlir::arith::AddIOp, mlir::arith::SubIOp, mlir::arith::MulIOp>(
+          operation))
+    return success();
 
-  if (isa<mlir::arith::AddFOp>(operation))
-    opName = "add_" + typeStr;
-  else if (isa<mlir::arith::SubFOp>(operation))
-    opName = "sub_" + typeStr;
-  else if (isa<mlir::arith::MulFOp>(operation))
-    opName = "mul_" + typeStr;
-  else if (isa<mlir::arith::DivFOp>(operation))
-    opName = "div_" + typeStr;
-  else
-    return operation->emitError("Unknown arith operation.");
+  std::string opName = getFloatModuleName(operation);
+  if (opName.empty())
+    return operation->emitError("Unknown arith operation. Add it to the "
+                                "operator library to lower it to a module.");
 
   auto funcDecl =
       dyn_cast_or_null<mlir::func::FuncOp>(getOperation().lookupSymbol(opName));
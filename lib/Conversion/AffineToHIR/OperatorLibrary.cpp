@@ -0,0 +1,69 @@
+//===- OperatorLibrary.cpp - Hardware modules for arith ops ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "OperatorLibrary.h"
+#include "mlir/IR/Diagnostics.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+using namespace mlir;
+
+mlir::LogicalResult OperatorLibrary::load(llvm::StringRef fileName,
+                                          mlir::Location loc) {
+  auto buffer = llvm::MemoryBuffer::getFile(fileName);
+  if (!buffer)
+    return emitError(loc, "Could not open operator library ") << fileName;
+
+  auto json = llvm::json::parse(buffer.get()->getBuffer());
+  if (!json)
+    return emitError(loc, "Could not parse operator library ")
+           << fileName << ": " << llvm::toString(json.takeError());
+
+  auto *operators =
+      json->getAsObject() ? json->getAsObject()->getArray("operators") : NULL;
+  if (!operators)
+    return emitError(loc, "Expected an \"operators\" array in ") << fileName;
+
+  for (auto &entry : *operators) {
+    auto *obj = entry.getAsObject();
+    auto opName = obj ? obj->getString("op") : llvm::None;
+    auto width = obj ? obj->getInteger("width") : llvm::None;
+    auto moduleName = obj ? obj->getString("module") : llvm::None;
+    auto latency = obj ? obj->getInteger("latency") : llvm::None;
+    if (!opName || !width || !moduleName || !latency || *width <= 0 ||
+        *latency < 0)
+      return emitError(loc, "Operator library entries need op, width, module "
+                            "and latency.");
+
+    OperatorImpl impl;
+    impl.moduleName = moduleName->str();
+    impl.latency = *latency;
+    impl.ii = obj->getInteger("ii").value_or(1);
+    if (impl.ii <= 0)
+      return emitError(loc, "II of ") << *moduleName << " must be positive.";
+    if (auto *cost = obj->getObject("cost"))
+      for (auto &kv : *cost)
+        if (auto c = kv.second.getAsInteger())
+          impl.cost[kv.first.str()] = *c;
+
+    impls[std::make_pair(opName->str(), (unsigned)*width)] = impl;
+  }
+  return success();
+}
+
+llvm::Optional<OperatorImpl>
+OperatorLibrary::lookup(mlir::Operation *operation) const {
+  if (operation->getNumOperands() == 0 ||
+      !operation->getOperand(0).getType().isIntOrFloat())
+    return llvm::None;
+  auto width = operation->getOperand(0).getType().getIntOrFloatBitWidth();
+  auto impl = impls.find(std::make_pair(
+      operation->getName().getStringRef().str(), (unsigned)width));
+  if (impl == impls.end())
+    return llvm::None;
+  return impl->second;
+}
@@ -0,0 +1,46 @@
+//===- OperatorLibrary.h - Hardware modules for arith ops -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the operator library used by hir-pragma to replace arith
+// ops with calls to hardware modules.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HIR_OPERATOR_LIBRARY_H
+#define HIR_OPERATOR_LIBRARY_H
+
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include <map>
+#include <string>
+
+/// Hardware implementation of an arith op.
+struct OperatorImpl {
+  std::string moduleName;
+  int64_t latency;
+  int64_t ii;
+  /// Resource usage, such as {"dsp": 2, "lut": 350}.
+  llvm::StringMap<int64_t> cost;
+};
+
+/// Maps an arith op and its bit width to the module that implements it. The
+/// library is read from a json file of the form:
+///   {"operators": [{"op": "arith.addf", "width": 32, "module": "fadd_f32",
+///                   "latency": 3, "ii": 1, "cost": {"dsp": 2}}]}
+struct OperatorLibrary {
+  mlir::LogicalResult load(llvm::StringRef fileName, mlir::Location loc);
+  llvm::Optional<OperatorImpl> lookup(mlir::Operation *operation) const;
+
+private:
+  std::map<std::pair<std::string, unsigned>, OperatorImpl> impls;
+};
+
+#endif
@@ -18,6 +18,8 @@ FuncExternPragmaHandler::FuncExternPragmaHandler(mlir::func::CallOp op) {
     op.emitError("Expected callee to be hir FuncExternOp.");
   }
   assert(funcOp);
+  auto iiAttr = funcOp->getAttrOfType<IntegerAttr>("hir.ii");
+  ii = iiAttr ? iiAttr.getInt() : 1;
   auto hirFuncTy = funcOp.getFuncType();
   for (auto attr : hirFuncTy.getInputAttrs()) {
     auto delay = helper::getHIRDelayAttr(attr);
@@ -27,7 +29,10 @@ FuncExternPragmaHandler::FuncExternPragmaHandler(mlir::func::CallOp op) {
       argDelays.push_back(llvm::None);
   }
   for (auto attr : hirFuncTy.getResultAttrs()) {
-    auto delay = helper::getHIRDelayAttr(attr);
+    // A dynamic-latency result has no static delay from the start time.
+    auto delay = helper::getHIRDelayFromAttr(attr)
+                     ? llvm::None
+                     : helper::getHIRDelayAttr(attr);
     if (delay)
       resultDelays.push_back(*delay);
     else
@@ -43,6 +48,8 @@ llvm::Optional<size_t> FuncExternPragmaHandler::getResultDelay(size_t i) {
   return resultDelays[i];
 }
 
+int64_t FuncExternPragmaHandler::getII() { return ii; }
+
 MemrefPragmaHandler::MemrefPragmaHandler(Value memref) : ramKind(SMP) {
   assert(memref.getType().isa<mlir::MemRefType>());
 
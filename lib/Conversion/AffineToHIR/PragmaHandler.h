@@ -7,8 +7,10 @@ struct FuncExternPragmaHandler {
   FuncExternPragmaHandler(mlir::func::CallOp op);
   llvm::Optional<size_t> getArgDelay(size_t i);
   llvm::Optional<size_t> getResultDelay(size_t i);
+  int64_t getII();
 
 private:
+  int64_t ii;
   mlir::SmallVector<llvm::Optional<size_t>> argDelays;
   mlir::SmallVector<llvm::Optional<size_t>> resultDelays;
 };
@@ -13,6 +13,7 @@
 #include "mlir/Support/LogicalResult.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdlib>
@@ -49,8 +50,14 @@ static Optional<size_t> getArgDelay(Operation *operation, size_t i) {
 }
 
 static Optional<size_t> getResultDelay(Operation *operation, size_t i) {
-  if (isa<arith::ArithmeticDialect>(operation->getDialect()))
+  if (isa<arith::ArithmeticDialect>(operation->getDialect())) {
+    if (!ArithOpInfo::isSupported(operation)) {
+      operation->emitError("No hardware implementation for this op. Map it to "
+                           "a module with hir-pragma's operator-library.");
+      return llvm::None;
+    }
     return ArithOpInfo(operation).getDelay();
+  }
   if (isa<AffineLoadOp, AffineStoreOp>(operation))
     return MemOpInfo(operation, 0 /*dont care*/).getDelay();
   if (auto op = dyn_cast<func::CallOp>(operation)) {
@@ -76,7 +83,7 @@ static LogicalResult getCommonII(Operation *op, Optional<int64_t> &commonII) {
 }
 
 static LogicalResult getCommonII(Operation *op1, Operation *op2,
-                                 Optional<int64_t> commonII) {
+                                 Optional<int64_t> &commonII) {
   if (failed(getCommonII(op1, commonII)))
     return failure();
 
@@ -85,6 +92,17 @@ static LogicalResult getCommonII(Operation *op1, Operation *op2,
   return success();
 }
 
+/// Ops of the same kind can share an operator instance. Calls are identified
+/// by the callee and the arith ops that are lowered to comb ops by their name.
+static Optional<StringRef> getOperatorKind(Operation *operation) {
+  if (auto op = dyn_cast<func::CallOp>(operation))
+    return op.getCallee();
+  if (isa<arith::ArithmeticDialect>(operation->getDialect()) &&
+      !isa<arith::ConstantOp>(operation))
+    return operation->getName().getStringRef();
+  return llvm::None;
+}
+
 //-----------------------------------------------------------------------------
 // class SchedulingAnalysis methods.
 //-----------------------------------------------------------------------------
@@ -116,6 +134,13 @@ int64_t HIRScheduler::getPortNumForMemoryOp(Operation *operation) {
       this->getResourceAllocation(operation, resource).value_or(0));
 }
 
+Optional<int64_t> HIRScheduler::getOperatorInstance(Operation *operation) {
+  auto *resource = mapOp2OperatorResource.lookup(operation);
+  if (!resource)
+    return llvm::None;
+  return this->getResourceAllocation(operation, resource);
+}
+
 LogicalResult HIRScheduler::insertMemoryDependence(MemOpInfo src,
                                                    MemOpInfo dest) {
   if (src.getMemRef() != dest.getMemRef())
@@ -376,11 +401,96 @@ LogicalResult HIRScheduler::insertSSADependencies() {
   return success();
 }
 
+/// The func attr `hir.operator_limits` (set by hir-pragma) limits the number
+/// of instances of an operator. Every pair of ops that may share an instance
+/// must either be bound to different instances or be issued in different
+/// cycles modulo the common initiation interval of their loop nests.
+/// Sibling loops are not ordered by the schedule and may overlap, so their ops
+/// are constrained the same way. This is conservative when the dependences
+/// keep the loops apart in time, since the loop end times are not modeled.
+LogicalResult HIRScheduler::insertOperatorConflicts() {
+  auto limits = funcOp->getAttrOfType<DictionaryAttr>("hir.operator_limits");
+  if (!limits)
+    return success();
+
+  llvm::StringMap<SmallVector<Operation *>> mapKindToOps;
+  funcOp.walk([&mapKindToOps](Operation *operation) {
+    if (auto kind = getOperatorKind(operation))
+      mapKindToOps[*kind].push_back(operation);
+  });
+
+  for (auto limit : limits) {
+    auto numInstances = limit.getValue().dyn_cast<IntegerAttr>();
+    if (!numInstances || numInstances.getInt() < 1)
+      return funcOp->emitError("Limit of operator ")
+             << limit.getName() << " must be a positive integer.";
+
+    auto &ops = mapKindToOps[limit.getName().getValue()];
+    if (ops.size() <= (size_t)numInstances.getInt())
+      continue;
+
+    auto callOp = dyn_cast<func::CallOp>(ops[0]);
+    if (!callOp)
+      return ops[0]->emitError("Only ops that are implemented by a module can "
+                               "be shared. Map ")
+             << limit.getName() << " to a module with hir-pragma's "
+             << "operator-library.";
+    if (FuncExternPragmaHandler(callOp).getII() > 1)
+      return callOp->emitError("Callee ")
+             << limit.getName()
+             << " does not accept new inputs every cycle and can not be "
+                "shared.";
+
+    operatorResources.push_back(std::make_unique<OperatorResource>(
+        limit.getName().getValue(), numInstances.getInt()));
+    auto *resource = operatorResources.back().get();
+    for (size_t i = 0; i < ops.size(); i++) {
+      mapOp2OperatorResource[ops[i]] = resource;
+      for (size_t j = i + 1; j < ops.size(); j++) {
+        Optional<int64_t> commonII;
+        if (failed(getCommonII(ops[i], ops[j], commonII)))
+          return failure();
+        this->addConflict(Conflict(ops[i], ops[j], commonII.value_or(100),
+                                   resource, llvm::None));
+      }
+    }
+  }
+  return success();
+}
+
+/// A call to a module that accepts new inputs every `ii` cycles can not be
+/// issued by a loop nest that starts iterations more often than that.
+LogicalResult HIRScheduler::checkOperatorII() {
+  auto walkResult = funcOp.walk([](func::CallOp op) {
+    auto ii = FuncExternPragmaHandler(op).getII();
+    if (ii <= 1)
+      return WalkResult::advance();
+    Optional<int64_t> commonII;
+    if (failed(getCommonII(op, commonII)))
+      return WalkResult::interrupt();
+    if (commonII && *commonII < ii) {
+      op.emitError("Callee ")
+          << op.getCallee() << " has II " << ii
+          << " but the enclosing loops may issue it every " << *commonII
+          << " cycles.";
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  if (walkResult.wasInterrupted())
+    return failure();
+  return success();
+}
+
 LogicalResult HIRScheduler::init() {
+  if (failed(checkOperatorII()))
+    return failure();
   if (failed(insertMemAccessConstraints()))
     return failure();
   if (failed(insertSSADependencies()))
     return failure();
+  if (failed(insertOperatorConflicts()))
+    return failure();
   logger << "\n=========================================\n";
   logger << "Scheduling ILP:";
   logger << "\n=========================================\n\n";
@@ -179,14 +179,12 @@ llvm::SmallVector<mlir::Value> MemOpInfo::getIndices() {
 ArithOpInfo::ArithOpInfo(mlir::Operation *operation) {
   assert(isa<arith::ArithmeticDialect>(operation->getDialect()));
   assert(!isa<arith::ConstantOp>(operation) && "arith.constant ");
-  if (isa<arith::AddIOp>(operation)) {
-    this->delay = 0;
-  } else if (isa<arith::MulIOp>(operation)) {
-    this->delay = 0;
-  } else {
-    operation->emitError();
-    assert(false && "unsupported Arith operation");
-  }
+  assert(isSupported(operation) && "unsupported Arith operation");
+  this->delay = 0;
+}
+
+bool ArithOpInfo::isSupported(mlir::Operation *operation) {
+  return isa<arith::AddIOp, arith::SubIOp, arith::MulIOp>(operation);
 }
 
 int64_t ArithOpInfo::getDelay() { return delay; }
@@ -602,7 +600,7 @@ void Scheduler::addDependence(Dependence dep) {
 
 void Scheduler::addConflict(Conflict conflict) {
   assert(conflict.op1 != conflict.op2);
-  logger << "Potential port conflict between, \n";
+  logger << "Potential resource conflict between, \n";
   conflict.op1->print(logger);
   logger << "\nand, \n";
   conflict.op2->print(logger);
@@ -625,8 +623,12 @@ void Scheduler::addConflict(Conflict conflict) {
                                               "p" + to_string(this->varNum));
 
   double m = 10000;
-  auto *b1 = this->addConditionalGTE(ttOp2, ttOp1, conflict.depDelay, m,
-                                     "b1_" + to_string(this->varNum));
+  auto *constr = this->MakeRowConstraint(1, 1, "bank-conflict");
+  if (conflict.depDelay) {
+    auto *b1 = this->addConditionalGTE(ttOp2, ttOp1, *conflict.depDelay, m,
+                                       "b1_" + to_string(this->varNum));
+    addCoeff(constr, b1, 1);
+  }
   auto *b2 =
       this->addConditionalGTE(p1, p2, 1, m, "b2_" + to_string(this->varNum));
   auto *b3 =
@@ -636,8 +638,6 @@ void Scheduler::addConflict(Conflict conflict) {
   auto *b5 =
       this->addConditionalGTE(r2, r1, 1, m, "b5_" + to_string(this->varNum));
 
-  auto *constr = this->MakeRowConstraint(1, 1, "bank-conflict");
-  addCoeff(constr, b1, 1);
   addCoeff(constr, b2, 1);
   addCoeff(constr, b3, 1);
   addCoeff(constr, b4, 1);
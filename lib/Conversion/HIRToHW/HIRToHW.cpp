@@ -18,6 +18,15 @@
 #include <iostream>
 using namespace circt;
 
+/// The hw signals of one end of a fifo. On the write end the sends drive data
+/// and valid and read ready. On the read end the receives drive ready and read
+/// data and valid.
+struct FifoPort {
+  Value data;
+  Value valid;
+  Value ready;
+};
+
 class HIRToHWPass : public HIRToHWBase<HIRToHWPass> {
 public:
   void runOnOperation() override;
@@ -50,6 +59,9 @@ private:
   LogicalResult visitOp(hir::DelayOp);
   LogicalResult visitOp(hir::FuncExternOp);
   LogicalResult visitOp(hir::FuncOp);
+  LogicalResult visitOp(hir::FifoOp);
+  LogicalResult visitOp(hir::FifoRecvOp);
+  LogicalResult visitOp(hir::FifoSendOp);
   LogicalResult visitOp(hir::GetClockOp);
   LogicalResult visitOp(hir::GetResetOp);
   LogicalResult visitOp(hir::IsFirstIterOp);
@@ -68,6 +80,8 @@ private:
                                          StringRef instanceName,
                                          ArrayRef<Value> hwInputs,
                                          ArrayAttr hwParams, Value tstart);
+  void driveFifoWritePort(Value fifo, Value valid, Value data);
+  void driveFifoReadPort(Value fifo, Value ready);
 
 private:
   Optional<OpBuilder> builder;
@@ -81,6 +95,9 @@ private:
   DenseMap<Value, SmallVector<Value>> mapArrayToElements;
   DenseMap<StringRef, Operation *> mapNameToHWModuleOp;
   DenseMap<StringRef, hw::InstanceOp> mapNameToHWInstanceOp;
+  DenseMap<Value, FifoPort> mapFifoToWritePort;
+  DenseMap<Value, FifoPort> mapFifoToReadPort;
+  SmallVector<std::pair<hw::InstanceOp, Value>> localFifoInstances;
 };
 
 Value emitMux(OpBuilder &builder, Value select, Value t, Value f) {
@@ -212,34 +229,41 @@ LogicalResult HIRToHWPass::visitOp(mlir::arith::ConstantOp op) {
 }
 LogicalResult HIRToHWPass::visitOp(hir::CallOp op) {
   assert(op.offset() == 0);
-  auto filteredOperands = filterCallOpArgs(op.getFuncType(), op.operands());
+  auto funcTy = op.getFuncType();
 
-  // Get the mapped inputs and create the input types for instance op.
+  // Get the mapped inputs and create the input types for instance op. Send
+  // buses are outputs of the instance. Fifos contribute the ports that the
+  // callee reads: ready for a send fifo, data and valid for a recv fifo.
   SmallVector<Value> hwInputs;
-  for (auto input : filteredOperands.first) {
-    auto hwInput = mapHIRToHWValue.lookup(input);
-    hwInputs.push_back(hwInput);
+  for (size_t i = 0; i < op.operands().size(); i++) {
+    auto operand = op.operands()[i];
+    auto ty = funcTy.getInputTypes()[i];
+    bool const isSend = isSendBus(funcTy.getInputAttrs()[i]);
+    if (ty.isa<hir::FifoType>()) {
+      if (isSend && !mapFifoToWritePort.count(operand))
+        return op.emitError() << "operand " << i
+                              << " is not a writable fifo in this function.";
+      if (!isSend && !mapFifoToReadPort.count(operand))
+        return op.emitError() << "operand " << i
+                              << " is not a readable fifo in this function.";
+      if (isSend) {
+        hwInputs.push_back(mapFifoToWritePort[operand].ready);
+      } else {
+        hwInputs.push_back(mapFifoToReadPort[operand].data);
+        hwInputs.push_back(mapFifoToReadPort[operand].valid);
+      }
+      continue;
+    }
+    if (helper::isBusLikeType(ty) && isSend)
+      continue;
+    hwInputs.push_back(mapHIRToHWValue.lookup(operand));
   }
-  assert(op.offset() == 0);
 
   Value const tstart = mapHIRToHWValue.lookup(op.tstart());
   hwInputs.push_back(tstart);
   hwInputs.push_back(this->clk);
   hwInputs.push_back(this->reset);
 
-  auto hwInputTypes = helper::getTypes(hwInputs);
-
-  auto sendBuses = filteredOperands.second;
-  auto sendBusTypes = helper::getTypes(sendBuses);
-
-  // Create instance op result types.
-  SmallVector<Type> hwResultTypes;
-  for (auto ty : sendBusTypes)
-    hwResultTypes.push_back(*helper::convertToHWType(ty));
-
-  for (auto ty : op.getResultTypes())
-    hwResultTypes.push_back(*helper::convertToHWType(ty));
-
   auto instanceName = op.instance_nameAttr();
   assert(instanceName);
   auto *calleeHWModule = getEmittedHWModuleOp(op.callee());
@@ -250,12 +274,27 @@ LogicalResult HIRToHWPass::visitOp(hir::CallOp op) {
 
   // Map callop input send buses to the results of the instance op and replace
   // all prev uses of the placeholder hw ssa vars corresponding to these send
-  // buses.
-  uint64_t i;
-  for (i = 0; i < sendBuses.size(); i++) {
-    auto placeHolderSSAVar = mapHIRToHWValue.lookup(sendBuses[i]);
-    mapHIRToHWValue.replaceAllHWUses(placeHolderSSAVar,
-                                     instanceOp.getResult(i));
+  // buses. Fifo outputs of the instance drive the fifo ports of this module.
+  uint64_t i = 0;
+  for (size_t argNum = 0; argNum < op.operands().size(); argNum++) {
+    auto operand = op.operands()[argNum];
+    auto ty = funcTy.getInputTypes()[argNum];
+    bool const isSend = isSendBus(funcTy.getInputAttrs()[argNum]);
+    if (ty.isa<hir::FifoType>()) {
+      if (isSend) {
+        driveFifoWritePort(operand, instanceOp.getResult(i + 1),
+                           instanceOp.getResult(i));
+        i += 2;
+      } else {
+        driveFifoReadPort(operand, instanceOp.getResult(i));
+        i++;
+      }
+    } else if (helper::isBusLikeType(ty) && isSend) {
+      auto placeHolderSSAVar = mapHIRToHWValue.lookup(operand);
+      mapHIRToHWValue.replaceAllHWUses(placeHolderSSAVar,
+                                       instanceOp.getResult(i));
+      i++;
+    }
   }
 
   // Map the CallOp return vars to instance op return vars.
@@ -422,8 +461,18 @@ LogicalResult HIRToHWPass::visitOp(hir::ReturnOp op) {
   SmallVector<Value> hwOutputs;
 
   // Insert 'send' buses in the input args of hir.func. These buses are outputs
-  // in the hw dialect.
+  // in the hw dialect. Fifo args output data and valid (send) or ready (recv).
   for (size_t i = 0; i < funcArgs.size(); i++) {
+    if (funcArgs[i].getType().isa<hir::FifoType>()) {
+      auto fifoPorts = portMap.getFifoPortsForFuncInput(i);
+      if (fifoPorts[0].direction == hw::PortDirection::OUTPUT) {
+        hwOutputs.push_back(mapFifoToWritePort[funcArgs[i]].data);
+        hwOutputs.push_back(mapFifoToWritePort[funcArgs[i]].valid);
+      } else {
+        hwOutputs.push_back(mapFifoToReadPort[funcArgs[i]].ready);
+      }
+      continue;
+    }
     auto modulePortInfo = portMap.getPortInfoForFuncInput(i);
     if (modulePortInfo.direction == hw::PortDirection::OUTPUT) {
       hwOutputs.push_back(mapHIRToHWValue.lookup((Value)funcArgs[i]));
@@ -481,6 +530,23 @@ void HIRToHWPass::updateHIRToHWMapForFuncInputs(
     hw::HWModuleOp hwModuleOp, mlir::Block::BlockArgListType funcArgs,
     FuncToHWModulePortMap portMap) {
   for (size_t i = 0; i < funcArgs.size(); i++) {
+    if (auto fifoTy = funcArgs[i].getType().dyn_cast<hir::FifoType>()) {
+      auto fifoPorts = portMap.getFifoPortsForFuncInput(i);
+      auto *bodyBlock = hwModuleOp.getBodyBlock();
+      auto zeroBit = helper::materializeIntegerConstant(*builder, 0, 1);
+      if (fifoPorts[0].direction == hw::PortDirection::OUTPUT) {
+        mapFifoToWritePort[funcArgs[i]] = {
+            .data = constantX(*builder, fifoTy.getElementType())->getResult(0),
+            .valid = zeroBit,
+            .ready = bodyBlock->getArgument(fifoPorts[2].argNum)};
+      } else {
+        mapFifoToReadPort[funcArgs[i]] = {
+            .data = bodyBlock->getArgument(fifoPorts[0].argNum),
+            .valid = bodyBlock->getArgument(fifoPorts[1].argNum),
+            .ready = zeroBit};
+      }
+      continue;
+    }
     auto modulePortInfo = portMap.getPortInfoForFuncInput(i);
     if (modulePortInfo.direction == hw::PortDirection::INPUT) {
       auto hwArg =
@@ -519,11 +585,120 @@ LogicalResult HIRToHWPass::visitOp(hir::FuncOp op) {
 
   this->clk = getClkFromHWModule(hwModuleOp);
   this->reset = getResetFromHWModule(hwModuleOp);
+  this->localFifoInstances.clear();
   auto visitResult = visitRegion(op.getFuncBody());
 
+  // Connect the sends and receives of the local fifos to the fifo instances.
+  for (auto instanceAndFifo : localFifoInstances) {
+    auto instanceOp = instanceAndFifo.first;
+    auto fifo = instanceAndFifo.second;
+    instanceOp->setOperand(0, mapFifoToWritePort[fifo].data);
+    instanceOp->setOperand(1, mapFifoToWritePort[fifo].valid);
+    instanceOp->setOperand(2, mapFifoToReadPort[fifo].ready);
+  }
+
   return visitResult;
 }
 
+void HIRToHWPass::driveFifoWritePort(Value fifo, Value valid, Value data) {
+  auto uLoc = builder->getUnknownLoc();
+  auto &port = mapFifoToWritePort[fifo];
+  port.data = builder->create<comb::MuxOp>(uLoc, valid, data, port.data);
+  port.valid = builder->create<comb::OrOp>(uLoc, valid, port.valid);
+}
+
+void HIRToHWPass::driveFifoReadPort(Value fifo, Value ready) {
+  auto &port = mapFifoToReadPort[fifo];
+  port.ready =
+      builder->create<comb::OrOp>(builder->getUnknownLoc(), ready, port.ready);
+}
+
+LogicalResult HIRToHWPass::visitOp(hir::FifoOp op) {
+  auto fifoTy = op.getType().dyn_cast<hir::FifoType>();
+  auto dataTy = *helper::convertToHWType(fifoTy.getElementType());
+  std::string const fifoModuleName =
+      "hir_fifo_w" + std::to_string(hw::getBitWidth(dataTy)) + "_d" +
+      std::to_string(fifoTy.getDepth());
+
+  // Emit the fifo module once per configuration, before the current module.
+  auto it = mapNameToHWModuleOp.find(fifoModuleName);
+  Operation *fifoModule;
+  if (it == mapNameToHWModuleOp.end()) {
+    OpBuilder::InsertionGuard const guard(*this->builder);
+    builder->setInsertionPoint(hwModuleOp);
+    auto fifoModuleOp = emitFifoHWModule(*builder, fifoModuleName, dataTy,
+                                         fifoTy.getDepth());
+    mapNameToHWModuleOp[fifoModuleOp.getName()] = fifoModuleOp;
+    fifoModule = fifoModuleOp;
+  } else {
+    fifoModule = it->getSecond();
+  }
+
+  // The write-side inputs of the instance are updated once all the sends and
+  // receives in this function have been lowered.
+  auto zeroBit = helper::materializeIntegerConstant(*builder, 0, 1);
+  auto dataX = constantX(*builder, fifoTy.getElementType())->getResult(0);
+  auto name = helper::getOptionalName(op, 0);
+  auto instanceOp = builder->create<hw::InstanceOp>(
+      op.getLoc(), fifoModule,
+      builder->getStringAttr(name ? name.getValue().str()
+                                  : "fifo" + getUniquePostfix()),
+      SmallVector<Value>({dataX, zeroBit, zeroBit, clk, reset}), ArrayAttr(),
+      StringAttr());
+
+  mapFifoToWritePort[op.res()] = {
+      .data = dataX, .valid = zeroBit, .ready = instanceOp.getResult(0)};
+  mapFifoToReadPort[op.res()] = {.data = instanceOp.getResult(1),
+                                 .valid = instanceOp.getResult(2),
+                                 .ready = zeroBit};
+  localFifoInstances.push_back(std::make_pair(instanceOp, op.res()));
+  return success();
+}
+
+LogicalResult HIRToHWPass::visitOp(hir::FifoSendOp op) {
+  assert(op.offset() == 0);
+  auto uLoc = builder->getUnknownLoc();
+  if (!mapFifoToWritePort.count(op.fifo()))
+    return op.emitError() << "Fifo is not writable in this function.";
+  auto value = mapHIRToHWValue.lookup(op.value());
+  auto tstart = mapHIRToHWValue.lookup(op.tstart());
+  auto ready = mapFifoToWritePort[op.fifo()].ready;
+
+  // Hold the value until the fifo accepts it.
+  auto dataReg = builder->create<sv::RegOp>(
+      uLoc, value.getType(), builder->getStringAttr("fifo_send_data"));
+  auto heldData = builder->create<sv::ReadInOutOp>(uLoc, dataReg);
+  Value const sendData =
+      builder->create<comb::MuxOp>(uLoc, tstart, value, heldData);
+  builder->create<sv::AlwaysFFOp>(
+      uLoc, sv::EventControl::AtPosEdge, clk, [this, &dataReg, &sendData] {
+        builder->create<sv::PAssignOp>(builder->getUnknownLoc(),
+                                       dataReg.getResult(), sendData);
+      });
+
+  auto active = getFifoOpActiveSignal(*builder, tstart, ready, clk, reset);
+  driveFifoWritePort(op.fifo(), active, sendData);
+  mapHIRToHWValue.map(op.t_done(),
+                      builder->create<comb::AndOp>(uLoc, active, ready));
+  return success();
+}
+
+LogicalResult HIRToHWPass::visitOp(hir::FifoRecvOp op) {
+  assert(op.offset() == 0);
+  auto uLoc = builder->getUnknownLoc();
+  if (!mapFifoToReadPort.count(op.fifo()))
+    return op.emitError() << "Fifo is not readable in this function.";
+  auto tstart = mapHIRToHWValue.lookup(op.tstart());
+  auto valid = mapFifoToReadPort[op.fifo()].valid;
+
+  auto active = getFifoOpActiveSignal(*builder, tstart, valid, clk, reset);
+  driveFifoReadPort(op.fifo(), active);
+  mapHIRToHWValue.map(op.res(), mapFifoToReadPort[op.fifo()].data);
+  mapHIRToHWValue.map(op.t_done(),
+                      builder->create<comb::AndOp>(uLoc, active, valid));
+  return success();
+}
+
 LogicalResult HIRToHWPass::visitOp(hir::GetClockOp op) {
   op.getResult().replaceAllUsesWith(this->clk);
   return success();
@@ -787,6 +962,12 @@ LogicalResult HIRToHWPass::visitOperation(Operation *operation) {
     return visitOp(op);
   if (auto op = dyn_cast<hir::DriveOp>(operation))
     return visitOp(op);
+  if (auto op = dyn_cast<hir::FifoOp>(operation))
+    return visitOp(op);
+  if (auto op = dyn_cast<hir::FifoSendOp>(operation))
+    return visitOp(op);
+  if (auto op = dyn_cast<hir::FifoRecvOp>(operation))
+    return visitOp(op);
   if (auto *dialect = operation->getDialect();
       isa<comb::CombDialect, hw::HWDialect, sv::SVDialect>(dialect))
     return visitHWOp(operation);
@@ -823,6 +1004,10 @@ void HIRToHWPass::runOnOperation() {
       opsToErase.push_back(&operation);
   }
   helper::eraseOps(opsToErase);
+
+  if (balanceMuxes)
+    for (auto hwModuleOp : getOperation().getOps<hw::HWModuleOp>())
+      balanceMuxChains(hwModuleOp, minMuxChainLength);
 }
 
 /// hir-to-hw pass Constructor
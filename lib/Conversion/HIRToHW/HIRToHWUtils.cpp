@@ -22,6 +22,36 @@ void FuncToHWModulePortMap::addFuncInput(StringAttr name,
       {.name = name, .direction = direction, .type = type, .argNum = argNum});
 }
 
+/// A fifo input becomes three ports: data, valid and ready. The producer
+/// ("send") drives data and valid, the consumer ("recv") drives ready.
+void FuncToHWModulePortMap::addFifoFuncInput(OpBuilder &builder,
+                                             StringAttr name, bool isSend,
+                                             Type type) {
+  auto inputNum = mapFuncInputToHWPortInfo.size();
+  auto dataDirection =
+      isSend ? hw::PortDirection::OUTPUT : hw::PortDirection::INPUT;
+  auto readyDirection =
+      isSend ? hw::PortDirection::INPUT : hw::PortDirection::OUTPUT;
+
+  auto addPort = [&](StringRef suffix, hw::PortDirection direction, Type ty) {
+    size_t const argNum = (direction == hw::PortDirection::INPUT)
+                              ? (hwModuleInputArgNum++)
+                              : (hwModuleResultArgNum++);
+    hw::PortInfo portInfo = {.name = builder.getStringAttr(
+                                 name.getValue().str() + suffix.str()),
+                             .direction = direction,
+                             .type = ty,
+                             .argNum = argNum};
+    portInfoList.push_back(portInfo);
+    mapFuncInputToFifoPorts[inputNum].push_back(portInfo);
+  };
+
+  addPort("_data", dataDirection, type);
+  addPort("_valid", dataDirection, builder.getI1Type());
+  addPort("_ready", readyDirection, builder.getI1Type());
+  mapFuncInputToHWPortInfo.push_back(mapFuncInputToFifoPorts[inputNum][0]);
+}
+
 void FuncToHWModulePortMap::addClk(OpBuilder &builder) {
   auto clkName = builder.getStringAttr("clk");
   portInfoList.push_back({.name = clkName,
@@ -63,20 +93,11 @@ FuncToHWModulePortMap::getPortInfoForFuncInput(size_t inputArgNum) {
   return modulePortInfo;
 }
 
-std::pair<SmallVector<Value>, SmallVector<Value>>
-filterCallOpArgs(hir::FuncType funcTy, OperandRange args) {
-  SmallVector<Value> inputs;
-  SmallVector<Value> results;
-  for (uint64_t i = 0; i < funcTy.getInputTypes().size(); i++) {
-    auto ty = funcTy.getInputTypes()[i];
-    if (helper::isBusLikeType(ty) && isSendBus(funcTy.getInputAttrs()[i])) {
-      results.push_back(args[i]);
-      continue;
-    }
-    inputs.push_back(args[i]);
-  }
-
-  return std::make_pair(inputs, results);
+ArrayRef<hw::PortInfo>
+FuncToHWModulePortMap::getFifoPortsForFuncInput(size_t inputArgNum) {
+  auto it = mapFuncInputToFifoPorts.find(inputArgNum);
+  assert(it != mapFuncInputToFifoPorts.end());
+  return it->getSecond();
 }
 
 FuncToHWModulePortMap getHWModulePortMap(OpBuilder &builder,
@@ -90,6 +111,13 @@ FuncToHWModulePortMap getHWModulePortMap(OpBuilder &builder,
   uint64_t i;
   for (i = 0; i < funcTy.getInputTypes().size(); i++) {
     auto originalTy = funcTy.getInputTypes()[i];
+    if (auto fifoTy = originalTy.dyn_cast<hir::FifoType>()) {
+      auto name = inputNames[i].dyn_cast<StringAttr>();
+      portMap.addFifoFuncInput(
+          builder, name, isSendBus(funcTy.getInputAttrs()[i]),
+          *helper::convertToHWType(fifoTy.getElementType()));
+      continue;
+    }
     auto hwTy = helper::convertToHWType(originalTy);
     if (!hwTy)
       emitError(errorLoc) << "Type " << originalTy
@@ -299,6 +327,136 @@ Value insertConstArrayGetLogic(OpBuilder &builder, Value arr, int idx) {
   return builder.create<hw::ArrayGetOp>(uLoc, arr, cIdx);
 }
 
+/// Keeps a blocking fifo op active from `start` until `handshake` is high. The
+/// op completes in the cycle where both the returned signal and `handshake` are
+/// high.
+Value getFifoOpActiveSignal(OpBuilder &builder, Value start, Value handshake,
+                            Value clk, Value reset) {
+  auto uLoc = builder.getUnknownLoc();
+  auto pendingReg = builder.create<sv::RegOp>(
+      uLoc, builder.getI1Type(), builder.getStringAttr("fifo_pending"));
+  auto pending = builder.create<sv::ReadInOutOp>(uLoc, pendingReg);
+  Value const active = builder.create<comb::OrOp>(uLoc, start, pending);
+  auto oneBit = helper::materializeIntegerConstant(builder, 1, 1);
+  auto zeroBit = helper::materializeIntegerConstant(builder, 0, 1);
+  auto notHandshake = builder.create<comb::XorOp>(uLoc, handshake, oneBit);
+  Value const stall = builder.create<comb::AndOp>(uLoc, active, notHandshake);
+
+  builder.create<sv::AlwaysFFOp>(
+      uLoc, sv::EventControl::AtPosEdge, clk, ResetType::SyncReset,
+      sv::EventControl::AtPosEdge, reset,
+      [&builder, &pendingReg, &stall] {
+        builder.create<sv::PAssignOp>(builder.getUnknownLoc(),
+                                      pendingReg.getResult(), stall);
+      },
+      [&builder, &pendingReg, &zeroBit] {
+        builder.create<sv::PAssignOp>(builder.getUnknownLoc(),
+                                      pendingReg.getResult(), zeroBit);
+      });
+  return active;
+}
+
+/// Emits a circular-buffer fifo with a valid/ready handshake on both ends.
+/// Ports: (wr_data, wr_valid, rd_ready, clk, rst) -> (wr_ready, rd_data,
+/// rd_valid). The depth must be a power of two.
+hw::HWModuleOp emitFifoHWModule(OpBuilder &builder, StringRef name,
+                                Type dataTy, int64_t depth) {
+  auto uLoc = builder.getUnknownLoc();
+  auto i1Ty = builder.getI1Type();
+  SmallVector<hw::PortInfo> ports;
+  auto addPort = [&](StringRef portName, hw::PortDirection direction, Type ty,
+                     size_t argNum) {
+    ports.push_back({.name = builder.getStringAttr(portName),
+                     .direction = direction,
+                     .type = ty,
+                     .argNum = argNum});
+  };
+  addPort("wr_data", hw::PortDirection::INPUT, dataTy, 0);
+  addPort("wr_valid", hw::PortDirection::INPUT, i1Ty, 1);
+  addPort("rd_ready", hw::PortDirection::INPUT, i1Ty, 2);
+  addPort("clk", hw::PortDirection::INPUT, i1Ty, 3);
+  addPort("rst", hw::PortDirection::INPUT, i1Ty, 4);
+  addPort("wr_ready", hw::PortDirection::OUTPUT, i1Ty, 0);
+  addPort("rd_data", hw::PortDirection::OUTPUT, dataTy, 1);
+  addPort("rd_valid", hw::PortDirection::OUTPUT, i1Ty, 2);
+
+  auto fifoModule = builder.create<hw::HWModuleOp>(
+      uLoc, builder.getStringAttr(name), ports);
+  OpBuilder::InsertionGuard const guard(builder);
+  builder.setInsertionPointToStart(fifoModule.getBodyBlock());
+  auto args = fifoModule.getBodyBlock()->getArguments();
+  Value const wrData = args[0];
+  Value const wrValid = args[1];
+  Value const rdReady = args[2];
+  Value const clk = args[3];
+  Value const reset = args[4];
+
+  auto ptrWidth = helper::clog2(depth);
+  auto memReg = builder.create<sv::RegOp>(
+      uLoc, hw::ArrayType::get(dataTy, depth), builder.getStringAttr("mem"));
+  auto wrPtrReg = builder.create<sv::RegOp>(
+      uLoc, builder.getIntegerType(ptrWidth), builder.getStringAttr("wr_ptr"));
+  auto rdPtrReg = builder.create<sv::RegOp>(
+      uLoc, builder.getIntegerType(ptrWidth), builder.getStringAttr("rd_ptr"));
+  auto countReg =
+      builder.create<sv::RegOp>(uLoc, builder.getIntegerType(ptrWidth + 1),
+                                builder.getStringAttr("count"));
+  Value const wrPtr = builder.create<sv::ReadInOutOp>(uLoc, wrPtrReg);
+  Value const rdPtr = builder.create<sv::ReadInOutOp>(uLoc, rdPtrReg);
+  Value const count = builder.create<sv::ReadInOutOp>(uLoc, countReg);
+
+  auto countWidth = ptrWidth + 1;
+  auto cDepth = helper::materializeIntegerConstant(builder, depth, countWidth);
+  auto cCountZero = helper::materializeIntegerConstant(builder, 0, countWidth);
+  auto cCountOne = helper::materializeIntegerConstant(builder, 1, countWidth);
+  auto cPtrZero = helper::materializeIntegerConstant(builder, 0, ptrWidth);
+  auto cPtrOne = helper::materializeIntegerConstant(builder, 1, ptrWidth);
+
+  Value const wrReady = builder.create<comb::ICmpOp>(
+      uLoc, comb::ICmpPredicate::ne, count, cDepth);
+  Value const rdValid = builder.create<comb::ICmpOp>(
+      uLoc, comb::ICmpPredicate::ne, count, cCountZero);
+  Value const wrFire = builder.create<comb::AndOp>(uLoc, wrValid, wrReady);
+  Value const rdFire = builder.create<comb::AndOp>(uLoc, rdReady, rdValid);
+  Value const rdData = builder.create<hw::ArrayGetOp>(
+      uLoc, builder.create<sv::ReadInOutOp>(uLoc, memReg), rdPtr);
+
+  Value const wrPtrNext = builder.create<comb::MuxOp>(
+      uLoc, wrFire, builder.create<comb::AddOp>(uLoc, wrPtr, cPtrOne), wrPtr);
+  Value const rdPtrNext = builder.create<comb::MuxOp>(
+      uLoc, rdFire, builder.create<comb::AddOp>(uLoc, rdPtr, cPtrOne), rdPtr);
+  Value const countInc = builder.create<comb::AddOp>(uLoc, count, cCountOne);
+  Value const countDec = builder.create<comb::SubOp>(uLoc, count, cCountOne);
+  Value const countNext = builder.create<comb::MuxOp>(
+      uLoc, wrFire, builder.create<comb::MuxOp>(uLoc, rdFire, count, countInc),
+      builder.create<comb::MuxOp>(uLoc, rdFire, countDec, count));
+
+  auto bodyCtor = [&] {
+    builder.create<sv::IfOp>(uLoc, wrFire, [&] {
+      auto memSlot = builder.create<sv::ArrayIndexInOutOp>(uLoc, memReg, wrPtr);
+      builder.create<sv::PAssignOp>(uLoc, memSlot, wrData);
+    });
+    builder.create<sv::PAssignOp>(uLoc, wrPtrReg.getResult(), wrPtrNext);
+    builder.create<sv::PAssignOp>(uLoc, rdPtrReg.getResult(), rdPtrNext);
+    builder.create<sv::PAssignOp>(uLoc, countReg.getResult(), countNext);
+  };
+  auto resetCtor = [&] {
+    builder.create<sv::PAssignOp>(uLoc, wrPtrReg.getResult(), cPtrZero);
+    builder.create<sv::PAssignOp>(uLoc, rdPtrReg.getResult(), cPtrZero);
+    builder.create<sv::PAssignOp>(uLoc, countReg.getResult(), cCountZero);
+  };
+  builder.create<sv::AlwaysFFOp>(uLoc, sv::EventControl::AtPosEdge, clk,
+                                 ResetType::SyncReset,
+                                 sv::EventControl::AtPosEdge, reset, bodyCtor,
+                                 resetCtor);
+
+  auto *oldOutputOp = fifoModule.getBodyBlock()->getTerminator();
+  builder.create<hw::OutputOp>(uLoc,
+                               SmallVector<Value>({wrReady, rdData, rdValid}));
+  oldOutputOp->erase();
+  return fifoModule;
+}
+
 Value getClkFromHWModule(hw::HWModuleOp op) {
   auto idxClk = op.getBodyBlock()->getNumArguments() - 2;
   return op.getBodyBlock()->getArguments()[idxClk];
@@ -308,3 +466,71 @@ Value getResetFromHWModule(hw::HWModuleOp op) {
   auto idxReset = op.getBodyBlock()->getNumArguments() - 1;
   return op.getBodyBlock()->getArguments()[idxReset];
 }
+
+namespace {
+/// A (select, value) pair of a priority mux chain, or of a subtree of it.
+struct MuxTreeNode {
+  Value select;
+  Value value;
+};
+} // namespace
+
+/// Builds the balanced equivalent of a priority mux chain. The value of the
+/// first half wins if any of its selects is set.
+static MuxTreeNode buildMuxTree(OpBuilder &builder,
+                                ArrayRef<MuxTreeNode> chain) {
+  if (chain.size() == 1)
+    return chain.front();
+  auto uLoc = builder.getUnknownLoc();
+  auto left = buildMuxTree(builder, chain.take_front(chain.size() / 2));
+  auto right = buildMuxTree(builder, chain.drop_front(chain.size() / 2));
+  Value const value =
+      builder.create<comb::MuxOp>(uLoc, left.select, left.value, right.value);
+  Value const select =
+      builder.create<comb::OrOp>(uLoc, left.select, right.select);
+  return {select, value};
+}
+
+/// Multiple drivers of a bus (memref ports, shared instances, buses with many
+/// sends) are lowered to chains of muxes, one per driver, whose depth grows
+/// linearly. Replaces each chain that is at least minChainLength long with a
+/// tree of logarithmic depth that keeps the same priority.
+void balanceMuxChains(hw::HWModuleOp op, size_t minChainLength) {
+  auto isChainLink = [](Operation *operation) {
+    auto muxOp = dyn_cast_or_null<comb::MuxOp>(operation);
+    if (!muxOp || !muxOp.getResult().hasOneUse())
+      return false;
+    auto &use = *muxOp.getResult().use_begin();
+    return isa<comb::MuxOp>(use.getOwner()) && use.getOperandNumber() == 2;
+  };
+
+  SmallVector<comb::MuxOp> heads;
+  op.walk([&](comb::MuxOp muxOp) {
+    if (!isChainLink(muxOp))
+      heads.push_back(muxOp);
+  });
+
+  for (auto head : heads) {
+    SmallVector<MuxTreeNode> chain;
+    SmallVector<Operation *> links;
+    Value tail = head.getResult();
+    while (auto muxOp = dyn_cast_or_null<comb::MuxOp>(tail.getDefiningOp())) {
+      if (muxOp != head && !isChainLink(muxOp))
+        break;
+      chain.push_back({muxOp.cond(), muxOp.trueValue()});
+      links.push_back(muxOp);
+      tail = muxOp.falseValue();
+    }
+    if (chain.size() < minChainLength)
+      continue;
+
+    OpBuilder builder(head);
+    auto tree = buildMuxTree(builder, chain);
+    auto root = builder.create<comb::MuxOp>(builder.getUnknownLoc(),
+                                            tree.select, tree.value, tail);
+    root->setAttrs(head->getAttrs());
+    head.getResult().replaceAllUsesWith(root.getResult());
+    for (auto *link : links)
+      link->erase();
+  }
+}
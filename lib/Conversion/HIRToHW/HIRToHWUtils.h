@@ -10,23 +10,25 @@ using namespace circt;
 class FuncToHWModulePortMap {
 public:
   void addFuncInput(StringAttr name, hw::PortDirection direction, Type type);
+  void addFifoFuncInput(OpBuilder &, StringAttr name, bool isSend, Type type);
   void addFuncResult(StringAttr name, Type type);
   void addClk(OpBuilder &);
   void addReset(OpBuilder &);
   ArrayRef<hw::PortInfo> getPortInfoList();
   const hw::PortInfo getPortInfoForFuncInput(size_t inputArgNum);
+  /// The data, valid and ready ports of a fifo input, in that order.
+  ArrayRef<hw::PortInfo> getFifoPortsForFuncInput(size_t inputArgNum);
 
 private:
   size_t hwModuleInputArgNum = 0;
   size_t hwModuleResultArgNum = 0;
   SmallVector<hw::PortInfo> portInfoList;
   SmallVector<hw::PortInfo> mapFuncInputToHWPortInfo;
+  DenseMap<size_t, SmallVector<hw::PortInfo, 3>> mapFuncInputToFifoPorts;
 };
 
 bool isRecvBus(DictionaryAttr busAttr);
-
-std::pair<SmallVector<Value>, SmallVector<Value>>
-filterCallOpArgs(hir::FuncType funcTy, OperandRange args);
+bool isSendBus(DictionaryAttr busAttr);
 
 FuncToHWModulePortMap getHWModulePortMap(OpBuilder &builder,
                                          mlir::Location errorLoc,
@@ -53,8 +55,14 @@ SmallVector<Value> insertBusMapLogic(OpBuilder &builder, Block &bodyBlock,
 
 Value insertConstArrayGetLogic(OpBuilder &builder, Value arr, int idx);
 
+Value getFifoOpActiveSignal(OpBuilder &builder, Value start, Value handshake,
+                            Value clk, Value reset);
+hw::HWModuleOp emitFifoHWModule(OpBuilder &builder, StringRef name,
+                                Type dataTy, int64_t depth);
+
 Value getClkFromHWModule(hw::HWModuleOp op);
 Value getResetFromHWModule(hw::HWModuleOp op);
+void balanceMuxChains(hw::HWModuleOp op, size_t minChainLength);
 
 class HIRToHWMapping {
 private:
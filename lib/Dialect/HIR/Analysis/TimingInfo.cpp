@@ -1,6 +1,7 @@
 #include "circt/Dialect/HIR/Analysis/TimingInfo.h"
 #include "circt/Dialect/Comb/CombDialect.h"
 #include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
 #include "circt/Dialect/HW/HWOps.h"
 #include "mlir/Dialect/Arithmetic/IR/Arithmetic.h"
 
@@ -10,12 +11,35 @@ using namespace hir;
 //-----------------------------------------------------------------------------
 // EquivalentTimeMap class methods.
 //-----------------------------------------------------------------------------
+std::pair<Value, int64_t> EquivalentTimeMap::getRootAndOffset(Value timeVar) {
+  auto it = mapTimeVarToRootAndOffset.find(timeVar);
+  if (it == mapTimeVarToRootAndOffset.end())
+    return std::make_pair(timeVar, 0);
+  return it->second;
+}
+
 void EquivalentTimeMap::registerEquivalentTime(Value timeVar, Time time) {
   assert(timeVar.getType().isa<hir::TimeType>());
   if (time.getTimeVar() == timeVar)
     return;
-  mapTimeVarToOffsetAndEquivalentTimeVar[time.getTimeVar()].push_back(
-      std::make_pair(time.getOffset(), timeVar));
+  assert(mapTimeVarToRootAndOffset.find(timeVar) ==
+         mapTimeVarToRootAndOffset.end());
+
+  // Every node points directly to the root, so the lookup is O(1).
+  auto rootAndOffset = getRootAndOffset(time.getTimeVar());
+  Value root = rootAndOffset.first;
+  int64_t offset = rootAndOffset.second + time.getOffset();
+  mapTimeVarToRootAndOffset[timeVar] = std::make_pair(root, offset);
+
+  // Keep the members sorted by offset. Time vars are registered in lexical
+  // order, so members with the same offset stay in lexical order.
+  auto &members = mapRootToSortedMembers[root];
+  Member member{offset, getLexicalOrder(timeVar), timeVar};
+  auto *pos = llvm::upper_bound(members, member,
+                                [](const Member &lhs, const Member &rhs) {
+                                  return lhs.offset < rhs.offset;
+                                });
+  members.insert(pos, member);
 }
 
 unsigned int EquivalentTimeMap::getLexicalOrder(ScheduledOp op) {
@@ -30,30 +54,38 @@ unsigned int EquivalentTimeMap::getLexicalOrder(Value op) {
 
 Time EquivalentTimeMap::getEquivalentTimeWithSmallerOffset(ScheduledOp op) {
   auto time = op.getStartTime();
-  auto equivalentTimeVarForDifferentOffsets =
-      mapTimeVarToOffsetAndEquivalentTimeVar[time.getTimeVar()];
-
-  // Search for the closest timevar equivalent to time.
-  int64_t offset = 0;
-  Value newTimeVar;
-  for (std::pair<int64_t, Value> offsetAndEquivalentTimeVar :
-       equivalentTimeVarForDifferentOffsets) {
-    if (offsetAndEquivalentTimeVar.first < offset)
-      continue;
-    if (offsetAndEquivalentTimeVar.first > time.getOffset())
+  auto rootAndOffset = getRootAndOffset(time.getTimeVar());
+  auto membersIter = mapRootToSortedMembers.find(rootAndOffset.first);
+  if (membersIter == mapRootToSortedMembers.end())
+    return time;
+
+  // Any member with offset in [minOffset, maxOffset] (relative to the root)
+  // gives an equivalent time with an offset no larger than the original one.
+  int64_t minOffset = rootAndOffset.second;
+  int64_t maxOffset = minOffset + time.getOffset();
+  auto &members = membersIter->second;
+  auto *it = llvm::upper_bound(members, maxOffset,
+                               [](int64_t offset, const Member &member) {
+                                 return offset < member.offset;
+                               });
+
+  // Search for the closest timevar equivalent to time. It must be defined
+  // before the op and in a region that encloses the op.
+  auto opLexicalOrder = getLexicalOrder(op);
+  auto *opRegion = op->getParentRegion();
+  while (it != members.begin()) {
+    --it;
+    if (it->offset < minOffset)
+      break;
+    if (opLexicalOrder <= it->lexicalOrder)
       continue;
-    if (getLexicalOrder(op) <=
-        getLexicalOrder(offsetAndEquivalentTimeVar.second))
+    if (!it->timeVar.getParentRegion()->isAncestor(opRegion))
       continue;
-    offset = offsetAndEquivalentTimeVar.first;
-    newTimeVar = offsetAndEquivalentTimeVar.second;
+    return Time(it->timeVar, maxOffset - it->offset);
   }
 
   // If no equivalent timevar is found then return the original time.
-  if (!newTimeVar)
-    return time;
-
-  return Time(newTimeVar, time.getOffset() - offset);
+  return time;
 }
 
 //-----------------------------------------------------------------------------
@@ -62,6 +94,16 @@ Time EquivalentTimeMap::getEquivalentTimeWithSmallerOffset(ScheduledOp op) {
 
 TimingInfo::TimingInfo(FuncOp op)
     : equivalentTimeMap(mapOpToLexicalOrder), currentLexicalPos(0) {
+  // Arguments are valid 'delay' cycles after the start of the function.
+  auto funcTy = op.getFuncType();
+  auto args = op.getFuncBody().getArguments();
+  for (size_t i = 0; i < funcTy.getNumInputs(); i++)
+    if (helper::isBuiltinSizedType(args[i].getType()))
+      registerValue(
+          args[i],
+          Time(op.getRegionTimeVar(),
+               helper::getHIRDelayAttr(funcTy.getInputAttrs()[i]).value_or(0)));
+
   auto walkResult =
       op.walk<mlir::WalkOrder::PreOrder>([this](Operation *operation) {
         if (auto scheduledOp = dyn_cast<ScheduledOp>(operation)) {
@@ -75,6 +117,9 @@ TimingInfo::TimingInfo(FuncOp op)
                        dyn_cast<mlir::arith::ConstantOp>(operation)) {
           if (failed(visitOp(arithConstantOp)))
             return WalkResult::interrupt();
+        } else if (isa<comb::CombDialect>(operation->getDialect())) {
+          if (failed(visitCombOp(operation)))
+            return WalkResult::interrupt();
         }
         return WalkResult::advance();
       });
@@ -106,6 +151,44 @@ LogicalResult TimingInfo::visitOp(ScheduledOp op) {
         registerValue(result, *time);
     }
   }
+  // Loop body arguments are valid at the start of the iteration, or
+  // 'iter_arg_delays' cycles after it.
+  if (isa<hir::ForOp, hir::WhileOp>(op.getOperation())) {
+    auto &body = op->getRegion(0).front();
+    auto delays = op->getAttrOfType<ArrayAttr>("iter_arg_delays");
+    for (auto arg : body.getArguments()) {
+      if (!helper::isBuiltinSizedType(arg.getType()))
+        continue;
+      int64_t delay = 0;
+      if (delays && arg.getArgNumber() < delays.size())
+        delay = delays[arg.getArgNumber()].cast<IntegerAttr>().getInt();
+      registerValue(arg, Time(body.getArguments().back(), delay));
+    }
+  }
+  // Inside a hir.if the region time var is the start time of the if, gated by
+  // the condition. It is not an equivalent time var, since ops retimed onto the
+  // ungated start time would run whatever the condition is.
+  if (auto ifOp = dyn_cast<hir::IfOp>(op.getOperation())) {
+    Time const time(ifOp.tstart(), ifOp.offset());
+    mapRegionTimeVarToTime[ifOp.if_region().getArgument(0)] = time;
+    mapRegionTimeVarToTime[ifOp.else_region().getArgument(0)] = time;
+  }
+  return success();
+}
+
+/// Comb ops are combinational, so the results are valid at the time of the
+/// non-constant operands. Comb ops on constants give constants.
+LogicalResult TimingInfo::visitCombOp(Operation *operation) {
+  for (auto operand : operation->getOperands()) {
+    if (isAlwaysValid(operand))
+      continue;
+    if (auto time = getTime(operand))
+      for (auto result : operation->getResults())
+        mapValueToTime[result] = *time;
+    return success();
+  }
+  for (auto result : operation->getResults())
+    setOfConstants.insert(result);
   return success();
 }
 
@@ -122,9 +205,24 @@ LogicalResult TimingInfo::visitOp(mlir::arith::ConstantOp op) {
 bool TimingInfo::isValidAtTime(Value v, hir::Time time) {
   if (isAlwaysValid(v))
     return true;
-  if (time == getTime(v))
+  auto validTime = getTime(v);
+  if (!validTime)
+    return false;
+  if (time == *validTime)
     return true;
-  return false;
+  // The two times may use different, but equivalent, time vars. A value
+  // defined outside a hir.if is also valid inside its regions.
+  return getUngatedRootTime(time) == getUngatedRootTime(*validTime);
+}
+
+Time TimingInfo::getUngatedRootTime(Time time) {
+  time = getRootTime(time);
+  auto it = mapRegionTimeVarToTime.find(time.getTimeVar());
+  while (it != mapRegionTimeVarToTime.end()) {
+    time = getRootTime(it->second.addOffset(time.getOffset()));
+    it = mapRegionTimeVarToTime.find(time.getTimeVar());
+  }
+  return time;
 }
 
 bool TimingInfo::isAlwaysValid(Value v) {
@@ -133,12 +231,18 @@ bool TimingInfo::isAlwaysValid(Value v) {
   return false;
 }
 
-Time TimingInfo::getTime(Value v) {
+Optional<Time> TimingInfo::getTime(Value v) {
   auto timeIter = mapValueToTime.find(v);
-  assert(timeIter != mapValueToTime.end());
+  if (timeIter == mapValueToTime.end())
+    return llvm::None;
   return timeIter->second;
 }
 
 Time TimingInfo::getOptimizedTime(hir::ScheduledOp op) {
   return equivalentTimeMap.getEquivalentTimeWithSmallerOffset(op);
-}
\ No newline at end of file
+}
+
+Time TimingInfo::getRootTime(Time time) {
+  auto rootAndOffset = equivalentTimeMap.getRootAndOffset(time.getTimeVar());
+  return Time(rootAndOffset.first, rootAndOffset.second + time.getOffset());
+}
@@ -68,6 +68,40 @@ struct HIRInlinerInterface : public mlir::DialectInlinerInterface {
       valuesToRepl[it.index()].replaceAllUsesWith(it.value());
   }
 };
+
+/// Large unrolled designs repeat the same callee types and memref port
+/// descriptions thousands of times. Printing them once as aliases keeps the
+/// textual IR small and lets the parser build each of them only once.
+struct HIROpAsmDialectInterface : public mlir::OpAsmDialectInterface {
+  using mlir::OpAsmDialectInterface::OpAsmDialectInterface;
+
+  AliasResult getAlias(Type type, raw_ostream &os) const override {
+    if (type.isa<hir::FuncType>()) {
+      os << "hir_func";
+      return AliasResult::OverridableAlias;
+    }
+    return AliasResult::NoAlias;
+  }
+
+  /// Memref ports are named after their latencies, e.g. `#port_r1_w1`.
+  AliasResult getAlias(Attribute attr, raw_ostream &os) const override {
+    auto dict = attr.dyn_cast<DictionaryAttr>();
+    if (!dict || dict.empty())
+      return AliasResult::NoAlias;
+    for (auto namedAttr : dict)
+      if ((namedAttr.getName() != "rd_latency" &&
+           namedAttr.getName() != "wr_latency") ||
+          !namedAttr.getValue().isa<IntegerAttr>())
+        return AliasResult::NoAlias;
+
+    os << "port";
+    if (auto rdLatency = dict.getAs<IntegerAttr>("rd_latency"))
+      os << "_r" << rdLatency.getInt();
+    if (auto wrLatency = dict.getAs<IntegerAttr>("wr_latency"))
+      os << "_w" << wrLatency.getInt();
+    return AliasResult::OverridableAlias;
+  }
+};
 } // end anonymous namespace
 
 //-----------------------------------------------------------------------------
@@ -96,7 +130,7 @@ void HIRDialect::initialize() {
 #include "circt/Dialect/HIR/IR/HIRAttrs.cpp.inc"
       >();
 
-  addInterfaces<HIRInlinerInterface>();
+  addInterfaces<HIRInlinerInterface, HIROpAsmDialectInterface>();
 }
 
 Operation *HIRDialect::materializeConstant(OpBuilder &builder, Attribute value,
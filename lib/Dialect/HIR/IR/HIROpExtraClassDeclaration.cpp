@@ -270,6 +270,12 @@ hir::Time hir::BusSendOp::getStartTime() {
 hir::Time hir::BusRecvOp::getStartTime() {
   return hir::Time(tstart(), offset());
 }
+hir::Time hir::FifoSendOp::getStartTime() {
+  return hir::Time(tstart(), offset());
+}
+hir::Time hir::FifoRecvOp::getStartTime() {
+  return hir::Time(tstart(), offset());
+}
 
 void CallOp::setStartTime(hir::Time time) {
   this->tstartMutable().assign(time.getTimeVar());
@@ -335,6 +341,16 @@ void BusRecvOp::setStartTime(hir::Time time) {
   this->offsetAttr(IntegerAttr::get(IntegerType::get(this->getContext(), 64),
                                     time.getOffset()));
 }
+void FifoSendOp::setStartTime(hir::Time time) {
+  this->tstartMutable().assign(time.getTimeVar());
+  this->offsetAttr(IntegerAttr::get(IntegerType::get(this->getContext(), 64),
+                                    time.getOffset()));
+}
+void FifoRecvOp::setStartTime(hir::Time time) {
+  this->tstartMutable().assign(time.getTimeVar());
+  this->offsetAttr(IntegerAttr::get(IntegerType::get(this->getContext(), 64),
+                                    time.getOffset()));
+}
 
 SmallVector<std::pair<Value, Optional<hir::Time>>, 4>
 CallOp::getResultsWithTime() {
@@ -346,7 +362,11 @@ CallOp::getResultsWithTime() {
     if (helper::isBuiltinSizedType(resTy)) {
       DictionaryAttr attrDict = funcTy.getResultAttrs()[i];
       uint64_t delay = helper::getHIRDelayAttr(attrDict).getValue();
-      Time time = this->getStartTime().addOffset(delay);
+      // Results of a dynamic-latency callee are valid relative to its done
+      // time instead of the start time.
+      auto delayFrom = helper::getHIRDelayFromAttr(attrDict);
+      Time time = delayFrom ? Time(this->getResult(delayFrom.getValue()), delay)
+                            : this->getStartTime().addOffset(delay);
       output.push_back(std::make_pair(res, time));
     } else if (resTy.isa<TimeType>()) {
       Time time = Time(res, 0);
@@ -482,6 +502,24 @@ BusRecvOp::getResultsWithTime() {
   return output;
 }
 
+// The handshake completes at a dynamic time, so t_done is a new root time var.
+SmallVector<std::pair<Value, Optional<hir::Time>>, 4>
+FifoSendOp::getResultsWithTime() {
+  SmallVector<std::pair<Value, Optional<hir::Time>>, 4> output;
+  output.push_back(
+      std::make_pair(this->t_done(), hir::Time(this->t_done(), 0)));
+  return output;
+}
+
+SmallVector<std::pair<Value, Optional<hir::Time>>, 4>
+FifoRecvOp::getResultsWithTime() {
+  SmallVector<std::pair<Value, Optional<hir::Time>>, 4> output;
+  output.push_back(std::make_pair(this->res(), hir::Time(this->t_done(), 0)));
+  output.push_back(
+      std::make_pair(this->t_done(), hir::Time(this->t_done(), 0)));
+  return output;
+}
+
 // ScheduledRegionOp interface.
 SmallVector<Value> ForOp::getRegionTimeVars() {
   SmallVector<Value> regionTimeVars;
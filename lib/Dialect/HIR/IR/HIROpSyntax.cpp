@@ -21,6 +21,13 @@ static ParseResult parseDelayAttr(OpAsmParser &parser,
     if (parser.parseAttribute(delayAttr, IntegerType::get(context, 64),
                               "hir.delay", argAttrs))
       return failure();
+    // Dynamic-latency result: the delay counts from a !hir.time result.
+    if (succeeded(parser.parseOptionalKeyword("from"))) {
+      IntegerAttr delayFromAttr;
+      if (parser.parseAttribute(delayFromAttr, IntegerType::get(context, 64),
+                                "hir.delay_from", argAttrs))
+        return failure();
+    }
     attrsList.push_back(DictionaryAttr::get(context, argAttrs));
   } else {
     attrsList.push_back(helper::getDictionaryAttr(
@@ -751,7 +758,7 @@ ParseResult parseArgList(OpAsmParser &parser,
       } else if (arg.type.isa<hir::MemrefType>()) {
         if (parseMemrefPortsAttr(parser, argAttrs))
           return failure();
-      } else if (helper::isBusLikeType(arg.type)) {
+      } else if (helper::isChannelType(arg.type)) {
         if (parseBusPortsAttr(parser, argAttrs))
           return failure();
       } else
@@ -890,9 +897,11 @@ static void printArgList(OpAsmPrinter &printer, ArrayRef<BlockArgument> args,
       auto delay = helper::getHIRDelayAttr(argAttrs[i]);
       if (delay)
         printer << " delay " << delay;
+      if (auto delayFrom = helper::getHIRDelayFromAttr(argAttrs[i]))
+        printer << " from " << delayFrom.getValue();
     } else if (argTypes[i].isa<hir::MemrefType>()) {
       printer << " ports " << helper::extractMemrefPortsFromDict(argAttrs[i]);
-    } else if (helper::isBusLikeType(argTypes[i])) {
+    } else if (helper::isChannelType(argTypes[i])) {
       printer << " ports [" << helper::extractBusPortFromDict(argAttrs[i])
               << "]";
     }
@@ -914,9 +923,11 @@ static void printArgList(OpAsmPrinter &printer, ArrayAttr argNames,
       auto delay = helper::getHIRDelayAttr(argAttrs[i]);
       if (delay)
         printer << " delay " << delay;
+      if (auto delayFrom = helper::getHIRDelayFromAttr(argAttrs[i]))
+        printer << " from " << delayFrom.getValue();
     } else if (argTypes[i].isa<hir::MemrefType>()) {
       printer << " ports " << helper::extractMemrefPortsFromDict(argAttrs[i]);
-    } else if (helper::isBusLikeType(argTypes[i])) {
+    } else if (helper::isChannelType(argTypes[i])) {
       printer << " ports [" << helper::extractBusPortFromDict(argAttrs[i])
               << "]";
     }
@@ -1159,6 +1170,86 @@ void BusTensorMapOp::print(OpAsmPrinter &printer) {
   printer.printRegion(this->body(), false, true);
 }
 
+/// FifoSendOp parser and printer
+/// Example:
+/// %t_done = hir.fifo.send %v to %f at %t + 1 : !hir.fifo<i32, 4>
+ParseResult FifoSendOp::parse(OpAsmParser &parser, OperationState &result) {
+  OpAsmParser::UnresolvedOperand value;
+  OpAsmParser::UnresolvedOperand fifo;
+  OpAsmParser::UnresolvedOperand tstart;
+  IntegerAttr offsetAttr;
+  hir::FifoType fifoTy;
+  auto *context = parser.getBuilder().getContext();
+
+  if (parser.parseOperand(value) || parser.parseKeyword("to") ||
+      parser.parseOperand(fifo) || parser.parseKeyword("at") ||
+      parseTimeAndOffset(parser, tstart, offsetAttr))
+    return failure();
+
+  if (parseWithSSANames(parser, result.attributes))
+    return failure();
+
+  if (parser.parseColon() || parser.parseType(fifoTy))
+    return failure();
+
+  if (parser.resolveOperand(value, fifoTy.getElementType(),
+                            result.operands) ||
+      parser.resolveOperand(fifo, fifoTy, result.operands) ||
+      parser.resolveOperand(tstart, TimeType::get(context), result.operands))
+    return failure();
+
+  result.addAttribute("offset", offsetAttr);
+  result.addTypes(TimeType::get(context));
+  return success();
+}
+
+void FifoSendOp::print(OpAsmPrinter &printer) {
+  printer << " " << this->value() << " to " << this->fifo() << " at ";
+  printTimeAndOffset(printer, this->getOperation(), this->tstart(),
+                     this->offsetAttr());
+  printWithSSANames(printer, this->getOperation(),
+                    this->getOperation()->getAttrDictionary());
+  printer << " : " << this->fifo().getType();
+}
+
+/// FifoRecvOp parser and printer
+/// Example:
+/// %v, %t_done = hir.fifo.recv %f at %t + 1 : !hir.fifo<i32, 4>
+ParseResult FifoRecvOp::parse(OpAsmParser &parser, OperationState &result) {
+  OpAsmParser::UnresolvedOperand fifo;
+  OpAsmParser::UnresolvedOperand tstart;
+  IntegerAttr offsetAttr;
+  hir::FifoType fifoTy;
+  auto *context = parser.getBuilder().getContext();
+
+  if (parser.parseOperand(fifo) || parser.parseKeyword("at") ||
+      parseTimeAndOffset(parser, tstart, offsetAttr))
+    return failure();
+
+  if (parseWithSSANames(parser, result.attributes))
+    return failure();
+
+  if (parser.parseColon() || parser.parseType(fifoTy))
+    return failure();
+
+  if (parser.resolveOperand(fifo, fifoTy, result.operands) ||
+      parser.resolveOperand(tstart, TimeType::get(context), result.operands))
+    return failure();
+
+  result.addAttribute("offset", offsetAttr);
+  result.addTypes({fifoTy.getElementType(), TimeType::get(context)});
+  return success();
+}
+
+void FifoRecvOp::print(OpAsmPrinter &printer) {
+  printer << " " << this->fifo() << " at ";
+  printTimeAndOffset(printer, this->getOperation(), this->tstart(),
+                     this->offsetAttr());
+  printWithSSANames(printer, this->getOperation(),
+                    this->getOperation()->getAttrDictionary());
+  printer << " : " << this->fifo().getType();
+}
+
 LogicalResult hir::FuncExternOp::verifyType() { return success(); }
 
 LogicalResult hir::FuncOp::verifyType() {
@@ -75,41 +75,35 @@ LogicalResult FuncOp::verify() {
             .size())
       return this->emitError("Wrong number of res_attrs.");
   }
-  // Check if the port assignment of memref use is correct.
+  // Check if the port assignment of memref use is correct. The ports of each
+  // memref arg are decoded once, not once per use.
   for (uint64_t i = 0; i < this->getFuncBody().getNumArguments(); i++) {
     Value arg = this->getFuncBody().getArguments()[i];
-    if (arg.getType().isa<hir::MemrefType>()) {
-      for (auto &use : arg.getUses()) {
-        if (auto loadOp = dyn_cast<hir::LoadOp>(use.getOwner())) {
-          auto port = loadOp.port();
-          if (!port)
-            continue;
-          auto ports = helper::extractMemrefPortsFromDict(
-              this->getFuncType().getInputAttrs()[i]);
-
-          if (ports.getValue().size() <= port.getValue())
-            return use.getOwner()->emitError()
-                   << "specified port does not exist.";
-          auto loadOpPort = ports.getValue()[port.getValue()];
-          if (!helper::isMemrefRdPort(loadOpPort))
-            return use.getOwner()->emitError()
-                   << "specified port is not a read port.";
-        } else if (auto storeOp = dyn_cast<hir::StoreOp>(use.getOwner())) {
-          auto port = storeOp.port();
-          if (!port)
-            continue;
-          auto ports = helper::extractMemrefPortsFromDict(
-              this->getFuncType().getInputAttrs()[i]);
-
-          if (ports.getValue().size() <= port.getValue())
-            return use.getOwner()->emitError()
-                   << "specified port does not exist.";
-
-          auto storeOpPort = ports.getValue()[port.getValue()];
-          if (!helper::isMemrefWrPort(storeOpPort))
-            return use.getOwner()->emitError()
-                   << "specified port is not a write port.";
-        }
+    if (!arg.getType().isa<hir::MemrefType>() || arg.use_empty())
+      continue;
+    auto ports = helper::getMemrefPortInfos(
+        helper::extractMemrefPortsFromDict(inputAttrs[i]).getValue());
+    for (auto &use : arg.getUses()) {
+      if (auto loadOp = dyn_cast<hir::LoadOp>(use.getOwner())) {
+        auto port = loadOp.port();
+        if (!port)
+          continue;
+        if (ports.size() <= port.getValue())
+          return use.getOwner()->emitError()
+                 << "specified port does not exist.";
+        if (!ports[port.getValue()].isRdPort())
+          return use.getOwner()->emitError()
+                 << "specified port is not a read port.";
+      } else if (auto storeOp = dyn_cast<hir::StoreOp>(use.getOwner())) {
+        auto port = storeOp.port();
+        if (!port)
+          continue;
+        if (ports.size() <= port.getValue())
+          return use.getOwner()->emitError()
+                 << "specified port does not exist.";
+        if (!ports[port.getValue()].isWrPort())
+          return use.getOwner()->emitError()
+                 << "specified port is not a write port.";
       }
     }
   }
@@ -155,14 +149,18 @@ LogicalResult checkIndices(Location loc, OperandRange indices,
 
 LogicalResult AllocaOp::verify() {
   auto res = this->res();
-  auto ports = this->ports();
+  auto ports = helper::getMemrefPortInfos(this->ports());
   for (auto &use : res.getUses()) {
     if (auto loadOp = dyn_cast<hir::LoadOp>(use.getOwner())) {
       auto port = loadOp.port();
       if (!port)
         continue;
-      auto loadOpPort = ports[port.getValue()];
-      if (!helper::isMemrefRdPort(loadOpPort))
+      if (ports.size() <= port.getValue())
+        return use.getOwner()
+                   ->emitError("Invalid port number.")
+                   .attachNote(this->getLoc())
+               << "Memref defined here.";
+      if (!ports[port.getValue()].isRdPort())
         return use.getOwner()->emitError()
                << "specified port is not a read port.";
     } else if (auto storeOp = dyn_cast<hir::StoreOp>(use.getOwner())) {
@@ -173,13 +171,12 @@ LogicalResult AllocaOp::verify() {
         return failure();
       if (!port)
         continue;
-      if (ports.getValue().size() <= port.getValue())
+      if (ports.size() <= port.getValue())
         return use.getOwner()
                    ->emitError("Invalid port number.")
                    .attachNote(this->getLoc())
                << "Memref defined here.";
-      auto storeOpPort = ports.getValue()[port.getValue()];
-      if (!helper::isMemrefWrPort(storeOpPort))
+      if (!ports[port.getValue()].isWrPort())
         return use.getOwner()->emitError()
                << "specified port is not a write port.";
     }
@@ -190,15 +187,15 @@ LogicalResult AllocaOp::verify() {
             .dyn_cast<hir::MemrefType>()
             .getNumElementsPerBank() != 1)
       return this->emitError("'reg' must have all dims banked.");
-    if (this->ports().size() != 2)
+    if (ports.size() != 2)
       return this->emitError("'reg' must two ports, read and write.");
-    if (helper::isMemrefWrPort(this->ports()[0]))
+    if (ports[0].isWrPort())
       return this->emitError("'reg' port 0 must be read-only.");
-    if (helper::isMemrefRdPort(this->ports()[1]))
+    if (ports[1].isRdPort())
       return this->emitError("'reg' port 1 must be write-only.");
-    if (helper::getMemrefPortRdLatency(this->ports()[0]).getValue() != 0)
+    if (ports[0].rdLatency != 0)
       return this->emitError("'reg' read latency must be 0.");
-    if (helper::getMemrefPortWrLatency(this->ports()[1]).getValue() != 1)
+    if (ports[1].wrLatency != 1)
       return this->emitError("'reg' write latency must be 1.");
   } else {
     if (this->res()
@@ -498,6 +495,24 @@ LogicalResult BusTensorInsertElementOp::verify() {
   return success();
 }
 
+LogicalResult FifoSendOp::verify() {
+  auto fifoTy = this->fifo().getType().dyn_cast<hir::FifoType>();
+  if (this->value().getType() != fifoTy.getElementType())
+    return this->emitError() << "Expected value of type "
+                             << fifoTy.getElementType() << ", got "
+                             << this->value().getType();
+  return success();
+}
+
+LogicalResult FifoRecvOp::verify() {
+  auto fifoTy = this->fifo().getType().dyn_cast<hir::FifoType>();
+  if (this->res().getType() != fifoTy.getElementType())
+    return this->emitError() << "Expected result of type "
+                             << fifoTy.getElementType() << ", got "
+                             << this->res().getType();
+  return success();
+}
+
 LogicalResult IsFirstIterOp::verify() {
   auto *parentOperation = (*this)->getParentOp();
   if (auto whileOp = dyn_cast<WhileOp>(parentOperation)) {
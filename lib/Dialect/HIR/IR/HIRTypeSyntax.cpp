@@ -26,6 +26,17 @@ static Optional<DictionaryAttr> parseDelayAttr(AsmParser &parser) {
   } else {
     delayAttr = helper::getI64IntegerAttr(parser.getContext(), 0);
   }
+
+  // Dynamic-latency result: the delay counts from a !hir.time result.
+  if (succeeded(parser.parseOptionalKeyword("from"))) {
+    IntegerAttr delayFromAttr;
+    if (parser.parseAttribute(delayFromAttr, IntegerType::get(context, 64)))
+      return llvm::None;
+    NamedAttrList attrs;
+    attrs.append("hir.delay", delayAttr);
+    attrs.append("hir.delay_from", delayFromAttr);
+    return DictionaryAttr::get(context, attrs);
+  }
   return helper::getDictionaryAttr("hir.delay", delayAttr);
 }
 
@@ -67,20 +78,23 @@ static Optional<DictionaryAttr> parseArgAttr(AsmParser &parser, Type type) {
   if (type.dyn_cast<hir::MemrefType>())
     return parseMemrefPortsAttr(parser);
 
-  if (helper::isBusLikeType(type))
+  if (helper::isChannelType(type))
     return parseBusPortsAttr(parser);
 
   return helper::getDictionaryAttr(parser.getContext());
 }
 
 void printArgAttr(AsmPrinter &printer, DictionaryAttr attr, Type type) {
-  if (helper::isBuiltinSizedType(type))
+  if (helper::isBuiltinSizedType(type)) {
     printer << "delay " << helper::getHIRDelayAttr(attr);
+    if (auto delayFrom = helper::getHIRDelayFromAttr(attr))
+      printer << " from " << delayFrom.getValue();
+  }
 
   if (type.dyn_cast<hir::MemrefType>())
     printer << "ports " << helper::extractMemrefPortsFromDict(attr);
 
-  if (helper::isBusLikeType(type)) {
+  if (helper::isChannelType(type)) {
     printer << "ports [" << helper::extractBusPortFromDict(attr) << "]";
   }
 }
@@ -78,12 +78,15 @@ LogicalResult FuncType::verify(function_ref<InFlightDiagnostic()> emitError,
       if (failed(verifyDelayAttribute(emitError, inputAttrs[i])))
         return emitError() << "Expected hir.delay IntegerAttr for input arg"
                            << std::to_string(i) << ".";
+      if (helper::getHIRDelayFromAttr(inputAttrs[i]))
+        return emitError() << "Input arg" << std::to_string(i)
+                           << " can not have a dynamic delay.";
     } else if (inputTypes[i].dyn_cast<hir::MemrefType>()) {
       if (failed(verifyMemrefPortsAttribute(emitError, inputAttrs[i])))
         return emitError()
                << "Expected hir.memref.ports ArrayAttr for input arg"
                << std::to_string(i) << ".";
-    } else if (helper::isBusLikeType(inputTypes[i])) {
+    } else if (helper::isChannelType(inputTypes[i])) {
       if (failed(verifyBusPortsAttribute(emitError, inputAttrs[i])))
         return emitError() << "Expected hir.bus.ports ArrayAttr for input arg"
                            << std::to_string(i) << ".";
@@ -92,7 +95,8 @@ LogicalResult FuncType::verify(function_ref<InFlightDiagnostic()> emitError,
     } else {
       return emitError() << "Expected MLIR-builtin-type or hir::MemrefType or "
                             "hir::BusType or hir::BusTensorType or "
-                            "hir::TimeType in inputTypes, got :\n\t"
+                            "hir::FifoType or hir::TimeType in inputTypes, "
+                            "got :\n\t"
                          << inputTypes[i];
     }
   }
@@ -104,8 +108,15 @@ LogicalResult FuncType::verify(function_ref<InFlightDiagnostic()> emitError,
         return emitError() << "Expected hir.delay attribute to be an "
                               "IntegerAttr for result "
                            << std::to_string(i) << ".";
+      if (auto delayFrom = helper::getHIRDelayFromAttr(resultAttrs[i])) {
+        auto idx = delayFrom.getValue();
+        if (idx < 0 || idx >= (int64_t)resultTypes.size() ||
+            !resultTypes[idx].isa<hir::TimeType>())
+          return emitError() << "Delay of result " << std::to_string(i)
+                             << " must be counted from a !hir.time result.";
+      }
     } else if (resultTypes[i].dyn_cast<hir::TimeType>()) {
-      return success();
+      continue;
     } else {
       return emitError() << "Expected MLIR-builtin-type or hir::TimeType in "
                             "resultTypes, got :\n\t"
@@ -136,5 +147,18 @@ BusTensorType::verify(mlir::function_ref<InFlightDiagnostic()> emitError,
   return success();
 }
 
+LogicalResult
+FifoType::verify(mlir::function_ref<InFlightDiagnostic()> emitError,
+                 Type elementTy, int64_t depth) {
+  if (!helper::isBuiltinSizedType(elementTy))
+    return emitError() << "Fifo element type can only be an integer/float or a "
+                          "tuple/tensor of these types.";
+  if (depth < 2 || (pow(2, helper::clog2(depth))) != depth)
+    return emitError() << "Fifo depth must be a power of two and at least 2, "
+                          "got "
+                       << depth;
+  return success();
+}
+
 /// required for functionlike trait
 LogicalResult hir::FuncOp::verifyBody() { return success(); }
@@ -91,6 +91,10 @@ bool isBusLikeType(mlir::Type ty) {
   return (ty.isa<hir::BusType>() || ty.isa<hir::BusTensorType>());
 }
 
+bool isChannelType(mlir::Type ty) {
+  return isBusLikeType(ty) || ty.isa<hir::FifoType>();
+}
+
 TimeType getTimeType(MLIRContext *context) { return TimeType::get(context); }
 
 mlir::ParseResult parseMemrefPortsArray(mlir::DialectAsmParser &parser,
@@ -176,6 +180,15 @@ llvm::Optional<int64_t> getHIRDelayAttr(mlir::DictionaryAttr dict) {
         return intAttr.getInt();
   return llvm::None;
 }
+
+llvm::Optional<int64_t> getHIRDelayFromAttr(mlir::DictionaryAttr dict) {
+  if (!dict)
+    return llvm::None;
+  if (auto intAttr = dict.getAs<IntegerAttr>("hir.delay_from"))
+    return intAttr.getInt();
+  return llvm::None;
+}
+
 mlir::arith::ConstantOp emitConstantOp(mlir::OpBuilder &builder,
                                        int64_t value) {
   return builder.create<mlir::arith::ConstantOp>(builder.getUnknownLoc(),
@@ -232,6 +245,28 @@ bool isMemrefRdPort(Attribute port) {
   return false;
 }
 
+MemrefPortInfo getMemrefPortInfo(Attribute port) {
+  MemrefPortInfo info;
+  for (auto namedAttr : port.cast<DictionaryAttr>()) {
+    auto intAttr = namedAttr.getValue().dyn_cast<IntegerAttr>();
+    if (!intAttr)
+      continue;
+    if (namedAttr.getName().getValue() == "rd_latency")
+      info.rdLatency = intAttr.getInt();
+    else if (namedAttr.getName().getValue() == "wr_latency")
+      info.wrLatency = intAttr.getInt();
+  }
+  return info;
+}
+
+SmallVector<MemrefPortInfo> getMemrefPortInfos(ArrayAttr ports) {
+  SmallVector<MemrefPortInfo> infos;
+  infos.reserve(ports.size());
+  for (auto port : ports)
+    infos.push_back(getMemrefPortInfo(port));
+  return infos;
+}
+
 StringRef extractBusPortFromDict(mlir::DictionaryAttr dict) {
   auto ports = dict.getNamed("hir.bus.ports")
                    .getValue()
@@ -503,4 +538,107 @@ llvm::Optional<int64_t> getOptionalTimeOffset(mlir::Operation *operation) {
   return offsetAttr.getInt();
 }
 
+llvm::Optional<int64_t> getTimeOffsetFrom(mlir::Value timeVar, int64_t offset,
+                                          mlir::Value base) {
+  while (timeVar != base) {
+    auto timeOp = dyn_cast_or_null<hir::TimeOp>(timeVar.getDefiningOp());
+    if (!timeOp)
+      return llvm::None;
+    offset += timeOp.offset();
+    timeVar = timeOp.timevar();
+  }
+  return offset;
+}
+
+std::pair<mlir::Value, int64_t> splitConstantOffset(mlir::Value idx) {
+  if (auto addOp = dyn_cast_or_null<comb::AddOp>(idx.getDefiningOp())) {
+    if (addOp.inputs().size() == 2) {
+      if (auto c = getConstantIntValue(addOp.inputs()[1]))
+        return std::make_pair(addOp.inputs()[0], *c);
+      if (auto c = getConstantIntValue(addOp.inputs()[0]))
+        return std::make_pair(addOp.inputs()[1], *c);
+    }
+  }
+  if (auto subOp = dyn_cast_or_null<comb::SubOp>(idx.getDefiningOp())) {
+    if (auto c = getConstantIntValue(subOp.rhs()))
+      return std::make_pair(subOp.lhs(), -*c);
+  }
+  return std::make_pair(idx, 0);
+}
+
+/// Cycles from the start of the loop to its t_end, if the loop has constant
+/// bounds and a fixed II.
+llvm::Optional<int64_t> getStaticLatency(hir::ForOp forOp) {
+  auto nextIterOp =
+      cast<hir::NextIterOp>(forOp.getLoopBody().front().getTerminator());
+  if (nextIterOp.condition())
+    return llvm::None;
+  auto ii = getTimeOffsetFrom(nextIterOp.tstart(), nextIterOp.offset(),
+                              forOp.getIterTimeVar());
+  auto lb = getConstantIntValue(forOp.lb());
+  auto ub = getConstantIntValue(forOp.ub());
+  auto step = getConstantIntValue(forOp.step());
+  if (!ii || !lb || !ub || !step || *step <= 0 || *ub <= *lb)
+    return llvm::None;
+  return (*ub - *lb + *step - 1) / *step * *ii;
+}
+
+/// Passes `extraArgs` into the loop through iter_args that are carried
+/// unchanged, and replaces their uses inside the loop. Returns the new loop.
+hir::ForOp addLoopInvariantIterArgs(hir::ForOp forOp,
+                                    ArrayRef<Value> extraArgs, int64_t ii) {
+  OpBuilder builder(forOp);
+  auto uLoc = builder.getUnknownLoc();
+  SmallVector<Value> iterArgs(forOp.iter_args().begin(),
+                              forOp.iter_args().end());
+  auto numOldIterArgs = iterArgs.size();
+  iterArgs.append(extraArgs.begin(), extraArgs.end());
+
+  BlockAndValueMapping operandMap;
+  auto newForOp = builder.create<hir::ForOp>(
+      forOp.getLoc(), forOp.lb(), forOp.ub(), forOp.step(), iterArgs,
+      forOp.tstart(), forOp.offsetAttr(),
+      [&](OpBuilder &builder, Value iv, ArrayRef<Value> newIterArgs,
+          Value tLoopBody) {
+        Block &body = forOp.getLoopBody().front();
+        for (size_t i = 0; i < numOldIterArgs; i++)
+          operandMap.map(body.getArgument(i), newIterArgs[i]);
+        for (size_t i = 0; i < extraArgs.size(); i++)
+          operandMap.map(extraArgs[i], newIterArgs[numOldIterArgs + i]);
+        operandMap.map(forOp.getInductionVar(), iv);
+        operandMap.map(forOp.getIterTimeVar(), tLoopBody);
+        for (auto &operation : body)
+          if (!isa<hir::NextIterOp>(operation))
+            builder.clone(operation, operandMap);
+
+        auto nextIterOp = cast<hir::NextIterOp>(body.getTerminator());
+        SmallVector<Value> nextIterArgs;
+        for (auto arg : nextIterOp.iter_args())
+          nextIterArgs.push_back(lookupOrOriginal(operandMap, arg));
+        for (auto arg : newIterArgs.drop_front(numOldIterArgs))
+          nextIterArgs.push_back(builder.create<hir::DelayOp>(
+              uLoc, arg.getType(), arg, builder.getI64IntegerAttr(ii),
+              tLoopBody, builder.getI64IntegerAttr(0)));
+        return builder.create<hir::NextIterOp>(
+            nextIterOp.getLoc(), Value(), nextIterArgs,
+            lookupOrOriginal(operandMap, nextIterOp.tstart()),
+            nextIterOp.offsetAttr());
+      });
+
+  for (auto attr : forOp->getAttrs())
+    newForOp->setAttr(attr.getName(), attr.getValue());
+  SmallVector<int64_t> iterArgDelays;
+  if (auto delays = forOp.iter_arg_delays())
+    for (auto delay : delays.getValue())
+      iterArgDelays.push_back(delay.cast<IntegerAttr>().getInt());
+  iterArgDelays.resize(iterArgs.size(), 0);
+  newForOp->setAttr("iter_arg_delays", builder.getI64ArrayAttr(iterArgDelays));
+
+  for (size_t i = 0; i < numOldIterArgs; i++)
+    forOp.getResult(i).replaceAllUsesWith(newForOp.getResult(i));
+  forOp.t_end().replaceAllUsesWith(newForOp.t_end());
+  forOp.erase();
+  return newForOp;
+}
+
 } // namespace helper
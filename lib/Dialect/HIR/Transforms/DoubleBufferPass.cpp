@@ -0,0 +1,314 @@
+//=========- DoubleBufferPass.cpp - Ping-pong buffers between loops---===//
+//
+// This file implements double buffering of local memrefs. In a loop whose
+// body runs a producer loop that writes a hir.alloca buffer followed by a
+// consumer loop that reads it, the buffer gets a second copy selected by the
+// parity of the outer iteration. The next outer iteration (and its producer)
+// can then start while the consumer of the current one is still reading.
+// The loops may be chained on each other's t_end or, as AffineToHIR emits
+// them, scheduled at static offsets from the outer iteration's start.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "llvm/ADT/DenseSet.h"
+
+using namespace circt;
+namespace {
+
+class DoubleBufferPass : public hir::DoubleBufferBase<DoubleBufferPass> {
+public:
+  void runOnOperation() override;
+};
+} // end anonymous namespace
+
+static bool isConstantOp(Operation *operation) {
+  return isa<hw::ConstantOp, mlir::arith::ConstantOp>(operation);
+}
+
+/// Memrefs and channels used inside the loop.
+static llvm::DenseSet<Value> getSharedResources(hir::ForOp forOp) {
+  llvm::DenseSet<Value> resources;
+  forOp.walk([&resources](Operation *operation) {
+    for (auto operand : operation->getOperands())
+      if (operand.getType().isa<hir::MemrefType>() ||
+          helper::isChannelType(operand.getType()))
+        resources.insert(operand);
+  });
+  return resources;
+}
+
+/// Port of a load or store, port 0 if it is not given.
+static int64_t getAccessPort(Operation *operation) {
+  if (auto loadOp = dyn_cast<hir::LoadOp>(operation))
+    return loadOp.port().value_or(0);
+  return cast<hir::StoreOp>(operation).port().value_or(0);
+}
+
+/// Producer N+1 writes the buffer while consumer N reads it, so the two loops
+/// must use different ports of it.
+static bool usesSharedPort(hir::AllocaOp allocaOp, hir::ForOp producerOp) {
+  llvm::DenseSet<int64_t> producerPorts;
+  llvm::DenseSet<int64_t> consumerPorts;
+  for (auto *user : allocaOp.getResult().getUsers()) {
+    if (producerOp->isAncestor(user))
+      producerPorts.insert(getAccessPort(user));
+    else
+      consumerPorts.insert(getAccessPort(user));
+  }
+  return llvm::any_of(consumerPorts,
+                      [&](int64_t port) { return producerPorts.count(port); });
+}
+
+/// Buffers written by the producer and only read by the consumer.
+static SmallVector<hir::AllocaOp> findBuffers(hir::ForOp producerOp,
+                                              hir::ForOp consumerOp) {
+  SmallVector<hir::AllocaOp> buffers;
+  llvm::DenseSet<Operation *> visited;
+  producerOp.walk([&](hir::StoreOp storeOp) {
+    auto allocaOp = storeOp.mem().getDefiningOp<hir::AllocaOp>();
+    if (!allocaOp || !visited.insert(allocaOp).second)
+      return;
+    bool isConsumed = false;
+    for (auto *user : allocaOp.getResult().getUsers()) {
+      if (producerOp->isAncestor(user))
+        continue;
+      if (!consumerOp->isAncestor(user) || !isa<hir::LoadOp>(user))
+        return;
+      isConsumed = true;
+    }
+    if (isConsumed && !usesSharedPort(allocaOp, producerOp))
+      buffers.push_back(allocaOp);
+  });
+  return buffers;
+}
+
+static LogicalResult insertDoubleBuffer(hir::ForOp outerOp) {
+  Block &outerBody = outerOp.getLoopBody().front();
+  if (!outerOp.iter_args().empty())
+    return failure();
+  auto outerIVTy = outerOp.getInductionVar().getType().dyn_cast<IntegerType>();
+  auto outerLb = helper::getConstantIntValue(outerOp.lb());
+  auto outerStep = helper::getConstantIntValue(outerOp.step());
+  if (!outerIVTy || !outerLb || !outerStep || *outerStep <= 0 ||
+      !llvm::isPowerOf2_64(*outerStep) ||
+      llvm::Log2_64(*outerStep) >= outerIVTy.getWidth())
+    return failure();
+
+  // The outer body must be a producer loop followed by a consumer loop, plus
+  // combinational logic and shift registers of the outer iteration's values.
+  SmallVector<hir::ForOp, 2> loops;
+  for (auto &operation : outerBody) {
+    if (auto forOp = dyn_cast<hir::ForOp>(operation))
+      loops.push_back(forOp);
+    else if (auto delayOp = dyn_cast<hir::DelayOp>(operation)) {
+      if (delayOp.tstart() != outerOp.getIterTimeVar())
+        return failure();
+    } else if (!isa<hir::NextIterOp, hir::TimeOp>(operation) &&
+               !isConstantOp(&operation) &&
+               !isa_and_nonnull<comb::CombDialect>(operation.getDialect()))
+      return failure();
+  }
+  if (loops.size() != 2)
+    return failure();
+  hir::ForOp producerOp = loops[0];
+  hir::ForOp consumerOp = loops[1];
+  auto outerNextIterOp = cast<hir::NextIterOp>(outerBody.getTerminator());
+  if (outerNextIterOp.condition())
+    return failure();
+
+  auto producerLatency = helper::getStaticLatency(producerOp);
+  auto consumerLatency = helper::getStaticLatency(consumerOp);
+  auto producerStart = helper::getTimeOffsetFrom(
+      producerOp.tstart(), producerOp.offset(), outerOp.getIterTimeVar());
+  if (!producerLatency || !consumerLatency || !producerStart)
+    return failure();
+
+  // The consumer and the next outer iteration are either chained on the end
+  // of the previous loop or, as AffineToHIR schedules them, at static offsets
+  // from the start of the outer iteration.
+  int64_t const producerEnd = *producerStart + *producerLatency;
+  auto consumerStart = helper::getTimeOffsetFrom(
+      consumerOp.tstart(), consumerOp.offset(), producerOp.t_end());
+  if (!consumerStart)
+    if (auto start = helper::getTimeOffsetFrom(
+            consumerOp.tstart(), consumerOp.offset(), outerOp.getIterTimeVar()))
+      consumerStart = *start - producerEnd;
+  if (!consumerStart || *consumerStart < 0)
+    return failure();
+  int64_t const consumerEnd = producerEnd + *consumerStart + *consumerLatency;
+  auto tailGap = helper::getTimeOffsetFrom(
+      outerNextIterOp.tstart(), outerNextIterOp.offset(), consumerOp.t_end());
+  if (!tailGap)
+    if (auto outerII = helper::getTimeOffsetFrom(outerNextIterOp.tstart(),
+                                                 outerNextIterOp.offset(),
+                                                 outerOp.getIterTimeVar()))
+      tailGap = *outerII - consumerEnd;
+  if (!tailGap || *tailGap < 0)
+    return failure();
+
+  auto buffers = findBuffers(producerOp, consumerOp);
+  if (buffers.empty())
+    return failure();
+
+  // While the two loops overlap they must not compete for anything but the
+  // buffers, which now have a copy each.
+  auto producerResources = getSharedResources(producerOp);
+  for (auto resource : getSharedResources(consumerOp)) {
+    if (llvm::any_of(buffers, [resource](hir::AllocaOp allocaOp) {
+          return allocaOp.getResult() == resource;
+        }))
+      continue;
+    if (producerResources.contains(resource))
+      return failure();
+  }
+
+  // The consumer outlives its outer iteration, so it may only use the outer
+  // induction var (which is passed in) and constants from the outer body. Its
+  // iter_args may also start from values delayed up to its start time, as
+  // AffineToHIR passes them in.
+  int64_t const consumerOffset = producerEnd + *consumerStart;
+  auto isDelayedToConsumer = [&](Value value) {
+    auto delayOp = value.getDefiningOp<hir::DelayOp>();
+    return delayOp && delayOp->getBlock() == &outerBody &&
+           (int64_t)(delayOp.offset() + delayOp.delay()) == consumerOffset;
+  };
+  bool usesOuterValues = false;
+  bool usesOuterIV = false;
+  consumerOp.walk([&](Operation *operation) {
+    for (auto operand : operation->getOperands()) {
+      if (operand.getParentRegion() != &outerOp.getLoopBody() ||
+          operand.getType().isa<hir::TimeType>())
+        continue;
+      if (operand == outerOp.getInductionVar()) {
+        usesOuterIV = true;
+        continue;
+      }
+      if (operand.getDefiningOp() && isConstantOp(operand.getDefiningOp()))
+        continue;
+      if (operation == consumerOp && isDelayedToConsumer(operand))
+        continue;
+      usesOuterValues = true;
+    }
+  });
+  if (usesOuterValues)
+    return failure();
+
+  // The producer of iteration n+1 starts after the producer of iteration n,
+  // consumer n+1 after consumer n, and producer n+2 after consumer n.
+  int64_t const oldII = consumerEnd + *tailGap;
+  int64_t newII = std::max(producerEnd, *consumerLatency);
+  newII = std::max(newII, (consumerEnd - *producerStart + 1) / 2);
+  if (newII >= oldII)
+    return failure();
+
+  OpBuilder builder(outerOp);
+  auto uLoc = builder.getUnknownLoc();
+
+  // parity = ((iv - lb) / step) % 2.
+  builder.setInsertionPointToStart(&outerBody);
+  Value iterIdx = outerOp.getInductionVar();
+  if (*outerLb != 0)
+    iterIdx = builder.create<comb::SubOp>(
+        uLoc, iterIdx,
+        builder.create<hw::ConstantOp>(
+            uLoc, IntegerAttr::get(outerIVTy, *outerLb)));
+  Value const parity = builder.create<comb::ExtractOp>(
+      uLoc, builder.getI1Type(), iterIdx,
+      builder.getI32IntegerAttr(llvm::Log2_64(*outerStep)));
+
+  auto consumerNextIterOp =
+      cast<hir::NextIterOp>(consumerOp.getLoopBody().front().getTerminator());
+  auto consumerII = helper::getTimeOffsetFrom(consumerNextIterOp.tstart(),
+                                              consumerNextIterOp.offset(),
+                                              consumerOp.getIterTimeVar());
+  // Consumer N starts after outer iteration N+1 may have started, so it gets
+  // the induction var and parity of iteration N through shift registers.
+  SmallVector<Value> consumerInputs;
+  if (usesOuterIV)
+    consumerInputs.push_back(outerOp.getInductionVar());
+  consumerInputs.push_back(parity);
+  if (consumerOffset > 0) {
+    for (auto &input : consumerInputs)
+      input = builder.create<hir::DelayOp>(
+          uLoc, input.getType(), input,
+          builder.getI64IntegerAttr(consumerOffset), outerOp.getIterTimeVar(),
+          builder.getI64IntegerAttr(0));
+    if (usesOuterIV)
+      outerOp.getInductionVar().replaceUsesWithIf(
+          consumerInputs[0], [&](OpOperand &use) {
+            return consumerOp->isAncestor(use.getOwner());
+          });
+  }
+  auto numIterArgs = consumerOp.iter_args().size();
+  consumerOp = helper::addLoopInvariantIterArgs(consumerOp, consumerInputs,
+                                                *consumerII);
+  Value const consumerParity = consumerOp.getLoopBody().front().getArgument(
+      numIterArgs + consumerInputs.size() - 1);
+
+  // Add a leading address dimension of size 2 to each buffer.
+  for (auto allocaOp : buffers) {
+    auto memTy = allocaOp.getType().cast<hir::MemrefType>();
+    SmallVector<int64_t> shape = {2};
+    shape.append(memTy.getShape().begin(), memTy.getShape().end());
+    SmallVector<hir::DimKind> dimKinds = {hir::DimKind::ADDR};
+    dimKinds.append(memTy.getDimKinds().begin(), memTy.getDimKinds().end());
+    builder.setInsertionPoint(allocaOp);
+    auto newAllocaOp = builder.create<hir::AllocaOp>(
+        allocaOp.getLoc(),
+        hir::MemrefType::get(builder.getContext(), shape,
+                             memTy.getElementType(), dimKinds),
+        allocaOp.mem_kindAttr(), allocaOp.ports());
+    newAllocaOp->setAttrs(allocaOp->getAttrs());
+    for (auto *user : llvm::make_early_inc_range(allocaOp->getUsers())) {
+      Value const idx =
+          consumerOp->isAncestor(user) ? consumerParity : parity;
+      if (isa<hir::LoadOp>(user))
+        user->insertOperands(1, idx);
+      else
+        user->insertOperands(2, idx);
+    }
+    allocaOp.getResult().replaceAllUsesWith(newAllocaOp.getResult());
+    allocaOp.erase();
+  }
+
+  // Start the next outer iteration early.
+  builder.setInsertionPoint(outerNextIterOp);
+  builder.create<hir::NextIterOp>(outerNextIterOp.getLoc(), Value(),
+                                  ArrayRef<Value>(), outerOp.getIterTimeVar(),
+                                  builder.getI64IntegerAttr(newII));
+  outerNextIterOp.erase();
+  if (outerOp.initiation_interval())
+    outerOp->setAttr("initiation_interval", builder.getI64IntegerAttr(newII));
+
+  // The last consumer still runs after the outer loop's t_end.
+  if (oldII > newII) {
+    builder.setInsertionPointAfter(outerOp);
+    auto timeOp = builder.create<hir::TimeOp>(
+        uLoc, helper::getTimeType(builder.getContext()), outerOp.t_end(),
+        builder.getI64IntegerAttr(oldII - newII));
+    outerOp.t_end().replaceAllUsesExcept(timeOp, timeOp);
+  }
+  return success();
+}
+
+void DoubleBufferPass::runOnOperation() {
+  hir::FuncOp funcOp = getOperation();
+  SmallVector<hir::ForOp> forOps;
+  funcOp.walk([&forOps](hir::ForOp forOp) { forOps.push_back(forOp); });
+  for (auto forOp : forOps)
+    (void)insertDoubleBuffer(forOp);
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createDoubleBufferPass() {
+  return std::make_unique<DoubleBufferPass>();
+}
+} // namespace hir
+} // namespace circt
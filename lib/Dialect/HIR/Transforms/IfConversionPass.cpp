@@ -0,0 +1,185 @@
+//=========- IfConversionPass.cpp - Predicate small hir.if ops-------------===//
+//
+// This file implements if-conversion. Both regions of a small hir.if are
+// executed unconditionally and the results are selected with comb.mux ops,
+// which removes the control logic of the branch. Each store is predicated on
+// the condition (or its negation) delayed until the store. The regions may
+// only contain comb ops, constants, hir.delay, hir.time and stores at a known
+// offset from the start of the branch. Nested branches without stores are
+// converted innermost first. The enclosing loop is not rescheduled, so a
+// lower II has to come from the scheduler of the input.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+
+using namespace circt;
+namespace {
+
+class IfConversionPass : public hir::IfConversionBase<IfConversionPass> {
+public:
+  void runOnOperation() override;
+
+private:
+  bool canConvert(hir::IfOp);
+  void convert(hir::IfOp);
+  Value getPredicate(OpBuilder &, hir::IfOp, Value tstart, bool isElse,
+                     int64_t delay);
+
+private:
+  /// The predicates of the if and the else region by delay.
+  llvm::DenseMap<int64_t, Value> mapDelayToPredicate[2];
+};
+} // end anonymous namespace
+
+/// Ops that may run whether or not their branch is taken.
+static bool isSpeculatable(Operation *operation) {
+  if (isa<comb::CombDialect>(operation->getDialect()))
+    return true;
+  return isa<hw::ConstantOp, mlir::arith::ConstantOp, hir::DelayOp,
+             hir::TimeOp, hir::YieldOp>(operation);
+}
+
+/// Time of a store relative to the start of the branch, if it is known.
+static Optional<int64_t> getStoreDelay(hir::StoreOp storeOp) {
+  auto *region = storeOp->getParentRegion();
+  return helper::getTimeOffsetFrom(storeOp.tstart(), storeOp.offset(),
+                                   region->front().getArguments().back());
+}
+
+bool IfConversionPass::canConvert(hir::IfOp op) {
+  for (auto ty : op.getResultTypes())
+    if (!ty.isa<IntegerType>())
+      return false;
+  unsigned numOps = 0;
+  // Both regions run every time after the conversion, so they must not store
+  // through the same port.
+  llvm::DenseSet<std::pair<Value, int64_t>> ifPorts;
+  for (auto *region : {&op.if_region(), &op.else_region()}) {
+    for (auto &operation : region->front()) {
+      if (auto storeOp = dyn_cast<hir::StoreOp>(operation)) {
+        if (!storeOp.port() || !getStoreDelay(storeOp))
+          return false;
+        auto port = std::make_pair(storeOp.mem(), *storeOp.port());
+        if (region == &op.if_region())
+          ifPorts.insert(port);
+        else if (ifPorts.contains(port))
+          return false;
+      } else if (!isSpeculatable(&operation)) {
+        return false;
+      }
+      if (!isa<hir::YieldOp>(operation))
+        numOps++;
+    }
+  }
+  return numOps <= maxOps;
+}
+
+/// Returns the condition (or its negation for the else region) delayed by
+/// `delay` cycles from the start of the branch.
+Value IfConversionPass::getPredicate(OpBuilder &builder, hir::IfOp op,
+                                     Value tstart, bool isElse,
+                                     int64_t delay) {
+  Value &predicate = mapDelayToPredicate[isElse][delay];
+  if (predicate)
+    return predicate;
+  auto uLoc = builder.getUnknownLoc();
+  if (delay > 0)
+    predicate = builder.create<hir::DelayOp>(
+        uLoc, builder.getI1Type(),
+        getPredicate(builder, op, tstart, isElse, 0),
+        builder.getI64IntegerAttr(delay), tstart, builder.getI64IntegerAttr(0));
+  else if (isElse)
+    predicate = builder.create<comb::XorOp>(
+        uLoc, op.condition(),
+        builder.create<hw::ConstantOp>(
+            uLoc, IntegerAttr::get(builder.getI1Type(), 1)));
+  else
+    predicate = op.condition();
+  return predicate;
+}
+
+void IfConversionPass::convert(hir::IfOp op) {
+  OpBuilder builder(op);
+  auto uLoc = builder.getUnknownLoc();
+  Value tstart = op.tstart();
+  if (op.offset() != 0)
+    tstart = builder.create<hir::TimeOp>(
+        uLoc, helper::getTimeType(builder.getContext()), op.tstart(),
+        op.offsetAttr());
+
+  // Inline both regions at the start time of the branch. Each store is moved
+  // into its own hir.if on the predicate of its region at the time of the
+  // store, which only gates the write enable.
+  mapDelayToPredicate[0].clear();
+  mapDelayToPredicate[1].clear();
+  SmallVector<SmallVector<Value>> regionResults;
+  for (auto *region : {&op.if_region(), &op.else_region()}) {
+    BlockAndValueMapping operandMap;
+    operandMap.map(region->front().getArguments().back(), tstart);
+    SmallVector<Value> results;
+    for (auto &operation : region->front()) {
+      if (auto yieldOp = dyn_cast<hir::YieldOp>(operation)) {
+        for (auto operand : yieldOp.operands())
+          results.push_back(operandMap.lookupOrDefault(operand));
+        continue;
+      }
+      auto storeOp = dyn_cast<hir::StoreOp>(operation);
+      if (!storeOp) {
+        builder.clone(operation, operandMap);
+        continue;
+      }
+      int64_t const delay = *getStoreDelay(storeOp);
+      auto predicate = getPredicate(builder, op, tstart,
+                                    region == &op.else_region(), delay);
+      auto ifOp = builder.create<hir::IfOp>(uLoc, TypeRange(), predicate,
+                                            tstart,
+                                            builder.getI64IntegerAttr(delay),
+                                            ArrayAttr());
+      OpBuilder::InsertionGuard guard(builder);
+      for (auto *ifRegion : {&ifOp.if_region(), &ifOp.else_region()}) {
+        builder.createBlock(ifRegion, {},
+                            helper::getTimeType(builder.getContext()), uLoc);
+        builder.create<hir::YieldOp>(uLoc);
+      }
+      builder.setInsertionPointToStart(&ifOp.if_region().front());
+      cast<hir::StoreOp>(builder.clone(operation, operandMap))
+          .setStartTime(hir::Time(ifOp.getRegionTimeVar(), 0));
+    }
+    regionResults.push_back(results);
+  }
+
+  // A result that is valid `delay` cycles after the start is selected with
+  // the condition delayed by as much.
+  for (size_t i = 0; i < op.getNumResults(); i++) {
+    int64_t const delay =
+        op.result_attrs().getValue()[i].dyn_cast<IntegerAttr>().getInt();
+    op.getResult(i).replaceAllUsesWith(builder.create<comb::MuxOp>(
+        uLoc, getPredicate(builder, op, tstart, false, delay),
+        regionResults[0][i], regionResults[1][i]));
+  }
+  op.erase();
+}
+
+void IfConversionPass::runOnOperation() {
+  // Post-order, so that nested branches are converted before their parents.
+  SmallVector<hir::IfOp> ifOps;
+  getOperation().walk<WalkOrder::PostOrder>(
+      [&ifOps](hir::IfOp op) { ifOps.push_back(op); });
+  for (auto op : ifOps)
+    if (canConvert(op))
+      convert(op);
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createIfConversionPass() {
+  return std::make_unique<IfConversionPass>();
+}
+} // namespace hir
+} // namespace circt
@@ -0,0 +1,272 @@
+//=========- LoopFlattenPass.cpp - Flatten perfect loop nests---===//
+//
+// This file implements flattening of perfectly nested hir.for loops into a
+// single pipelined loop.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/Dialect/Arithmetic/IR/Arithmetic.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "llvm/ADT/DenseSet.h"
+
+using namespace circt;
+namespace {
+
+class LoopFlattenPass : public hir::LoopFlattenBase<LoopFlattenPass> {
+public:
+  void runOnOperation() override;
+};
+
+struct LoopBounds {
+  int64_t lb;
+  int64_t step;
+  int64_t tripCount;
+};
+} // end anonymous namespace
+
+static Optional<LoopBounds> getConstantBounds(hir::ForOp forOp) {
+  if (!forOp.getInductionVar().getType().isa<IntegerType>())
+    return llvm::None;
+  auto lb = helper::getConstantIntValue(forOp.lb());
+  auto ub = helper::getConstantIntValue(forOp.ub());
+  auto step = helper::getConstantIntValue(forOp.step());
+  if (!lb || !ub || !step || *step <= 0 || *ub <= *lb)
+    return llvm::None;
+  return LoopBounds{*lb, *step, (*ub - *lb + *step - 1) / *step};
+}
+
+static bool isUnrolled(hir::ForOp forOp) {
+  return forOp->hasAttr("unroll") ||
+         forOp.getInductionVar().getType().isa<mlir::IndexType>();
+}
+
+static bool isConstantOp(Operation *operation) {
+  return isa<hw::ConstantOp, mlir::arith::ConstantOp>(operation);
+}
+
+/// Removing the idle cycles between two outer iterations moves the start of
+/// the next outer iteration closer to the end of the previous one. That is only
+/// safe if no memref is both read and written in the body and the body does
+/// not talk to the outside world.
+static bool mayCarryOuterDependence(Block &body) {
+  llvm::DenseSet<Value> loadedMems;
+  llvm::DenseSet<Value> storedMems;
+  bool hasExternalEffect = false;
+  for (auto &operation : body) {
+    operation.walk([&](Operation *op) {
+      if (auto loadOp = dyn_cast<hir::LoadOp>(op))
+        loadedMems.insert(loadOp.mem());
+      else if (auto storeOp = dyn_cast<hir::StoreOp>(op))
+        storedMems.insert(storeOp.mem());
+      else if (isa<hir::BusSendOp, hir::BusRecvOp, hir::FifoSendOp,
+                   hir::FifoRecvOp>(op))
+        hasExternalEffect = true;
+      else if (isa<hir::CallOp>(op))
+        for (auto operand : op->getOperands())
+          if (operand.getType().isa<hir::MemrefType>() ||
+              helper::isChannelType(operand.getType()))
+            hasExternalEffect = true;
+    });
+  }
+  if (hasExternalEffect)
+    return true;
+  for (auto mem : storedMems)
+    if (loadedMems.contains(mem))
+      return true;
+  return false;
+}
+
+/// Flattens the outer loop and its only child loop into one loop that runs the
+/// inner body at the inner II. The outer and inner induction vars are kept in a
+/// two-level counter (iter_args), so no division is needed to recover them.
+static LogicalResult flattenLoopNest(hir::ForOp outerOp) {
+  Block &outerBody = outerOp.getLoopBody().front();
+  if (!outerOp.iter_args().empty())
+    return failure();
+
+  // The outer body may only contain the inner loop, constants and time vars.
+  hir::ForOp innerOp;
+  for (auto &operation : outerBody) {
+    if (auto forOp = dyn_cast<hir::ForOp>(operation)) {
+      if (innerOp)
+        return failure();
+      innerOp = forOp;
+      continue;
+    }
+    if (!isa<hir::NextIterOp, hir::TimeOp>(operation) &&
+        !isConstantOp(&operation))
+      return failure();
+  }
+  if (!innerOp || !innerOp.iter_args().empty())
+    return failure();
+
+  // Loops that are marked for unrolling, or have an index induction var, are
+  // unrolled later, which flattening would prevent.
+  if (isUnrolled(outerOp) || isUnrolled(innerOp))
+    return failure();
+
+  auto outerBounds = getConstantBounds(outerOp);
+  auto innerBounds = getConstantBounds(innerOp);
+  if (!outerBounds || !innerBounds)
+    return failure();
+
+  Block &innerBody = innerOp.getLoopBody().front();
+  auto outerNextIterOp = dyn_cast<hir::NextIterOp>(outerBody.getTerminator());
+  auto innerNextIterOp = dyn_cast<hir::NextIterOp>(innerBody.getTerminator());
+  if (!outerNextIterOp || !innerNextIterOp || outerNextIterOp.condition() ||
+      innerNextIterOp.condition())
+    return failure();
+
+  auto ii = helper::getTimeOffsetFrom(innerNextIterOp.tstart(),
+                                      innerNextIterOp.offset(),
+                                      innerOp.getIterTimeVar());
+  if (!ii || *ii <= 0)
+    return failure();
+
+  // Cycles from the start of an outer iteration to the start of the inner loop.
+  auto innerStart = helper::getTimeOffsetFrom(
+      innerOp.tstart(), innerOp.offset(), outerOp.getIterTimeVar());
+  if (!innerStart)
+    return failure();
+
+  // Cycles from the end of the inner loop to the next outer iteration.
+  auto tailGap = helper::getTimeOffsetFrom(
+      outerNextIterOp.tstart(), outerNextIterOp.offset(), innerOp.t_end());
+  if (!tailGap) {
+    auto outerII = helper::getTimeOffsetFrom(outerNextIterOp.tstart(),
+                                             outerNextIterOp.offset(),
+                                             outerOp.getIterTimeVar());
+    if (outerII)
+      tailGap = *outerII - *innerStart - innerBounds->tripCount * *ii;
+  }
+  if (!tailGap || *tailGap < 0)
+    return failure();
+
+  // The inner body may only use the outer induction var and constants from the
+  // outer body.
+  bool usesOuterValues = false;
+  innerOp.walk([&](Operation *operation) {
+    for (auto operand : operation->getOperands()) {
+      if (operand.getParentRegion() != &outerOp.getLoopBody())
+        continue;
+      if (operand == outerOp.getInductionVar())
+        continue;
+      if (operand.getDefiningOp() && isConstantOp(operand.getDefiningOp()))
+        continue;
+      if (operation == innerOp.getOperation())
+        continue;
+      usesOuterValues = true;
+    }
+  });
+  if (usesOuterValues)
+    return failure();
+
+  bool const hasIdleCycles = *innerStart + *tailGap > 0;
+  if (hasIdleCycles && !outerOp->hasAttr("flatten") &&
+      mayCarryOuterDependence(innerBody))
+    return failure();
+
+  OpBuilder builder(outerOp);
+  auto uLoc = builder.getUnknownLoc();
+  auto *context = builder.getContext();
+  BlockAndValueMapping operandMap;
+
+  // Constants of the outer body are hoisted in front of the flattened loop.
+  for (auto &operation : outerBody)
+    if (isConstantOp(&operation))
+      builder.clone(operation, operandMap);
+
+  auto getConstant = [&builder, uLoc](Type ty, int64_t value) -> Value {
+    return builder.create<hw::ConstantOp>(uLoc, IntegerAttr::get(ty, value));
+  };
+
+  int64_t const tripCount = outerBounds->tripCount * innerBounds->tripCount;
+  auto counterTy = builder.getIntegerType(helper::clog2(tripCount + 1));
+  auto outerIVTy = outerOp.getInductionVar().getType();
+  auto innerIVTy = innerOp.getInductionVar().getType();
+  auto flatLb = getConstant(counterTy, 0);
+  auto flatUb = getConstant(counterTy, tripCount);
+  auto flatStep = getConstant(counterTy, 1);
+  SmallVector<Value> initialIVs = {getConstant(outerIVTy, outerBounds->lb),
+                                   getConstant(innerIVTy, innerBounds->lb)};
+
+  auto flatOp = builder.create<hir::ForOp>(
+      outerOp.getLoc(), flatLb, flatUb, flatStep, initialIVs, outerOp.tstart(),
+      builder.getI64IntegerAttr(outerOp.offset() + *innerStart),
+      [&](OpBuilder &builder, Value, ArrayRef<Value> iterArgs,
+          Value tLoopBody) {
+        Value const outerIV = iterArgs[0];
+        Value const innerIV = iterArgs[1];
+        operandMap.map(outerOp.getInductionVar(), outerIV);
+        operandMap.map(innerOp.getInductionVar(), innerIV);
+        operandMap.map(innerOp.getIterTimeVar(), tLoopBody);
+        for (auto &operation : innerBody)
+          if (!isa<hir::NextIterOp>(operation))
+            builder.clone(operation, operandMap);
+
+        // Advance the inner induction var and carry into the outer one.
+        auto innerLast = getConstant(
+            innerIVTy, innerBounds->lb +
+                           (innerBounds->tripCount - 1) * innerBounds->step);
+        Value const wrap = builder.create<comb::ICmpOp>(
+            uLoc, comb::ICmpPredicate::eq, innerIV, innerLast);
+        Value const innerIVNext = builder.create<comb::MuxOp>(
+            uLoc, wrap, getConstant(innerIVTy, innerBounds->lb),
+            builder.create<comb::AddOp>(
+                uLoc, innerIV, getConstant(innerIVTy, innerBounds->step)));
+        Value const outerIVNext = builder.create<comb::MuxOp>(
+            uLoc, wrap,
+            builder.create<comb::AddOp>(
+                uLoc, outerIV, getConstant(outerIVTy, outerBounds->step)),
+            outerIV);
+
+        // The iter args must be valid at the start of the next iteration.
+        SmallVector<Value> nextIterArgs;
+        for (Value const v : {outerIVNext, innerIVNext})
+          nextIterArgs.push_back(builder.create<hir::DelayOp>(
+              uLoc, v.getType(), v, builder.getI64IntegerAttr(*ii), tLoopBody,
+              builder.getI64IntegerAttr(0)));
+        return builder.create<hir::NextIterOp>(uLoc, Value(), nextIterArgs,
+                                               tLoopBody,
+                                               builder.getI64IntegerAttr(*ii));
+      });
+  flatOp->setAttr("initiation_interval", builder.getI64IntegerAttr(*ii));
+
+  // The outer loop ended tailGap cycles after its last inner loop.
+  Value tEnd = flatOp.t_end();
+  if (*tailGap > 0)
+    tEnd = builder.create<hir::TimeOp>(uLoc, helper::getTimeType(context), tEnd,
+                                       builder.getI64IntegerAttr(*tailGap));
+  outerOp.t_end().replaceAllUsesWith(tEnd);
+  outerOp.erase();
+  return success();
+}
+
+void LoopFlattenPass::runOnOperation() {
+  hir::FuncOp funcOp = getOperation();
+  // Flattening a nest can leave the new loop as the only child of another
+  // loop, so repeat until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    funcOp.walk([&changed](hir::ForOp forOp) {
+      if (failed(flattenLoopNest(forOp)))
+        return WalkResult::advance();
+      changed = true;
+      return WalkResult::interrupt();
+    });
+  }
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createLoopFlattenPass() {
+  return std::make_unique<LoopFlattenPass>();
+}
+} // namespace hir
+} // namespace circt
@@ -0,0 +1,229 @@
+//=========- MemoryMappingPass.cpp - Map memories to device primitives-----===//
+//
+// This file implements the hir-map-memory pass. It picks the memory kind
+// (lutram, bram or uram) of each hir.alloca from its depth, width, ports and
+// read latency, using a table of device primitives and their costs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cmath>
+
+using namespace circt;
+namespace {
+
+/// A memory primitive of the device, e.g. a block RAM.
+struct MemoryPrimitive {
+  hir::MemKindEnum kind;
+  /// The (depth, width) configurations of one primitive.
+  SmallVector<std::pair<int64_t, int64_t>> shapes;
+  /// Cost of one primitive, in LUT equivalents.
+  double cost;
+  /// Read-write ports count as both a read and a write port.
+  int64_t maxPorts;
+  int64_t maxRdPorts;
+  int64_t maxWrPorts;
+  int64_t minRdLatency;
+  /// Distributed RAM gives every read port a copy of the memory.
+  bool replicatePerRdPort;
+};
+
+class MemoryMappingPass : public hir::MemoryMappingBase<MemoryMappingPass> {
+public:
+  LogicalResult initialize(MLIRContext *context) override;
+  void runOnOperation() override;
+
+private:
+  LogicalResult parseDeviceCosts(MLIRContext *context);
+
+private:
+  SmallVector<MemoryPrimitive> primitives;
+};
+} // end anonymous namespace
+
+/// A Xilinx UltraScale+ like device. Distributed RAM has one write port and
+/// up to three extra read ports, block and ultra RAM have two ports that can
+/// each read or write.
+static SmallVector<MemoryPrimitive> getDefaultPrimitives() {
+  return {{hir::MemKindEnum::lutram, {{64, 1}}, 1, 4, 4, 1, 0, true},
+          {hir::MemKindEnum::bram,
+           {{512, 72},
+            {1024, 36},
+            {2048, 18},
+            {4096, 9},
+            {8192, 4},
+            {16384, 2},
+            {32768, 1}},
+           60,
+           2,
+           2,
+           2,
+           1,
+           false},
+          {hir::MemKindEnum::uram, {{4096, 72}}, 240, 2, 2, 2, 1, false}};
+}
+
+/// Estimated number of primitives that implement one bank of depth x width
+/// bits. The pass only picks the memory kind; tiling a bank that does not fit
+/// one primitive is left to synthesis.
+static int64_t getNumPrimitives(const MemoryPrimitive &primitive,
+                                int64_t depth, int64_t width) {
+  int64_t numPrimitives = INT64_MAX;
+  for (auto shape : primitive.shapes)
+    numPrimitives = std::min(numPrimitives,
+                             ((depth + shape.first - 1) / shape.first) *
+                                 ((width + shape.second - 1) / shape.second));
+  return numPrimitives;
+}
+
+/// Cost of the memory on this primitive, or None if the primitive can not
+/// provide the ports of the memory.
+static llvm::Optional<double>
+getCost(const MemoryPrimitive &primitive, hir::MemrefType memrefTy,
+        ArrayRef<helper::MemrefPortInfo> ports) {
+  if ((int64_t)ports.size() > primitive.maxPorts)
+    return llvm::None;
+  int64_t numRdPorts = 0;
+  int64_t numWrPorts = 0;
+  for (auto port : ports) {
+    if (port.isWrPort())
+      numWrPorts++;
+    if (!port.isRdPort())
+      continue;
+    if (port.rdLatency.getValue() < primitive.minRdLatency)
+      return llvm::None;
+    numRdPorts++;
+  }
+  if (numRdPorts > primitive.maxRdPorts || numWrPorts > primitive.maxWrPorts)
+    return llvm::None;
+  auto width = helper::getBitWidth(memrefTy.getElementType());
+  if (!width)
+    return llvm::None;
+  double cost = primitive.cost * memrefTy.getNumBanks() *
+                getNumPrimitives(primitive, memrefTy.getNumElementsPerBank(),
+                                 width.getValue());
+  if (primitive.replicatePerRdPort)
+    cost *= std::max(numRdPorts, (int64_t)1);
+  return cost;
+}
+
+/// The json file has an entry for each memory kind it overrides:
+///   {"bram": {"shapes": [[1024, 36], [2048, 18]], "cost": 60,
+///             "max_ports": 2, "max_rd_ports": 2, "max_wr_ports": 2,
+///             "min_rd_latency": 1}}
+/// Missing fields keep their default values.
+LogicalResult MemoryMappingPass::parseDeviceCosts(MLIRContext *context) {
+  auto buffer = llvm::MemoryBuffer::getFile(deviceCosts);
+  if (!buffer)
+    return emitError(UnknownLoc::get(context), "Could not open device costs ")
+           << deviceCosts.getValue() << ".";
+  auto json = llvm::json::parse(buffer.get()->getBuffer());
+  if (!json)
+    return emitError(UnknownLoc::get(context), "Could not parse device costs ")
+           << deviceCosts.getValue() << ": "
+           << llvm::toString(json.takeError());
+  auto *root = json->getAsObject();
+  if (!root)
+    return emitError(UnknownLoc::get(context),
+                     "Expected a json object in device costs ")
+           << deviceCosts.getValue() << ".";
+
+  for (auto &kv : *root) {
+    auto kind = hir::symbolizeMemKindEnum(kv.first.str());
+    auto *entry = kv.second.getAsObject();
+    auto *primitive = llvm::find_if(primitives, [&](MemoryPrimitive &p) {
+      return kind && p.kind == *kind;
+    });
+    if (!entry || primitive == primitives.end())
+      return emitError(UnknownLoc::get(context), "Invalid memory kind ")
+             << kv.first.str() << " in device costs "
+             << deviceCosts.getValue() << ".";
+    if (auto *shapes = entry->getArray("shapes")) {
+      primitive->shapes.clear();
+      for (auto &shape : *shapes) {
+        auto *depthAndWidth = shape.getAsArray();
+        if (!depthAndWidth || depthAndWidth->size() != 2 ||
+            !(*depthAndWidth)[0].getAsInteger() ||
+            !(*depthAndWidth)[1].getAsInteger())
+          return emitError(UnknownLoc::get(context),
+                           "Expected [depth, width] shapes for ")
+                 << kv.first.str() << " in device costs "
+                 << deviceCosts.getValue() << ".";
+        primitive->shapes.push_back(
+            std::make_pair(*(*depthAndWidth)[0].getAsInteger(),
+                           *(*depthAndWidth)[1].getAsInteger()));
+      }
+    }
+    primitive->cost = entry->getNumber("cost").value_or(primitive->cost);
+    primitive->maxPorts =
+        entry->getInteger("max_ports").value_or(primitive->maxPorts);
+    primitive->maxRdPorts =
+        entry->getInteger("max_rd_ports").value_or(primitive->maxRdPorts);
+    primitive->maxWrPorts =
+        entry->getInteger("max_wr_ports").value_or(primitive->maxWrPorts);
+    primitive->minRdLatency =
+        entry->getInteger("min_rd_latency").value_or(primitive->minRdLatency);
+    if (primitive->shapes.empty())
+      return emitError(UnknownLoc::get(context), "No shapes for ")
+             << kv.first.str() << " in device costs "
+             << deviceCosts.getValue() << ".";
+  }
+  return success();
+}
+
+LogicalResult MemoryMappingPass::initialize(MLIRContext *context) {
+  primitives = getDefaultPrimitives();
+  if (deviceCosts.empty())
+    return success();
+  return parseDeviceCosts(context);
+}
+
+void MemoryMappingPass::runOnOperation() {
+  getOperation().walk([this](hir::AllocaOp op) {
+    // Registers fix the port latencies, so they are left alone.
+    if (op.mem_kind() == hir::MemKindEnum::reg)
+      return;
+    auto memrefTy = op.res().getType().dyn_cast<hir::MemrefType>();
+    auto ports = helper::getMemrefPortInfos(op.ports());
+    const MemoryPrimitive *bestPrimitive = nullptr;
+    double bestCost = 0;
+    for (auto &primitive : primitives) {
+      auto cost = getCost(primitive, memrefTy, ports);
+      if (!cost)
+        continue;
+      // On a tie, keep the memory kind chosen by the user.
+      if (!bestPrimitive || *cost < bestCost ||
+          (*cost == bestCost && primitive.kind == op.mem_kind())) {
+        bestPrimitive = &primitive;
+        bestCost = *cost;
+      }
+    }
+    if (!bestPrimitive)
+      return;
+    if (report) {
+      auto width = helper::getBitWidth(memrefTy.getElementType()).getValue();
+      op.emitRemark() << "Mapped to "
+                      << hir::stringifyMemKindEnum(bestPrimitive->kind)
+                      << " with "
+                      << getNumPrimitives(*bestPrimitive,
+                                          memrefTy.getNumElementsPerBank(),
+                                          width)
+                      << " primitive(s) per bank, cost "
+                      << (int64_t)std::lround(bestCost) << ".";
+    }
+    op->setAttr("mem_kind", hir::MemKindEnumAttr::get(op.getContext(),
+                                                      bestPrimitive->kind));
+  });
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createMemoryMappingPass() {
+  return std::make_unique<MemoryMappingPass>();
+}
+} // namespace hir
+} // namespace circt
@@ -95,7 +95,8 @@ MemrefPortInterface MemrefLoweringPass::defineBusesForMemrefPort(
     }
   }
 
-  if (auto rdLatency = helper::getMemrefPortRdLatency(port)) {
+  auto portInfo = helper::getMemrefPortInfo(port);
+  if (auto rdLatency = portInfo.rdLatency) {
     portInterface.rdEnableBusTensor = topLevelBuilder->create<hir::BusTensorOp>(
         builder.getUnknownLoc(), enableTy);
     portInterface.rdDataBusTensor = topLevelBuilder->create<hir::BusTensorOp>(
@@ -109,7 +110,7 @@ MemrefPortInterface MemrefLoweringPass::defineBusesForMemrefPort(
     }
   }
 
-  if (helper::isMemrefWrPort(port)) {
+  if (portInfo.isWrPort()) {
     portInterface.wrEnableBusTensor = topLevelBuilder->create<hir::BusTensorOp>(
         builder.getUnknownLoc(), enableTy);
     portInterface.wrDataBusTensor = topLevelBuilder->create<hir::BusTensorOp>(
@@ -124,43 +125,32 @@ MemrefPortInterface MemrefLoweringPass::defineBusesForMemrefPort(
   return portInterface;
 }
 
-static void initUnconnectedMemoryInterface(OpBuilder &builder,
-                                           MemoryInterface memoryInterface) {
-  auto enTy = hir::BusType::get(builder.getContext(), builder.getI1Type());
-  if (memoryInterface.hasAddrBus()) {
-    OpBuilder::InsertionGuard const guard(builder);
-    builder.setInsertionPoint(memoryInterface.getAddrEnBus().getDefiningOp());
-    auto c0 = builder.create<hw::ConstantOp>(
-        builder.getUnknownLoc(), IntegerAttr::get(builder.getI1Type(), 0));
-    builder.getUnknownLoc(),
-        memoryInterface.getAddrEnBus().replaceAllUsesWith(
-            builder.create<hir::CastOp>(builder.getUnknownLoc(), enTy, c0));
-  }
-  if (memoryInterface.hasRdBus()) {
-    OpBuilder::InsertionGuard const guard(builder);
-    builder.setInsertionPoint(memoryInterface.getRdEnBus().getDefiningOp());
-    auto c0 = builder.create<hw::ConstantOp>(
-        builder.getUnknownLoc(), IntegerAttr::get(builder.getI1Type(), 0));
-    memoryInterface.getRdEnBus().replaceAllUsesWith(
-        builder.create<hir::CastOp>(builder.getUnknownLoc(), enTy, c0));
-  }
-  if (memoryInterface.hasWrBus()) {
-    OpBuilder::InsertionGuard const guard(builder);
-    builder.setInsertionPoint(memoryInterface.getWrEnBus().getDefiningOp());
-    auto c0 = builder.create<hw::ConstantOp>(
-        builder.getUnknownLoc(), IntegerAttr::get(builder.getI1Type(), 0));
-    memoryInterface.getWrEnBus().replaceAllUsesWith(
-        builder.create<hir::CastOp>(builder.getUnknownLoc(), enTy, c0));
-  }
+static void initUnconnectedMemoryInterface(MemoryInterface memoryInterface,
+                                           Value zeroBus) {
+  if (memoryInterface.hasAddrBus())
+    memoryInterface.getAddrEnBus().replaceAllUsesWith(zeroBus);
+  if (memoryInterface.hasRdBus())
+    memoryInterface.getRdEnBus().replaceAllUsesWith(zeroBus);
+  if (memoryInterface.hasWrBus())
+    memoryInterface.getWrEnBus().replaceAllUsesWith(zeroBus);
 }
 
 void MemrefLoweringPass::initUnConnectedPorts(hir::FuncOp op) {
+  // A single disabled bus, defined at the top of the function, drives the
+  // enables of all the unused interfaces.
   OpBuilder builder(op);
-  auto *returnOperation = &op.body().front().back();
-  builder.setInsertionPoint(returnOperation);
+  builder.setInsertionPointToStart(&op.body().front());
+  auto c0 = builder.create<hw::ConstantOp>(
+      builder.getUnknownLoc(), IntegerAttr::get(builder.getI1Type(), 0));
+  Value const zeroBus = builder.create<hir::CastOp>(
+      builder.getUnknownLoc(),
+      hir::BusType::get(builder.getContext(), builder.getI1Type()), c0);
   for (auto memoryInterface : memrefInfo.getAllMemoryInterfaces()) {
-    initUnconnectedMemoryInterface(builder, memoryInterface);
+    initUnconnectedMemoryInterface(memoryInterface, zeroBus);
   }
+  auto *returnOperation = &op.body().front().back();
+  builder.setInsertionPoint(returnOperation);
+  memrefInfo.initUnaccessedBanks(builder, zeroBus);
 }
 
 SmallVector<Value> filterMemrefArgs(Block::BlockArgListType args) {
@@ -212,7 +202,8 @@ size_t insertBusTypesAndAttrsForMemrefPort(
     inputNames.insert(inputNames.begin() + loc++, memName + "_addr_data");
   }
 
-  if (auto rdLatency = helper::getMemrefPortRdLatency(portDict)) {
+  auto portInfo = helper::getMemrefPortInfo(portDict);
+  if (auto rdLatency = portInfo.rdLatency) {
     portInterface.rdEnableBusTensor =
         bb.insertArgument(loc, enableTy, builder.getUnknownLoc());
     inputAttrs.insert(inputAttrs.begin() + loc, sendAttr);
@@ -224,7 +215,7 @@ size_t insertBusTypesAndAttrsForMemrefPort(
     portInterface.rdLatency = rdLatency.getValue();
   }
 
-  if (helper::isMemrefWrPort(portDict)) {
+  if (portInfo.isWrPort()) {
     portInterface.wrEnableBusTensor =
         bb.insertArgument(loc, enableTy, builder.getUnknownLoc());
     inputAttrs.insert(inputAttrs.begin() + loc, sendAttr);
@@ -240,26 +231,22 @@ size_t insertBusTypesAndAttrsForMemrefPort(
 void addBusAttrsPerPort(size_t i, SmallVectorImpl<DictionaryAttr> &attrs,
                         hir::MemrefType memrefTy, DictionaryAttr port) {
   auto *context = memrefTy.getContext();
-  if (memrefTy.getNumElementsPerBank() > 1) {
-    attrs.push_back(helper::getDictionaryAttr(
-        "hir.bus.ports",
-        ArrayAttr::get(context, StringAttr::get(context, "send"))));
-  }
-  if (helper::getMemrefPortRdLatency(port)) {
-    attrs.push_back(helper::getDictionaryAttr(
-        "hir.bus.ports",
-        ArrayAttr::get(context, StringAttr::get(context, "send"))));
-    attrs.push_back(helper::getDictionaryAttr(
-        "hir.bus.ports",
-        ArrayAttr::get(context, StringAttr::get(context, "recv"))));
+  auto portInfo = helper::getMemrefPortInfo(port);
+  DictionaryAttr const sendAttr = helper::getDictionaryAttr(
+      "hir.bus.ports",
+      ArrayAttr::get(context, StringAttr::get(context, "send")));
+  DictionaryAttr const recvAttr = helper::getDictionaryAttr(
+      "hir.bus.ports",
+      ArrayAttr::get(context, StringAttr::get(context, "recv")));
+  if (memrefTy.getNumElementsPerBank() > 1)
+    attrs.push_back(sendAttr);
+  if (portInfo.isRdPort()) {
+    attrs.push_back(sendAttr);
+    attrs.push_back(recvAttr);
   }
-  if (helper::isMemrefWrPort(port)) {
-    attrs.push_back(helper::getDictionaryAttr(
-        "hir.bus.ports",
-        ArrayAttr::get(context, StringAttr::get(context, "send"))));
-    attrs.push_back(helper::getDictionaryAttr(
-        "hir.bus.ports",
-        ArrayAttr::get(context, StringAttr::get(context, "send"))));
+  if (portInfo.isWrPort()) {
+    attrs.push_back(sendAttr);
+    attrs.push_back(sendAttr);
   }
 }
 
@@ -297,8 +284,7 @@ void MemrefLoweringPass::insertBusArguments(hir::FuncLike op) {
             portInterface);
         memrefPortInterfaces.push_back(portInterface);
       }
-      memrefInfo.map(arg, emitMemoryInterfacesForEachPortBank(
-                              builder, memrefTy, memrefPortInterfaces));
+      memrefInfo.mapBusTensors(builder, arg, memrefPortInterfaces);
     }
   }
 
@@ -465,6 +451,7 @@ LogicalResult MemrefLoweringPass::visitOp(hir::AllocaOp op) {
   auto memrefTy = op.getResult().getType().dyn_cast<hir::MemrefType>();
   // Declare buses and create MemoryInterface objects for each port-bank of the
   // memref.
+  auto portInfos = helper::getMemrefPortInfos(op.ports());
   SmallVector<SmallVector<MemoryInterface>> memoryInterfacesPerBankPerPort;
   for (auto bank = 0; bank < memrefTy.getNumBanks(); bank++) {
     SmallVector<MemoryInterface> memoryInterfacesPerPort;
@@ -476,15 +463,14 @@ LogicalResult MemrefLoweringPass::visitOp(hir::AllocaOp op) {
         memoryInterface.setAddrEnableBus(addrEnBus);
         memoryInterface.setAddrDataBus(addrDataBus);
       }
-      if (helper::isMemrefRdPort(op.ports()[port])) {
+      if (portInfos[port].isRdPort()) {
         auto rdEnBus = emitRdEnableBus(builder, memrefTy);
         auto rdDataBus = emitRdDataBus(builder, memrefTy);
         memoryInterface.setRdEnableBus(rdEnBus);
-        memoryInterface.setRdDataBus(
-            rdDataBus,
-            helper::getMemrefPortRdLatency(op.ports()[port]).getValue());
+        memoryInterface.setRdDataBus(rdDataBus,
+                                     portInfos[port].rdLatency.getValue());
       }
-      if (helper::isMemrefWrPort(op.ports()[port])) {
+      if (portInfos[port].isWrPort()) {
         auto wrEnBus = emitWrEnableBus(builder, memrefTy);
         auto wrDataBus = emitWrDataBus(builder, memrefTy);
         memoryInterface.setWrEnableBus(wrEnBus);
@@ -113,25 +113,6 @@ MemoryInterface emitMemoryInterface(OpBuilder &builder,
   return memoryInterface;
 }
 
-SmallVector<SmallVector<MemoryInterface>> emitMemoryInterfacesForEachPortBank(
-    OpBuilder &builder, hir::MemrefType memrefTy,
-    SmallVector<MemrefPortInterface> memrefPortInterfaces) {
-
-  int64_t const numBanks = memrefTy.getNumBanks();
-  SmallVector<SmallVector<MemoryInterface>> mapPortBankToMemoryInterface;
-
-  for (size_t port = 0; port < memrefPortInterfaces.size(); port++) {
-    SmallVector<MemoryInterface> mapBankToMemoryInterface;
-    for (int64_t bank = 0; bank < numBanks; bank++) {
-      auto memoryInterface = emitMemoryInterface(
-          builder, memrefTy, memrefPortInterfaces[port], bank);
-      mapBankToMemoryInterface.push_back(memoryInterface);
-    }
-    mapPortBankToMemoryInterface.push_back(mapBankToMemoryInterface);
-  }
-  return mapPortBankToMemoryInterface;
-}
-
 Value getBusFromTensor(OpBuilder &builder, Value busT, int64_t idx) {
   auto uLoc = builder.getUnknownLoc();
   auto numBanks =
@@ -247,6 +228,8 @@ std::string toString(MemKindEnum memKind) {
     return "bram";
   case MemKindEnum::lutram:
     return "lutram";
+  case MemKindEnum::uram:
+    return "uram";
   }
   assert(false && "Unknown MemKind");
 }
@@ -257,28 +240,24 @@ std::string createHWMemoryName(MemKindEnum memKind, hir::MemrefType memrefTy,
       toString(memKind) + "_" +
       std::to_string(memrefTy.getNumElementsPerBank()) + "x" +
       std::to_string(helper::getBitWidth(memrefTy.getElementType()).getValue());
-  for (auto port : memPorts) {
+  for (auto portInfo : helper::getMemrefPortInfos(memPorts)) {
     name += "_";
-    if (helper::isMemrefRdPort(port))
-      name +=
-          "r" + std::to_string(helper::getMemrefPortRdLatency(port).getValue());
-    if (helper::isMemrefWrPort(port))
-      name +=
-          "w" + std::to_string(helper::getMemrefPortWrLatency(port).getValue());
+    if (portInfo.isRdPort())
+      name += "r" + std::to_string(portInfo.rdLatency.getValue());
+    if (portInfo.isWrPort())
+      name += "w" + std::to_string(portInfo.wrLatency.getValue());
   }
   return name;
 }
 
 std::string createVerilogMemoryName(MemKindEnum memKind, ArrayAttr memPorts) {
   std::string name = toString(memKind);
-  for (auto port : memPorts) {
+  for (auto portInfo : helper::getMemrefPortInfos(memPorts)) {
     name += "_";
-    if (helper::isMemrefRdPort(port))
-      name +=
-          "r" + std::to_string(helper::getMemrefPortRdLatency(port).getValue());
-    if (helper::isMemrefWrPort(port))
-      name +=
-          "w" + std::to_string(helper::getMemrefPortWrLatency(port).getValue());
+    if (portInfo.isRdPort())
+      name += "r" + std::to_string(portInfo.rdLatency.getValue());
+    if (portInfo.isWrPort())
+      name += "w" + std::to_string(portInfo.wrLatency.getValue());
   }
   return name;
 }
@@ -8,6 +8,7 @@
 #include "circt/Dialect/Comb/CombOps.h"
 #include "circt/Dialect/HIR/IR/helper.h"
 #include "circt/Dialect/HW/HWOps.h"
+#include "llvm/ADT/MapVector.h"
 #include <iostream>
 using namespace circt;
 using namespace hir;
@@ -322,9 +323,10 @@ public:
   }
 };
 
-SmallVector<SmallVector<MemoryInterface>> emitMemoryInterfacesForEachPortBank(
-    OpBuilder &builder, hir::MemrefType memrefTy,
-    SmallVector<MemrefPortInterface> memrefPortInterfaces);
+MemoryInterface emitMemoryInterface(OpBuilder &builder,
+                                    hir::MemrefType memrefTy,
+                                    MemrefPortInterface portInterface,
+                                    int64_t bank);
 
 class MemrefInfo {
 public:
@@ -349,15 +351,27 @@ public:
     mapMemrefToNumBanks.map(mem, mapPortBankToMemoryInterface[0].size());
   }
 
+  /// Maps the ports of a memref arg to their bus tensors. The interface of a
+  /// bank is emitted with `builder` when the bank is first accessed, so a
+  /// highly banked memref only pays for the banks that it uses.
+  void mapBusTensors(OpBuilder &builder, Value mem,
+                     ArrayRef<MemrefPortInterface> portInterfaces) {
+    assert(portInterfaces.size() > 0 &&
+           "There must be atleast one port for a memref.");
+    auto memrefTy = mem.getType().dyn_cast<hir::MemrefType>();
+    for (size_t port = 0; port < portInterfaces.size(); port++)
+      mapMemrefPort2BusTensors[std::make_tuple(mem, (int64_t)port)] =
+          portInterfaces[port];
+    mapMemrefToNumPorts.map(mem, portInterfaces.size());
+    mapMemrefToNumBanks.map(mem, memrefTy.getNumBanks());
+    declBuilder = builder;
+  }
+
   /// Maps port 0 of mem to originalPort of originalMem.
   void mapPort(Value mem, Value originalMem, int64_t originalPort) {
     assert(mem.getType() == originalMem.getType());
-    for (size_t bank = 0; bank < getNumBanks(originalMem); bank++) {
-      mapMemrefPortBank2MemoryInterface.map(
-          std::make_tuple(mem, 0, bank),
-          mapMemrefPortBank2MemoryInterface.lookup(
-              std::make_tuple(originalMem, originalPort, bank)));
-    }
+    mapPort2OriginalPort[std::make_tuple(mem, (int64_t)0)] =
+        getOriginalPort(originalMem, originalPort);
     mapMemrefToNumPorts.map(mem, 1);
     mapMemrefToNumBanks.map(mem, getNumBanks(originalMem));
   }
@@ -365,12 +379,60 @@ public:
   size_t getNumPorts(Value mem) { return mapMemrefToNumPorts.lookup(mem); }
   size_t getNumBanks(Value mem) { return mapMemrefToNumBanks.lookup(mem); }
 
+  /// The returned pointer is invalidated by the next call, which may emit a
+  /// new interface.
   MemoryInterface *getInterface(Value mem, int64_t port, int64_t bank) {
+    std::tie(mem, port) = getOriginalPort(mem, port);
+    auto key = std::make_tuple(mem, port, bank);
     auto loc = mapMemrefPortBank2MemoryInterface.lookupOr(
-        std::make_tuple(mem, port, bank), memoryInterfaces.size());
-    if (loc == memoryInterfaces.size())
+        key, memoryInterfaces.size());
+    if (loc != memoryInterfaces.size())
+      return &memoryInterfaces[loc];
+
+    auto busTensors = mapMemrefPort2BusTensors.find(std::make_tuple(mem, port));
+    if (busTensors == mapMemrefPort2BusTensors.end() ||
+        bank >= (int64_t)getNumBanks(mem))
       return nullptr;
-    return &memoryInterfaces[loc];
+    mapMemrefPortBank2MemoryInterface.map(key, memoryInterfaces.size());
+    memoryInterfaces.push_back(emitMemoryInterface(
+        *declBuilder, mem.getType().dyn_cast<hir::MemrefType>(),
+        busTensors->second, bank));
+    return &memoryInterfaces.back();
+  }
+
+  /// Disable the banks of the memref args that were never accessed. A port
+  /// that is not used at all is disabled with a single broadcast.
+  void initUnaccessedBanks(OpBuilder &builder, Value zeroBus) {
+    auto uLoc = builder.getUnknownLoc();
+    for (auto &it : mapMemrefPort2BusTensors) {
+      Value mem = std::get<0>(it.first);
+      int64_t port = std::get<1>(it.first);
+      SmallVector<Value, 3> enableBusTensors;
+      for (auto busTensor : {it.second.addrEnableBusTensor,
+                             it.second.rdEnableBusTensor,
+                             it.second.wrEnableBusTensor})
+        if (busTensor)
+          enableBusTensors.push_back(busTensor);
+
+      SmallVector<int64_t> unaccessedBanks;
+      for (int64_t bank = 0; bank < (int64_t)getNumBanks(mem); bank++)
+        if (mapMemrefPortBank2MemoryInterface.lookupOr(
+                std::make_tuple(mem, port, bank), memoryInterfaces.size()) ==
+            memoryInterfaces.size())
+          unaccessedBanks.push_back(bank);
+
+      if ((int64_t)unaccessedBanks.size() == (int64_t)getNumBanks(mem)) {
+        for (auto busTensor : enableBusTensors)
+          builder.create<hir::BusTensorAssignOp>(
+              uLoc, busTensor,
+              builder.create<hir::BusBroadcastOp>(uLoc, busTensor.getType(),
+                                                  zeroBus));
+        continue;
+      }
+      for (auto bank : unaccessedBanks)
+        for (auto busTensor : enableBusTensors)
+          emitBusTensorAssignElementLogic(builder, zeroBus, busTensor, bank);
+    }
   }
 
   ArrayRef<MemoryInterface> getAllMemoryInterfaces() {
@@ -382,6 +444,17 @@ public:
     mapMemrefToNumPorts.clear();
     mapMemrefToNumBanks.clear();
     memoryInterfaces.clear();
+    mapMemrefPort2BusTensors.clear();
+    mapPort2OriginalPort.clear();
+    declBuilder = llvm::None;
+  }
+
+private:
+  std::tuple<Value, int64_t> getOriginalPort(Value mem, int64_t port) {
+    auto it = mapPort2OriginalPort.find(std::make_tuple(mem, port));
+    if (it == mapPort2OriginalPort.end())
+      return std::make_tuple(mem, port);
+    return it->second;
   }
 
 private:
@@ -390,6 +463,11 @@ private:
   SmallVector<MemoryInterface> memoryInterfaces;
   SafeDenseMap<Value, int64_t> mapMemrefToNumPorts;
   SafeDenseMap<Value, int64_t> mapMemrefToNumBanks;
+  llvm::MapVector<std::tuple<Value, int64_t>, MemrefPortInterface>
+      mapMemrefPort2BusTensors;
+  DenseMap<std::tuple<Value, int64_t>, std::tuple<Value, int64_t>>
+      mapPort2OriginalPort;
+  Optional<OpBuilder> declBuilder;
 
 public:
   MemrefPortInterface declNewPortInterface(OpBuilder &builder, Value mem,
@@ -471,9 +549,17 @@ public:
            1;
   }
   bool hasRdBus(Value mem, int64_t port) {
+    std::tie(mem, port) = getOriginalPort(mem, port);
+    auto busTensors = mapMemrefPort2BusTensors.find(std::make_tuple(mem, port));
+    if (busTensors != mapMemrefPort2BusTensors.end())
+      return busTensors->second.rdEnableBusTensor != Value();
     return getInterface(mem, port, 0)->hasRdBus();
   }
   bool hasWrBus(Value mem, int64_t port) {
+    std::tie(mem, port) = getOriginalPort(mem, port);
+    auto busTensors = mapMemrefPort2BusTensors.find(std::make_tuple(mem, port));
+    if (busTensors != mapMemrefPort2BusTensors.end())
+      return busTensors->second.wrEnableBusTensor != Value();
     return getInterface(mem, port, 0)->hasWrBus();
   }
 };
@@ -14,11 +14,11 @@ private:
   LogicalResult visitOp(hir::ScheduledOp op);
 
 private:
-  Optional<TimingInfo *> timingInfo;
+  TimingInfo *timingInfo;
 };
 
 LogicalResult OptTimePass::visitOp(hir::ScheduledOp op) {
-  Time optTime = (*timingInfo)->getOptimizedTime(op);
+  Time optTime = timingInfo->getOptimizedTime(op);
   int64_t offset = optTime.getOffset();
   auto parentOp = dyn_cast<RegionOp>(op.getOperation()->getParentOp());
   auto ii = parentOp.getRegionII();
@@ -53,8 +53,7 @@ LogicalResult OptTimePass::visitOp(hir::ScheduledOp op) {
 
 void OptTimePass::runOnOperation() {
   auto funcOp = getOperation();
-  auto tinfo = TimingInfo(funcOp);
-  timingInfo = &tinfo;
+  timingInfo = &getAnalysis<TimingInfo>();
   funcOp.walk([this](Operation *operation) {
     if (auto scheduledOp = dyn_cast<ScheduledOp>(operation)) {
       if (failed(visitOp(scheduledOp)))
@@ -0,0 +1,344 @@
+//=========- OverlapLoopNestPass.cpp - Overlap outer loop iterations--===//
+//
+// This file implements outer-loop pipelining of loop nests. In a hir.for whose
+// body runs a single inner loop, the next outer iteration normally starts after
+// the inner loop's t_end. This pass moves the outer hir.next_iter up so that
+// the tail of an outer iteration (the last inner iterations and the epilogue
+// after t_end) overlaps the head of the next one, as far as the memory
+// dependences between consecutive outer iterations allow. Loop nests whose
+// memrefs are also used by ops that may run at the same time, outside the
+// nest, are left alone.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "llvm/ADT/DenseSet.h"
+
+using namespace circt;
+namespace {
+
+/// A load or store in the loop nest along with the cycles, relative to the
+/// start of the outer iteration, in which it is issued.
+struct MemAccess {
+  Value mem;
+  Optional<uint64_t> port;
+  SmallVector<Value> indices;
+  bool isWrite = false;
+  int64_t minTime = 0;
+  int64_t maxTime = 0;
+};
+
+class OverlapLoopNestPass
+    : public hir::OverlapLoopNestBase<OverlapLoopNestPass> {
+public:
+  void runOnOperation() override;
+};
+} // end anonymous namespace
+
+static bool isConstantOp(Operation *operation) {
+  return isa<hw::ConstantOp, mlir::arith::ConstantOp>(operation);
+}
+
+/// Number of outer iterations after access `a` at which access `b` touches the
+/// same address, if some index of both is the outer induction var plus a
+/// constant. Returns 0 if `b` of a later iteration never aliases `a`.
+static Optional<int64_t> getDependenceDistance(MemAccess &a, MemAccess &b,
+                                               Value outerIV,
+                                               int64_t outerStep) {
+  for (size_t i = 0; i < a.indices.size(); i++) {
+    auto idxA = helper::splitConstantOffset(a.indices[i]);
+    auto idxB = helper::splitConstantOffset(b.indices[i]);
+    if (idxA.first != outerIV || idxB.first != outerIV)
+      continue;
+    // iv(n) + cA == iv(n + k) + cB  =>  k * step == cA - cB.
+    auto diff = idxA.second - idxB.second;
+    if (diff <= 0 || diff % outerStep != 0)
+      return 0;
+    return diff / outerStep;
+  }
+  return llvm::None;
+}
+
+/// Values in the outer body that are derived from the outer induction var
+/// through combinational logic. These change when the next outer iteration
+/// starts.
+static llvm::DenseSet<Value> getIVDependentValues(hir::ForOp outerOp) {
+  llvm::DenseSet<Value> ivDependent;
+  ivDependent.insert(outerOp.getInductionVar());
+  for (auto &operation : outerOp.getLoopBody().front()) {
+    if (!isa_and_nonnull<comb::CombDialect>(operation.getDialect()))
+      continue;
+    if (llvm::any_of(operation.getOperands(), [&ivDependent](Value operand) {
+          return ivDependent.contains(operand);
+        }))
+      for (auto result : operation.getResults())
+        ivDependent.insert(result);
+  }
+  return ivDependent;
+}
+
+/// Returns true if the op, or an op that encloses it, is scheduled at a static
+/// offset from the t_end of the loop.
+static bool isScheduledAfter(Operation *operation, hir::ForOp forOp) {
+  for (; operation && !isa<hir::FuncOp>(operation);
+       operation = operation->getParentOp()) {
+    auto scheduledOp = dyn_cast<hir::ScheduledOp>(operation);
+    if (!scheduledOp)
+      continue;
+    auto startTime = scheduledOp.getStartTime();
+    if (helper::getTimeOffsetFrom(startTime.getTimeVar(),
+                                  startTime.getOffset(), forOp.t_end()))
+      return true;
+  }
+  return false;
+}
+
+/// Ops outside the loop nest that are not scheduled after it may overlap it in
+/// time, e.g. sibling loops scheduled at static offsets. Overlapping the outer
+/// iterations changes the cycles in which the nest uses each port, so such ops
+/// must not use a port of the nest or write a memref that the nest accesses
+/// (or access one that the nest writes).
+static bool hasOverlappingAccessOutside(hir::ForOp outerOp,
+                                        ArrayRef<MemAccess> accesses) {
+  auto funcOp = outerOp->getParentOfType<hir::FuncOp>();
+  auto walkResult = funcOp.walk([&](Operation *operation) {
+    if (outerOp->isAncestor(operation))
+      return WalkResult::advance();
+    Value mem;
+    Optional<uint64_t> port;
+    bool isWrite = false;
+    if (auto op = dyn_cast<hir::LoadOp>(operation)) {
+      mem = op.mem();
+      port = op.port();
+    } else if (auto op = dyn_cast<hir::StoreOp>(operation)) {
+      mem = op.mem();
+      port = op.port();
+      isWrite = true;
+    } else if (isa<hir::CallOp>(operation)) {
+      // The callee may use any port of a memref that is passed to it.
+      for (auto &access : accesses)
+        if (llvm::is_contained(operation->getOperands(), access.mem) &&
+            !isScheduledAfter(operation, outerOp))
+          return WalkResult::interrupt();
+      return WalkResult::advance();
+    } else {
+      return WalkResult::advance();
+    }
+    for (auto &access : accesses)
+      if (access.mem == mem &&
+          (access.port == port || access.isWrite || isWrite) &&
+          !isScheduledAfter(operation, outerOp))
+        return WalkResult::interrupt();
+    return WalkResult::advance();
+  });
+  return walkResult.wasInterrupted();
+}
+
+static LogicalResult overlapLoopNest(hir::ForOp outerOp) {
+  Block &outerBody = outerOp.getLoopBody().front();
+  Value const tf = outerOp.getIterTimeVar();
+  if (!outerOp.iter_args().empty())
+    return failure();
+  auto outerStep = helper::getConstantIntValue(outerOp.step());
+  if (!outerStep || *outerStep <= 0)
+    return failure();
+  auto outerNextIterOp = cast<hir::NextIterOp>(outerBody.getTerminator());
+  if (outerNextIterOp.condition())
+    return failure();
+
+  hir::ForOp innerOp;
+  for (auto &operation : outerBody) {
+    auto forOp = dyn_cast<hir::ForOp>(operation);
+    if (!forOp)
+      continue;
+    if (innerOp)
+      return failure();
+    innerOp = forOp;
+  }
+  if (!innerOp)
+    return failure();
+
+  // Function calls and channels have state that we can not reason about here.
+  auto walkResult = outerOp.getLoopBody().walk([innerOp](Operation *operation) {
+    if (isa<hir::CallOp, hir::WhileOp, hir::BusSendOp, hir::BusRecvOp,
+            hir::FifoSendOp, hir::FifoRecvOp>(operation))
+      return WalkResult::interrupt();
+    if (isa<hir::ForOp>(operation) && operation != innerOp)
+      return WalkResult::interrupt();
+    return WalkResult::advance();
+  });
+  if (walkResult.wasInterrupted())
+    return failure();
+
+  auto innerLatency = helper::getStaticLatency(innerOp);
+  auto innerStart =
+      helper::getTimeOffsetFrom(innerOp.tstart(), innerOp.offset(), tf);
+  auto innerNextIterOp =
+      cast<hir::NextIterOp>(innerOp.getLoopBody().front().getTerminator());
+  auto innerII = helper::getTimeOffsetFrom(innerNextIterOp.tstart(),
+                                           innerNextIterOp.offset(),
+                                           innerOp.getIterTimeVar());
+  if (!innerLatency || !innerStart || !innerII || *innerII <= 0)
+    return failure();
+  int64_t const innerEnd = *innerStart + *innerLatency;
+  int64_t const innerTripCount = *innerLatency / *innerII;
+
+  // Offset of a time in the outer body from the start of the outer iteration.
+  auto getOuterTime = [&](Value timeVar, int64_t offset) -> Optional<int64_t> {
+    if (auto time = helper::getTimeOffsetFrom(timeVar, offset, tf))
+      return time;
+    if (auto time = helper::getTimeOffsetFrom(timeVar, offset, innerOp.t_end()))
+      return innerEnd + *time;
+    return llvm::None;
+  };
+
+  auto oldII = getOuterTime(outerNextIterOp.tstart(), outerNextIterOp.offset());
+  if (!oldII)
+    return failure();
+
+  // The inner loop can only restart after it is done.
+  int64_t newII = std::max(*innerLatency, (int64_t)1);
+
+  // Find the memory accesses and the cycles in which they are issued. An
+  // access in the inner loop body is issued once per inner iteration.
+  SmallVector<MemAccess> accesses;
+  walkResult = outerOp.getLoopBody().walk([&](Operation *operation) {
+    MemAccess access;
+    if (auto op = dyn_cast<hir::LoadOp>(operation)) {
+      access.mem = op.mem();
+      access.port = op.port();
+      access.indices.append(op.indices().begin(), op.indices().end());
+      access.isWrite = false;
+    } else if (auto op = dyn_cast<hir::StoreOp>(operation)) {
+      access.mem = op.mem();
+      access.port = op.port();
+      access.indices.append(op.indices().begin(), op.indices().end());
+      access.isWrite = true;
+    } else {
+      return WalkResult::advance();
+    }
+    auto startTime = dyn_cast<hir::ScheduledOp>(operation).getStartTime();
+    if (innerOp->isAncestor(operation)) {
+      auto time = helper::getTimeOffsetFrom(startTime.getTimeVar(),
+                                            startTime.getOffset(),
+                                            innerOp.getIterTimeVar());
+      if (!time)
+        return WalkResult::interrupt();
+      access.minTime = *innerStart + *time;
+      access.maxTime = access.minTime + (innerTripCount - 1) * *innerII;
+    } else {
+      auto time = getOuterTime(startTime.getTimeVar(), startTime.getOffset());
+      if (!time)
+        return WalkResult::interrupt();
+      access.minTime = access.maxTime = *time;
+    }
+    accesses.push_back(access);
+    return WalkResult::advance();
+  });
+  if (walkResult.wasInterrupted())
+    return failure();
+  if (hasOverlappingAccessOutside(outerOp, accesses))
+    return failure();
+
+  // Access b of outer iteration n+k must be issued after access a of
+  // iteration n if they use the same port, or if they may touch the same
+  // address and one of them writes.
+  for (auto &a : accesses) {
+    for (auto &b : accesses) {
+      if (a.mem != b.mem)
+        continue;
+      bool const samePort = a.port == b.port;
+      if (!samePort && !a.isWrite && !b.isWrite)
+        continue;
+      int64_t distance = 1;
+      if (!samePort) {
+        auto dist =
+            getDependenceDistance(a, b, outerOp.getInductionVar(), *outerStep);
+        if (dist && *dist == 0)
+          continue;
+        distance = dist.value_or(1);
+      }
+      int64_t const gap = a.maxTime - b.minTime + 1;
+      newII = std::max(newII, (gap + distance - 1) / distance);
+    }
+  }
+
+  // The outer induction var is only held until the next outer iteration
+  // starts, so every op that uses it must be issued before that.
+  auto ivDependent = getIVDependentValues(outerOp);
+  SmallVector<Value> carriedValues;
+  bool usesOuterValues = false;
+  innerOp.getLoopBody().walk([&](Operation *operation) {
+    for (auto operand : operation->getOperands()) {
+      if (operand.getParentRegion() != &outerOp.getLoopBody())
+        continue;
+      if (operand.getDefiningOp() && isConstantOp(operand.getDefiningOp()))
+        continue;
+      if (!ivDependent.contains(operand))
+        usesOuterValues = true;
+      else if (!llvm::is_contained(carriedValues, operand))
+        carriedValues.push_back(operand);
+    }
+  });
+  if (usesOuterValues)
+    return failure();
+  // The carried values enter the inner loop as iter_args at its start time.
+  if (!carriedValues.empty())
+    newII = std::max(newII, *innerStart + 1);
+  for (auto &operation : outerBody) {
+    auto scheduledOp = dyn_cast<hir::ScheduledOp>(operation);
+    if (!scheduledOp || llvm::none_of(operation.getOperands(), [&](Value v) {
+          return ivDependent.contains(v);
+        }))
+      continue;
+    auto startTime = scheduledOp.getStartTime();
+    auto time = getOuterTime(startTime.getTimeVar(), startTime.getOffset());
+    if (!time)
+      return failure();
+    newII = std::max(newII, *time + 1);
+  }
+
+  if (newII >= *oldII)
+    return failure();
+
+  if (!carriedValues.empty())
+    innerOp =
+        helper::addLoopInvariantIterArgs(innerOp, carriedValues, *innerII);
+
+  OpBuilder builder(outerNextIterOp);
+  builder.create<hir::NextIterOp>(outerNextIterOp.getLoc(), Value(),
+                                  ArrayRef<Value>(), tf,
+                                  builder.getI64IntegerAttr(newII));
+  outerNextIterOp.erase();
+  if (outerOp.initiation_interval())
+    outerOp->setAttr("initiation_interval", builder.getI64IntegerAttr(newII));
+
+  // The tail of the last outer iteration still runs after the outer loop's
+  // t_end.
+  builder.setInsertionPointAfter(outerOp);
+  auto timeOp = builder.create<hir::TimeOp>(
+      builder.getUnknownLoc(), helper::getTimeType(builder.getContext()),
+      outerOp.t_end(), builder.getI64IntegerAttr(*oldII - newII));
+  outerOp.t_end().replaceAllUsesExcept(timeOp, timeOp);
+  return success();
+}
+
+void OverlapLoopNestPass::runOnOperation() {
+  hir::FuncOp funcOp = getOperation();
+  SmallVector<hir::ForOp> forOps;
+  funcOp.walk([&forOps](hir::ForOp forOp) { forOps.push_back(forOp); });
+  for (auto forOp : forOps)
+    (void)overlapLoopNest(forOp);
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createOverlapLoopNestPass() {
+  return std::make_unique<OverlapLoopNestPass>();
+}
+} // namespace hir
+} // namespace circt
@@ -3,27 +3,34 @@
 #include "mlir/Transforms/Passes.h"
 
 void circt::hir::registerPassPipelines() {
+  // The per-function passes are nested under hir.func so that the pass manager
+  // can run them on different functions in parallel.
   mlir::PassPipelineRegistration<>(
       "hir-opt", "Optimize HIR dialect.", [](mlir::OpPassManager &pm) {
-        pm.addPass(circt::hir::createOptTimePass());
-        pm.addPass(mlir::createCanonicalizerPass());
-        pm.addPass(circt::hir::createOptBitWidthPass());
-        pm.addPass(mlir::createCanonicalizerPass());
-        pm.addPass(circt::hir::createOptDelayPass());
-        pm.addPass(mlir::createCanonicalizerPass());
-        pm.addPass(mlir::createSCCPPass());
-        pm.addPass(mlir::createCSEPass());
+        auto &funcPM = pm.nest<hir::FuncOp>();
+        funcPM.addPass(circt::hir::createDoubleBufferPass());
+        funcPM.addPass(circt::hir::createOverlapLoopNestPass());
+        funcPM.addPass(circt::hir::createOptTimePass());
+        funcPM.addPass(mlir::createCanonicalizerPass());
+        funcPM.addPass(circt::hir::createOptBitWidthPass());
+        funcPM.addPass(mlir::createCanonicalizerPass());
+        funcPM.addPass(circt::hir::createOptDelayPass());
+        funcPM.addPass(mlir::createCanonicalizerPass());
+        funcPM.addPass(mlir::createSCCPPass());
+        funcPM.addPass(mlir::createCSEPass());
       });
 
   mlir::PassPipelineRegistration<>(
       "hir-simplify",
       "Simplify HIR dialect to a bare minimum for lowering to verilog.",
       [](mlir::OpPassManager &pm) {
-        pm.addPass(mlir::createCanonicalizerPass());
-        pm.addPass(circt::hir::createLoopUnrollPass());
-        pm.addPass(mlir::createCanonicalizerPass());
-        pm.addPass(hir::createSimplifyCtrlPass());
-        pm.addPass(mlir::createSCCPPass());
+        auto &funcPM = pm.nest<hir::FuncOp>();
+        funcPM.addPass(mlir::createCanonicalizerPass());
+        funcPM.addPass(circt::hir::createLoopFlattenPass());
+        funcPM.addPass(circt::hir::createLoopUnrollPass());
+        funcPM.addPass(mlir::createCanonicalizerPass());
+        funcPM.addPass(hir::createSimplifyCtrlPass());
+        funcPM.addPass(mlir::createSCCPPass());
         pm.addPass(circt::hir::createMemrefLoweringPass());
         pm.addPass(mlir::createSCCPPass());
         pm.addPass(mlir::createCSEPass());
@@ -0,0 +1,160 @@
+//=========- ProfilePass.cpp - Profile hir.while trip counts-----------===//
+//
+// This file implements the collection of trip count profiles for hir.while
+// ops. hir-instrument-profile adds probes at the start of each loop and of each
+// iteration. utils/hir-vcd-profile.py counts them in a simulation dump and
+// writes a json profile, which hir-annotate-profile attaches to the ops as
+// `hir.profile` attributes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace circt;
+namespace {
+
+class InstrumentProfilePass
+    : public hir::InstrumentProfileBase<InstrumentProfilePass> {
+public:
+  void runOnOperation() override;
+};
+
+class AnnotateProfilePass
+    : public hir::AnnotateProfileBase<AnnotateProfilePass> {
+public:
+  void runOnOperation() override;
+
+private:
+  LogicalResult annotateLoop(Operation *, const llvm::json::Object &);
+};
+} // end anonymous namespace
+
+/// Names the hir.while ops of the function in pre-order. Both passes must name
+/// the same ops the same way.
+static SmallVector<std::pair<hir::WhileOp, std::string>>
+getProfiledOps(hir::FuncOp funcOp) {
+  SmallVector<std::pair<hir::WhileOp, std::string>> profiledOps;
+  std::string const funcName = funcOp.sym_name().str();
+  int64_t numWhileOps = 0;
+  funcOp.walk<WalkOrder::PreOrder>([&](hir::WhileOp whileOp) {
+    profiledOps.push_back(std::make_pair(
+        whileOp, funcName + "_while" + std::to_string(numWhileOps++)));
+  });
+  return profiledOps;
+}
+
+static Value getTimeVar(OpBuilder &builder, Value tstart, int64_t offset) {
+  if (offset == 0)
+    return tstart;
+  return builder.create<hir::TimeOp>(
+      builder.getUnknownLoc(), helper::getTimeType(builder.getContext()),
+      tstart, builder.getI64IntegerAttr(offset));
+}
+
+void InstrumentProfilePass::runOnOperation() {
+  for (auto &profiledOp : getProfiledOps(getOperation())) {
+    hir::WhileOp whileOp = profiledOp.first;
+    std::string const &name = profiledOp.second;
+    OpBuilder builder(whileOp);
+    auto uLoc = builder.getUnknownLoc();
+    // The trip count is the number of iterations between two starts.
+    builder.create<hir::ProbeOp>(
+        uLoc, getTimeVar(builder, whileOp.tstart(), whileOp.offset()),
+        name + "_start");
+    builder.setInsertionPointToStart(&whileOp.body().front());
+    builder.create<hir::ProbeOp>(uLoc, whileOp.getIterTimeVar(),
+                                 name + "_iter");
+  }
+}
+
+LogicalResult
+AnnotateProfilePass::annotateLoop(Operation *operation,
+                                  const llvm::json::Object &histogram) {
+  int64_t numExecutions = 0;
+  int64_t numIterations = 0;
+  int64_t maxTripCount = 0;
+  for (auto &kv : histogram) {
+    int64_t tripCount;
+    auto count = kv.second.getAsInteger();
+    if (StringRef(kv.first).getAsInteger(10, tripCount) || tripCount < 0 ||
+        !count || *count < 0)
+      return operation->emitError("Invalid trip count histogram in profile ")
+             << profile.getValue() << ".";
+    if (*count == 0)
+      continue;
+    numExecutions += *count;
+    numIterations += tripCount * *count;
+    maxTripCount = std::max(maxTripCount, tripCount);
+  }
+  if (numExecutions == 0)
+    return success();
+
+  Builder builder(operation->getContext());
+  operation->setAttr(
+      "hir.profile",
+      builder.getDictionaryAttr(
+          {builder.getNamedAttr("executions",
+                                builder.getI64IntegerAttr(numExecutions)),
+           builder.getNamedAttr(
+               "mean_trip_count",
+               builder.getI64IntegerAttr(
+                   (numIterations + numExecutions / 2) / numExecutions)),
+           builder.getNamedAttr("max_trip_count",
+                                builder.getI64IntegerAttr(maxTripCount))}));
+  return success();
+}
+
+void AnnotateProfilePass::runOnOperation() {
+  mlir::ModuleOp moduleOp = getOperation();
+  auto buffer = llvm::MemoryBuffer::getFile(profile);
+  if (!buffer) {
+    moduleOp.emitError("Could not open profile ")
+        << profile.getValue() << ".";
+    signalPassFailure();
+    return;
+  }
+  auto json = llvm::json::parse(buffer.get()->getBuffer());
+  if (!json) {
+    moduleOp.emitError("Could not parse profile ")
+        << profile.getValue() << ": " << llvm::toString(json.takeError());
+    signalPassFailure();
+    return;
+  }
+  auto *root = json->getAsObject();
+  if (!root) {
+    moduleOp.emitError("Expected a json object in profile ")
+        << profile.getValue() << ".";
+    signalPassFailure();
+    return;
+  }
+
+  auto *loops = root->getObject("loops");
+  if (!loops)
+    return;
+  for (auto funcOp : moduleOp.getOps<hir::FuncOp>()) {
+    for (auto &profiledOp : getProfiledOps(funcOp)) {
+      auto *histogram = loops->getObject(profiledOp.second);
+      if (!histogram)
+        continue;
+      if (failed(annotateLoop(profiledOp.first, *histogram))) {
+        signalPassFailure();
+        return;
+      }
+    }
+  }
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createInstrumentProfilePass() {
+  return std::make_unique<InstrumentProfilePass>();
+}
+std::unique_ptr<OperationPass<mlir::ModuleOp>> createAnnotateProfilePass() {
+  return std::make_unique<AnnotateProfilePass>();
+}
+} // namespace hir
+} // namespace circt
@@ -0,0 +1,128 @@
+//=========- ScalarReplacementPass.cpp - Replace memories by registers----===//
+//
+// This file implements scalar replacement of hir.alloca memories. A small
+// memory whose accesses all use constant indices is fully partitioned, so that
+// each element becomes a register.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+
+using namespace circt;
+namespace {
+
+class ScalarReplacementPass
+    : public hir::ScalarReplacementBase<ScalarReplacementPass> {
+public:
+  void runOnOperation() override;
+
+private:
+  bool canReplace(hir::AllocaOp);
+  void replace(hir::AllocaOp);
+};
+} // end anonymous namespace
+
+/// Returns the same indices as index typed constants, which every dimension of
+/// a fully banked memref expects.
+static SmallVector<Value> emitBankIndices(OpBuilder &builder,
+                                          OperandRange indices) {
+  SmallVector<Value> bankIndices;
+  for (auto idx : indices)
+    bankIndices.push_back(
+        helper::emitConstantOp(builder,
+                               helper::getConstantIntValue(idx).getValue()));
+  return bankIndices;
+}
+
+static bool hasConstantIndices(OperandRange indices) {
+  return llvm::all_of(indices, [](Value idx) {
+    return helper::getConstantIntValue(idx).hasValue();
+  });
+}
+
+bool ScalarReplacementPass::canReplace(hir::AllocaOp op) {
+  if (op.mem_kind() == hir::MemKindEnum::reg)
+    return false;
+  auto memrefTy = op.res().getType().dyn_cast<hir::MemrefType>();
+  int64_t numElements = 1;
+  for (auto dim : memrefTy.getShape())
+    numElements *= dim;
+  if (numElements > maxElements)
+    return false;
+
+  auto ports = helper::getMemrefPortInfos(op.ports());
+  for (auto *user : op.res().getUsers()) {
+    if (auto loadOp = dyn_cast<hir::LoadOp>(user)) {
+      if (!loadOp.port() || !hasConstantIndices(loadOp.indices()))
+        return false;
+      continue;
+    }
+    auto storeOp = dyn_cast<hir::StoreOp>(user);
+    if (!storeOp || !storeOp.port() || !hasConstantIndices(storeOp.indices()))
+      return false;
+    // A register is written one cycle after the store.
+    if (ports[storeOp.port().getValue()].wrLatency.value_or(0) != 1)
+      return false;
+  }
+  return true;
+}
+
+void ScalarReplacementPass::replace(hir::AllocaOp op) {
+  OpBuilder builder(op);
+  auto memrefTy = op.res().getType().dyn_cast<hir::MemrefType>();
+  SmallVector<hir::DimKind> dimKinds(memrefTy.getShape().size(),
+                                     hir::DimKind::BANK);
+  auto regOp = builder.create<hir::AllocaOp>(
+      op.getLoc(),
+      hir::MemrefType::get(builder.getContext(), memrefTy.getShape(),
+                           memrefTy.getElementType(), dimKinds),
+      hir::MemKindEnumAttr::get(builder.getContext(), hir::MemKindEnum::reg),
+      helper::getPortAttrForReg(builder));
+  auto zeroAttr = builder.getI64IntegerAttr(0);
+  auto oneAttr = builder.getI64IntegerAttr(1);
+
+  for (auto *user : llvm::make_early_inc_range(op.res().getUsers())) {
+    builder.setInsertionPoint(user);
+    if (auto loadOp = dyn_cast<hir::LoadOp>(user)) {
+      // The register is read combinationally, so the value is delayed by the
+      // read latency of the old port to keep the schedule unchanged.
+      Value value = builder.create<hir::LoadOp>(
+          loadOp.getLoc(), loadOp.res().getType(), regOp.res(),
+          emitBankIndices(builder, loadOp.indices()), zeroAttr, zeroAttr,
+          loadOp.tstart(), loadOp.offsetAttr());
+      if (loadOp.delay() != 0)
+        value = builder.create<hir::DelayOp>(
+            loadOp.getLoc(), value.getType(), value, loadOp.delayAttr(),
+            loadOp.tstart(), loadOp.offsetAttr());
+      loadOp.res().replaceAllUsesWith(value);
+      loadOp.erase();
+      continue;
+    }
+    auto storeOp = cast<hir::StoreOp>(user);
+    builder.create<hir::StoreOp>(
+        storeOp.getLoc(), storeOp.value(), regOp.res(),
+        emitBankIndices(builder, storeOp.indices()), oneAttr, oneAttr,
+        storeOp.tstart(), storeOp.offsetAttr());
+    storeOp.erase();
+  }
+  op.erase();
+}
+
+void ScalarReplacementPass::runOnOperation() {
+  SmallVector<hir::AllocaOp> allocaOps;
+  getOperation().walk(
+      [&allocaOps](hir::AllocaOp op) { allocaOps.push_back(op); });
+  for (auto op : allocaOps)
+    if (canReplace(op))
+      replace(op);
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createScalarReplacementPass() {
+  return std::make_unique<ScalarReplacementPass>();
+}
+} // namespace hir
+} // namespace circt
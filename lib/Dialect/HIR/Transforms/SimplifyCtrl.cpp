@@ -153,16 +153,19 @@ SmallVector<Value> inlineRegion(OpBuilder &builder,
 }
 
 LogicalResult SimplifyCtrlPass::visitOp(IfOp op) {
-  assert(op.offset() == 0);
   OpBuilder builder(op);
   builder.setInsertionPoint(op);
   BlockAndValueMapping ifRegionOperandMap;
   BlockAndValueMapping elseRegionOperandMap;
   auto c1 = helper::materializeIntegerConstant(builder, 1, 1);
+  Value tstart = op.tstart();
+  if (op.offset() != 0)
+    tstart = builder.create<hir::TimeOp>(
+        builder.getUnknownLoc(), helper::getTimeType(builder.getContext()),
+        op.tstart(), op.offsetAttr());
   Value tstartBus = builder.create<hir::CastOp>(
       builder.getUnknownLoc(),
-      hir::BusType::get(builder.getContext(), builder.getI1Type()),
-      op.tstart());
+      hir::BusType::get(builder.getContext(), builder.getI1Type()), tstart);
   auto conditionBus = builder.create<hir::BusOp>(
       builder.getUnknownLoc(),
       BusType::get(builder.getContext(), builder.getI1Type()));
@@ -30,66 +30,29 @@ static Value getConstantX(OpBuilder &builder, Type ty) {
   return builder.create<sv::ConstantXOp>(builder.getUnknownLoc(), ty);
 }
 
-hw::HWModuleOp emitForOPStateMachineModule(OpBuilder &builder, Type ivTy) {
-  OpBuilder::InsertionGuard guard(builder);
+/// Emit the loop state machine inline at the current insertion point.
+/// The logic is kept local to the function (instead of a separate hw module)
+/// so that SimplifyCtrl does not touch anything outside the function it runs
+/// on and can safely run in parallel on different functions.
+std::pair<Value, Value> insertForOpStateMachine(OpBuilder &builder,
+                                                Value isFirstIter, Value lb,
+                                                Value ub, Value step,
+                                                Value tstartLoopBody) {
   auto uLoc = builder.getUnknownLoc();
-  llvm::SmallVector<hw::PortInfo, 4> modPorts;
-  modPorts.push_back({.name = builder.getStringAttr("lb"),
-                      .direction = hw::PortDirection::INPUT,
-                      .type = ivTy,
-                      .argNum = 0});
-  modPorts.push_back({.name = builder.getStringAttr("ub"),
-                      .direction = hw::PortDirection::INPUT,
-                      .type = ivTy,
-                      .argNum = 1});
-  modPorts.push_back({.name = builder.getStringAttr("step"),
-                      .direction = hw::PortDirection::INPUT,
-                      .type = ivTy,
-                      .argNum = 2});
-  modPorts.push_back({.name = builder.getStringAttr("start"),
-                      .direction = hw::PortDirection::INPUT,
-                      .type = builder.getI1Type(),
-                      .argNum = 3});
-  modPorts.push_back({.name = builder.getStringAttr("next"),
-                      .direction = hw::PortDirection::INPUT,
-                      .type = builder.getI1Type(),
-                      .argNum = 4});
-  modPorts.push_back({.name = builder.getStringAttr("clk"),
-                      .direction = hw::PortDirection::INPUT,
-                      .type = builder.getI1Type(),
-                      .argNum = 5});
-  modPorts.push_back({.name = builder.getStringAttr("rst"),
-                      .direction = hw::PortDirection::INPUT,
-                      .type = builder.getI1Type(),
-                      .argNum = 6});
-  modPorts.push_back({.name = builder.getStringAttr("iv"),
-                      .direction = hw::PortDirection::OUTPUT,
-                      .type = ivTy,
-                      .argNum = 0});
-  modPorts.push_back({.name = builder.getStringAttr("done"),
-                      .direction = hw::PortDirection::OUTPUT,
-                      .type = builder.getI1Type(),
-                      .argNum = 1});
-  builder.setInsertionPointToStart(&builder.getBlock()
-                                        ->getParentOp()
-                                        ->getParentOfType<mlir::ModuleOp>()
-                                        .getBodyRegion()
-                                        .getBlocks()
-                                        .front());
-  static int n = 0;
-  auto moduleOp = builder.create<hw::HWModuleOp>(
-      uLoc, builder.getStringAttr("ForOp_state_machine" + std::to_string(n++)),
-      modPorts);
-
-  auto lb = moduleOp.getArgument(0);
-  auto ub = moduleOp.getArgument(1);
-  auto step = moduleOp.getArgument(2);
-  auto start = moduleOp.getArgument(3);
-  auto next = moduleOp.getArgument(4);
-  auto clk = moduleOp.getArgument(5);
-  auto reset = moduleOp.getArgument(6);
+  auto start = isFirstIter;
+  auto next = builder
+                  .create<hir::CastOp>(builder.getUnknownLoc(),
+                                       builder.getI1Type(), tstartLoopBody)
+                  .getResult();
+  auto clk = builder
+                 .create<hir::GetClockOp>(builder.getUnknownLoc(),
+                                          builder.getI1Type(), tstartLoopBody)
+                 .getResult();
+  auto reset = builder
+                   .create<hir::GetResetOp>(builder.getUnknownLoc(),
+                                            builder.getI1Type(), tstartLoopBody)
+                   .getResult();
 
-  builder.setInsertionPointToStart(moduleOp.getBodyBlock());
   auto zeroBit = helper::materializeIntegerConstant(builder, 0, 1);
   auto lbWide =
       builder.create<comb::ConcatOp>(uLoc, ArrayRef<Value>({zeroBit, lb}));
@@ -146,35 +109,5 @@ hw::HWModuleOp emitForOPStateMachineModule(OpBuilder &builder, Type ivTy) {
   auto done = builder.create<sv::ReadInOutOp>(uLoc, doneReg);
   auto iv = builder.create<comb::ExtractOp>(uLoc, lb.getType(), ivWide,
                                             builder.getI32IntegerAttr(0));
-
-  Operation *oldOutputOp = moduleOp.getBodyBlock()->getTerminator();
-  oldOutputOp->replaceAllUsesWith(builder.create<hw::OutputOp>(
-      uLoc, llvm::SmallVector<mlir::Value, 2>({iv, done})));
-  oldOutputOp->erase();
-  return moduleOp;
+  return std::make_pair(done.getResult(), iv.getResult());
 }
-
-std::pair<Value, Value> insertForOpStateMachine(OpBuilder &builder,
-                                                Value isFirstIter, Value lb,
-                                                Value ub, Value step,
-                                                Value tstartLoopBody) {
-  static int n = 0;
-  auto module = emitForOPStateMachineModule(builder, lb.getType());
-  auto next = builder
-                  .create<hir::CastOp>(builder.getUnknownLoc(),
-                                       builder.getI1Type(), tstartLoopBody)
-                  .getResult();
-  auto clk = builder
-                 .create<hir::GetClockOp>(builder.getUnknownLoc(),
-                                          builder.getI1Type(), tstartLoopBody)
-                 .getResult();
-  auto reset = builder
-                   .create<hir::GetResetOp>(builder.getUnknownLoc(),
-                                            builder.getI1Type(), tstartLoopBody)
-                   .getResult();
-  auto sm = builder.create<hw::InstanceOp>(
-      builder.getUnknownLoc(), module, "ForOP_SM" + std::to_string(n++),
-      llvm::SmallVector({lb, ub, step, isFirstIter, next, clk, reset}),
-      ArrayAttr(), StringAttr());
-  return std::make_pair(sm.getResult(1), sm.getResult(0));
-}
\ No newline at end of file
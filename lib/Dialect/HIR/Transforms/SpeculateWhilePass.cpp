@@ -0,0 +1,303 @@
+//=========- SpeculateWhilePass.cpp - Speculative hir.while loops-----===//
+//
+// This file implements speculative pipelining of hir.while loops. Normally the
+// next iteration of a while loop starts after the loop condition of the
+// current one is computed, so data-dependent loops (search, histogram binning)
+// can not be pipelined. Here the next iteration starts every II cycles, before
+// the condition is known. Each iteration writes its exit into a one bit
+// register, and reads the exits of the earlier iterations once they have all
+// resolved. The stores of an iteration that was started after the loop exited
+// are squashed by a hir.if on that bit. Stores that are issued earlier are
+// buffered (delayed) until the bit is known. Loops that read and write the
+// same memref are not speculated.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "circt/Dialect/HW/HWOps.h"
+
+using namespace circt;
+namespace {
+
+class SpeculateWhilePass
+    : public hir::SpeculateWhileBase<SpeculateWhilePass> {
+public:
+  void runOnOperation() override;
+
+private:
+  LogicalResult speculateWhile(hir::WhileOp);
+};
+} // end anonymous namespace
+
+static bool isConstantOp(Operation *operation) {
+  return isa<hw::ConstantOp, mlir::arith::ConstantOp>(operation);
+}
+
+/// Offset from the start of the iteration at which the value becomes valid.
+/// Only values computed through combinational logic, hir.delay and hir.load
+/// are tracked.
+static Optional<int64_t> getValidOffset(Value v, hir::WhileOp op) {
+  if (!op.body().isAncestor(v.getParentRegion()))
+    return 0;
+  if (v.isa<BlockArgument>())
+    return 0;
+  Operation *operation = v.getDefiningOp();
+  if (isConstantOp(operation))
+    return 0;
+  if (isa_and_nonnull<comb::CombDialect>(operation->getDialect())) {
+    int64_t offset = 0;
+    for (auto operand : operation->getOperands()) {
+      auto operandOffset = getValidOffset(operand, op);
+      if (!operandOffset)
+        return llvm::None;
+      offset = std::max(offset, *operandOffset);
+    }
+    return offset;
+  }
+  Optional<int64_t> time;
+  int64_t delay = 0;
+  if (auto delayOp = dyn_cast<hir::DelayOp>(operation)) {
+    time = helper::getTimeOffsetFrom(delayOp.tstart(), delayOp.offset(),
+                                     op.getIterTimeVar());
+    delay = delayOp.delay();
+  } else if (auto loadOp = dyn_cast<hir::LoadOp>(operation)) {
+    time = helper::getTimeOffsetFrom(loadOp.tstart(), loadOp.offset(),
+                                     op.getIterTimeVar());
+    delay = loadOp.delay();
+  }
+  if (!time)
+    return llvm::None;
+  return *time + delay;
+}
+
+LogicalResult SpeculateWhilePass::speculateWhile(hir::WhileOp op) {
+  Block &body = op.body().front();
+  Value const ti = op.getIterTimeVar();
+  int64_t const newII = ii;
+  auto nextIterOp = cast<hir::NextIterOp>(body.getTerminator());
+  auto latency =
+      helper::getTimeOffsetFrom(nextIterOp.tstart(), nextIterOp.offset(), ti);
+  if (!nextIterOp.condition() || !latency || *latency <= newII)
+    return failure();
+  if (!op.iterResults().use_empty())
+    return failure();
+
+  // Each iteration saves latency - II cycles, and the iterations in flight at
+  // the exit take about latency cycles more. Loops that are known (from
+  // hir-annotate-profile) to exit early are left alone.
+  if (auto profile = op->getAttrOfType<DictionaryAttr>("hir.profile"))
+    if (auto tripCount = profile.getAs<IntegerAttr>("mean_trip_count"))
+      if ((tripCount.getInt() - 1) * (*latency - newII) <= *latency)
+        return failure();
+  if (auto delays = op.iter_arg_delays())
+    for (auto delay : *delays)
+      if (delay.cast<IntegerAttr>().getInt() != 0)
+        return failure();
+
+  // The exits of all earlier iterations are known from this offset on.
+  int64_t const squashOffset = *latency - newII + 1;
+
+  // Calls and channels have side effects that can not be squashed.
+  SmallVector<hir::StoreOp> storeOps;
+  SmallVector<std::pair<Operation *, int64_t>> memAccesses;
+  for (auto &operation : body) {
+    if (isa<hir::CallOp, hir::ForOp, hir::WhileOp, hir::IfOp, hir::BusSendOp,
+            hir::BusRecvOp, hir::FifoSendOp, hir::FifoRecvOp>(operation))
+      return failure();
+    auto scheduledOp = dyn_cast<hir::ScheduledOp>(operation);
+    if (!scheduledOp)
+      continue;
+    auto startTime = scheduledOp.getStartTime();
+    auto time = helper::getTimeOffsetFrom(startTime.getTimeVar(),
+                                          startTime.getOffset(), ti);
+    if (!time)
+      return failure();
+    if (auto storeOp = dyn_cast<hir::StoreOp>(operation)) {
+      // Buffered indices are delayed, which is not supported for bank
+      // indices.
+      if (*time < squashOffset)
+        for (auto idx : storeOp.indices())
+          if (idx.getType().isa<IndexType>() &&
+              !helper::getConstantIntValue(idx))
+            return failure();
+      storeOps.push_back(storeOp);
+      memAccesses.push_back(
+          std::make_pair(&operation, std::max(*time, squashOffset)));
+    } else if (isa<hir::LoadOp>(operation)) {
+      memAccesses.push_back(std::make_pair(&operation, *time));
+    }
+  }
+
+  // Overlapped iterations would read a memref before the earlier iterations
+  // have written it. Dependence distances are not analysed, so any memref that
+  // is both read and written in the body is refused.
+  for (auto storeOp : storeOps)
+    for (auto &access : memAccesses)
+      if (auto loadOp = dyn_cast<hir::LoadOp>(access.first))
+        if (loadOp.mem() == storeOp.mem())
+          return failure();
+
+  // Delaying the stores must not make two accesses share a port in the same
+  // cycle of the new schedule.
+  auto getMemAndPort = [](Operation *operation) {
+    if (auto loadOp = dyn_cast<hir::LoadOp>(operation))
+      return std::make_pair(loadOp.mem(), loadOp.port());
+    auto storeOp = cast<hir::StoreOp>(operation);
+    return std::make_pair(storeOp.mem(), storeOp.port());
+  };
+  for (size_t i = 0; i < memAccesses.size(); i++)
+    for (size_t j = i + 1; j < memAccesses.size(); j++)
+      if (getMemAndPort(memAccesses[i].first) ==
+              getMemAndPort(memAccesses[j].first) &&
+          (memAccesses[i].second - memAccesses[j].second) % newII == 0)
+        return failure();
+
+  // The next iteration starts at offset II, so the iter_args must be ready by
+  // then.
+  SmallVector<int64_t> iterArgOffsets;
+  for (auto iterArg : nextIterOp.iter_args()) {
+    auto offset = getValidOffset(iterArg, op);
+    if (!offset || *offset > newII)
+      return failure();
+    iterArgOffsets.push_back(*offset);
+  }
+
+  OpBuilder builder(op);
+  auto uLoc = builder.getUnknownLoc();
+  auto *context = builder.getContext();
+  auto zeroAttr = builder.getI64IntegerAttr(0);
+  auto oneAttr = builder.getI64IntegerAttr(1);
+
+  // A register that is set when an iteration exits the loop. Port 0 is read
+  // inside the loop and port 1 is written.
+  auto rdPort = builder.getDictionaryAttr(
+      builder.getNamedAttr("rd_latency", builder.getI64IntegerAttr(0)));
+  auto wrPort = builder.getDictionaryAttr(
+      builder.getNamedAttr("wr_latency", builder.getI64IntegerAttr(1)));
+  Value const exitFlag = builder.create<hir::AllocaOp>(
+      uLoc,
+      hir::MemrefType::get(context, 1, builder.getI1Type(),
+                           hir::DimKind::BANK),
+      hir::MemKindEnumAttr::get(context, hir::MemKindEnum::reg),
+      builder.getArrayAttr({rdPort, wrPort}));
+  Value const c0 = helper::emitConstantOp(builder, 0);
+  Value const falseVal = builder.create<hw::ConstantOp>(
+      uLoc, IntegerAttr::get(builder.getI1Type(), 0));
+  Value const trueVal = builder.create<hw::ConstantOp>(
+      uLoc, IntegerAttr::get(builder.getI1Type(), 1));
+  builder.create<hir::StoreOp>(uLoc, falseVal, exitFlag, ArrayRef<Value>(c0),
+                               oneAttr, oneAttr, op.tstart(), op.offsetAttr());
+
+  // live = !(some earlier iteration has exited).
+  builder.setInsertionPointToStart(&body);
+  Value const exited = builder.create<hir::LoadOp>(
+      uLoc, builder.getI1Type(), exitFlag, ArrayRef<Value>(c0), zeroAttr,
+      zeroAttr, ti, builder.getI64IntegerAttr(squashOffset));
+  Value const live = builder.create<comb::XorOp>(uLoc, exited, trueVal);
+
+  // The exit of this iteration is recorded (unless it is squashed itself).
+  builder.setInsertionPoint(nextIterOp);
+  storeOps.push_back(builder.create<hir::StoreOp>(
+      uLoc, nextIterOp.condition(), exitFlag, ArrayRef<Value>(c0), oneAttr,
+      oneAttr, ti, builder.getI64IntegerAttr(*latency)));
+
+  int64_t drainOffset = 0;
+  for (auto storeOp : storeOps) {
+    int64_t const time = *helper::getTimeOffsetFrom(storeOp.tstart(),
+                                                    storeOp.offset(), ti);
+    int64_t const newTime = std::max(time, squashOffset);
+    drainOffset = std::max(drainOffset, newTime + (int64_t)storeOp.delay());
+    builder.setInsertionPoint(storeOp);
+
+    // Buffer the store until the exits of the earlier iterations are known.
+    auto delayUntilSquash = [&](Value v) -> Value {
+      if (newTime == time || helper::getConstantIntValue(v))
+        return v;
+      return builder.create<hir::DelayOp>(
+          uLoc, v.getType(), v, builder.getI64IntegerAttr(newTime - time),
+          storeOp.tstart(), storeOp.offsetAttr());
+    };
+    Value const value = delayUntilSquash(storeOp.value());
+    SmallVector<Value> indices;
+    for (auto idx : storeOp.indices())
+      indices.push_back(delayUntilSquash(idx));
+
+    Value liveAtStore = live;
+    if (newTime > squashOffset)
+      liveAtStore = builder.create<hir::DelayOp>(
+          uLoc, builder.getI1Type(), live,
+          builder.getI64IntegerAttr(newTime - squashOffset), ti,
+          builder.getI64IntegerAttr(squashOffset));
+
+    auto ifOp = builder.create<hir::IfOp>(uLoc, TypeRange(), liveAtStore, ti,
+                                          builder.getI64IntegerAttr(newTime),
+                                          ArrayAttr());
+    for (auto *region : {&ifOp.if_region(), &ifOp.else_region()}) {
+      builder.createBlock(region, {}, helper::getTimeType(context), uLoc);
+      builder.create<hir::YieldOp>(uLoc);
+    }
+    builder.setInsertionPointToStart(&ifOp.if_region().front());
+    builder.create<hir::StoreOp>(uLoc, value, storeOp.mem(), indices,
+                                 storeOp.portAttr(), storeOp.delayAttr(),
+                                 ifOp.getRegionTimeVar(), zeroAttr);
+    storeOp.erase();
+  }
+
+  // The next iteration starts after II cycles and breaks if the loop has
+  // exited by then.
+  builder.setInsertionPoint(nextIterOp);
+  Value const exitedAtII = builder.create<hir::LoadOp>(
+      uLoc, builder.getI1Type(), exitFlag, ArrayRef<Value>(c0), zeroAttr,
+      zeroAttr, ti, builder.getI64IntegerAttr(newII));
+  SmallVector<Value> iterArgs;
+  for (size_t i = 0; i < iterArgOffsets.size(); i++) {
+    Value iterArg = nextIterOp.iter_args()[i];
+    if (iterArgOffsets[i] < newII)
+      iterArg = builder.create<hir::DelayOp>(
+          uLoc, iterArg.getType(), iterArg,
+          builder.getI64IntegerAttr(newII - iterArgOffsets[i]), ti,
+          builder.getI64IntegerAttr(iterArgOffsets[i]));
+    iterArgs.push_back(iterArg);
+  }
+  builder.create<hir::NextIterOp>(nextIterOp.getLoc(), exitedAtII, iterArgs,
+                                  ti, builder.getI64IntegerAttr(newII));
+  nextIterOp.erase();
+  // The schedule verifier checks that each store of the body is squashed by a
+  // hir.if issued at or after this offset.
+  op->setAttr("squash_offset", builder.getI64IntegerAttr(squashOffset));
+
+  // The iterations in flight when the loop exits still run after its t_end.
+  if (drainOffset > newII) {
+    builder.setInsertionPointAfter(op);
+    auto timeOp = builder.create<hir::TimeOp>(
+        uLoc, helper::getTimeType(context), op.t_end(),
+        builder.getI64IntegerAttr(drainOffset - newII));
+    op.t_end().replaceAllUsesExcept(timeOp, timeOp);
+  }
+  return success();
+}
+
+void SpeculateWhilePass::runOnOperation() {
+  hir::FuncOp funcOp = getOperation();
+  if (ii == 0) {
+    funcOp.emitError("hir-speculate-while: ii must be positive.");
+    signalPassFailure();
+    return;
+  }
+  SmallVector<hir::WhileOp> whileOps;
+  funcOp.walk(
+      [&whileOps](hir::WhileOp whileOp) { whileOps.push_back(whileOp); });
+  for (auto whileOp : whileOps)
+    (void)speculateWhile(whileOp);
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createSpeculateWhilePass() {
+  return std::make_unique<SpeculateWhilePass>();
+}
+} // namespace hir
+} // namespace circt
@@ -0,0 +1,297 @@
+//=========- StencilWindowPass.cpp - Reuse stencil loads---===//
+//
+// This file implements the sliding window transformation. Loads inside a
+// pipelined loop that read A[iv + c] for a few constant offsets c are replaced
+// by a shift register carried in the loop's iter_args, so each element of A is
+// read from memory only once.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "llvm/ADT/DenseMap.h"
+
+using namespace circt;
+
+/// Windows larger than this are left to memory.
+static const int64_t kMaxWindowSize = 16;
+
+namespace {
+
+class StencilWindowPass : public hir::StencilWindowBase<StencilWindowPass> {
+public:
+  void runOnOperation() override;
+};
+
+/// A set of loads in a loop body that only differ by a constant offset to the
+/// induction var in one index. The loads of a window are issued in the same
+/// cycle, so they may use different ports of the memref.
+struct StencilWindow {
+  Value mem;
+  unsigned dim;
+  Value base;
+  int64_t timeOffset;
+  SmallVector<std::pair<hir::LoadOp, int64_t>> loads;
+};
+} // end anonymous namespace
+
+/// The base must advance by the loop step every iteration.
+static bool isInductionVarOrSlice(Value base, Value iv) {
+  if (base == iv)
+    return true;
+  auto extractOp = dyn_cast_or_null<comb::ExtractOp>(base.getDefiningOp());
+  return extractOp && extractOp.input() == iv && extractOp.lowBit() == 0;
+}
+
+static bool isDefinedInside(Value v, hir::ForOp forOp) {
+  return forOp.getLoopBody().isAncestor(v.getParentRegion());
+}
+
+/// Returns true if the memref is written, or handed to a call, in the loop.
+static bool mayBeWrittenInLoop(Value mem, hir::ForOp forOp) {
+  bool isWritten = false;
+  forOp.walk([&](Operation *operation) {
+    if (auto storeOp = dyn_cast<hir::StoreOp>(operation))
+      isWritten |= storeOp.mem() == mem;
+    else if (isa<hir::CallOp>(operation))
+      isWritten |= llvm::is_contained(operation->getOperands(), mem);
+  });
+  return isWritten;
+}
+
+static SmallVector<StencilWindow> findWindows(hir::ForOp forOp) {
+  SmallVector<StencilWindow> windows;
+  Value const iv = forOp.getInductionVar();
+  for (auto loadOp : forOp.getLoopBody().front().getOps<hir::LoadOp>()) {
+    auto timeOffset = helper::getTimeOffsetFrom(
+        loadOp.tstart(), loadOp.offset(), forOp.getIterTimeVar());
+    if (!timeOffset)
+      continue;
+
+    // Exactly one index may depend on the loop.
+    Optional<unsigned> dim;
+    for (size_t i = 0; i < loadOp.indices().size(); i++) {
+      if (!isDefinedInside(loadOp.indices()[i], forOp))
+        continue;
+      if (dim) {
+        dim = llvm::None;
+        break;
+      }
+      dim = i;
+    }
+    if (!dim)
+      continue;
+    auto baseAndOffset = helper::splitConstantOffset(loadOp.indices()[*dim]);
+    if (!isInductionVarOrSlice(baseAndOffset.first, iv))
+      continue;
+
+    auto *window = llvm::find_if(windows, [&](StencilWindow &w) {
+      auto other = w.loads.front().first;
+      if (w.mem != loadOp.mem() || w.dim != *dim ||
+          w.base != baseAndOffset.first || w.timeOffset != *timeOffset ||
+          other.delay() != loadOp.delay())
+        return false;
+      for (size_t i = 0; i < loadOp.indices().size(); i++)
+        if (i != *dim && other.indices()[i] != loadOp.indices()[i])
+          return false;
+      return true;
+    });
+    if (window == windows.end()) {
+      windows.push_back(StencilWindow{loadOp.mem(), *dim, baseAndOffset.first,
+                                      *timeOffset, {}});
+      window = &windows.back();
+    }
+    window->loads.push_back(std::make_pair(loadOp, baseAndOffset.second));
+  }
+  return windows;
+}
+
+/// Replaces all but the leading load of the window with a shift register.
+/// The loop start is delayed so that the registers can be filled, through the
+/// port of the leading load, before the first iteration. Ops outside the loop
+/// that are scheduled at static offsets from the same time var are not checked
+/// against the fill loads or the shifted loop.
+static LogicalResult insertShiftRegister(hir::ForOp forOp,
+                                         StencilWindow &window, int64_t step,
+                                         int64_t lb, int64_t ii) {
+  int64_t minOffset = window.loads.front().second;
+  int64_t maxOffset = minOffset;
+  for (auto loadAndOffset : window.loads) {
+    minOffset = std::min(minOffset, loadAndOffset.second);
+    maxOffset = std::max(maxOffset, loadAndOffset.second);
+  }
+  if (minOffset == maxOffset)
+    return failure();
+  for (auto loadAndOffset : window.loads)
+    if ((maxOffset - loadAndOffset.second) % step != 0)
+      return failure();
+  int64_t const windowSize = (maxOffset - minOffset) / step + 1;
+  if (windowSize > kMaxWindowSize)
+    return failure();
+  if (mayBeWrittenInLoop(window.mem, forOp))
+    return failure();
+
+  // Earliest access to the memref in an iteration.
+  int64_t firstAccess = window.timeOffset;
+  bool hasUnknownTime = false;
+  forOp.walk([&](hir::LoadOp loadOp) {
+    if (loadOp.mem() != window.mem)
+      return;
+    auto timeOffset = helper::getTimeOffsetFrom(
+        loadOp.tstart(), loadOp.offset(), forOp.getIterTimeVar());
+    if (!timeOffset)
+      hasUnknownTime = true;
+    else
+      firstAccess = std::min(firstAccess, *timeOffset);
+  });
+  if (hasUnknownTime)
+    return failure();
+  int64_t const shift = windowSize - 1 + window.timeOffset - firstAccess;
+
+  // The first load of the largest offset stays. The others read what it read
+  // some iterations ago.
+  hir::LoadOp leadingLoad;
+  llvm::DenseMap<Operation *, int64_t> windowPos;
+  for (auto loadAndOffset : window.loads) {
+    if (!leadingLoad && loadAndOffset.second == maxOffset)
+      leadingLoad = loadAndOffset.first;
+    else
+      windowPos[loadAndOffset.first] =
+          (loadAndOffset.second - minOffset) / step;
+  }
+  int64_t const delay = leadingLoad.delay();
+  int64_t const valueTime = window.timeOffset + delay;
+
+  // Fill the shift register with the elements of the first iteration.
+  OpBuilder builder(forOp);
+  auto uLoc = builder.getUnknownLoc();
+  auto idxTy = leadingLoad.indices()[window.dim].getType();
+  SmallVector<Value> iterArgs(forOp.iter_args().begin(),
+                              forOp.iter_args().end());
+  for (int64_t pos = 0; pos < windowSize - 1; pos++) {
+    SmallVector<Value> indices(leadingLoad.indices().begin(),
+                               leadingLoad.indices().end());
+    indices[window.dim] = builder.create<hw::ConstantOp>(
+        uLoc, IntegerAttr::get(idxTy, lb + minOffset + pos * step));
+    int64_t const loadTime = forOp.offset() + window.timeOffset + pos;
+    Value v = builder.create<hir::LoadOp>(
+        uLoc, leadingLoad.getResult().getType(), window.mem, indices,
+        leadingLoad.portAttr(), leadingLoad.delayAttr(), forOp.tstart(),
+        builder.getI64IntegerAttr(loadTime));
+    v = builder.create<hir::DelayOp>(
+        uLoc, v.getType(), v, builder.getI64IntegerAttr(shift - pos),
+        forOp.tstart(), builder.getI64IntegerAttr(loadTime + delay));
+    iterArgs.push_back(v);
+  }
+
+  auto numOldIterArgs = forOp.iter_args().size();
+  BlockAndValueMapping operandMap;
+  auto newForOp = builder.create<hir::ForOp>(
+      forOp.getLoc(), forOp.lb(), forOp.ub(), forOp.step(), iterArgs,
+      forOp.tstart(), builder.getI64IntegerAttr(forOp.offset() + shift),
+      [&](OpBuilder &builder, Value iv, ArrayRef<Value> newIterArgs,
+          Value tLoopBody) {
+        Block &body = forOp.getLoopBody().front();
+        for (size_t i = 0; i < numOldIterArgs; i++)
+          operandMap.map(body.getArgument(i), newIterArgs[i]);
+        operandMap.map(forOp.getInductionVar(), iv);
+        operandMap.map(forOp.getIterTimeVar(), tLoopBody);
+        auto windowRegs = newIterArgs.drop_front(numOldIterArgs);
+        for (auto &operation : body) {
+          auto pos = windowPos.find(&operation);
+          if (pos == windowPos.end()) {
+            if (!isa<hir::NextIterOp>(operation))
+              builder.clone(operation, operandMap);
+            continue;
+          }
+          Value const reg = pos->second < windowSize - 1
+                                ? windowRegs[pos->second]
+                                : operandMap.lookup(leadingLoad.getResult());
+          operandMap.map(operation.getResult(0), reg);
+        }
+
+        // Shift the window by one position every iteration.
+        auto nextIterOp = cast<hir::NextIterOp>(body.getTerminator());
+        SmallVector<Value> nextIterArgs;
+        for (auto arg : nextIterOp.iter_args())
+          nextIterArgs.push_back(helper::lookupOrOriginal(operandMap, arg));
+        for (int64_t pos = 0; pos < windowSize - 1; pos++) {
+          Value const v = pos + 1 < windowSize - 1
+                              ? windowRegs[pos + 1]
+                              : operandMap.lookup(leadingLoad.getResult());
+          nextIterArgs.push_back(builder.create<hir::DelayOp>(
+              uLoc, v.getType(), v, builder.getI64IntegerAttr(ii), tLoopBody,
+              builder.getI64IntegerAttr(valueTime)));
+        }
+        return builder.create<hir::NextIterOp>(
+            nextIterOp.getLoc(), Value(), nextIterArgs,
+            helper::lookupOrOriginal(operandMap, nextIterOp.tstart()),
+            nextIterOp.offsetAttr());
+      });
+
+  for (auto attr : forOp->getAttrs())
+    if (attr.getName() != "offset")
+      newForOp->setAttr(attr.getName(), attr.getValue());
+  SmallVector<int64_t> iterArgDelays;
+  if (auto delays = forOp.iter_arg_delays())
+    for (auto delay : delays.getValue())
+      iterArgDelays.push_back(delay.cast<IntegerAttr>().getInt());
+  iterArgDelays.resize(numOldIterArgs, 0);
+  iterArgDelays.append(windowSize - 1, valueTime);
+  newForOp->setAttr("iter_arg_delays",
+                    builder.getI64ArrayAttr(iterArgDelays));
+
+  for (size_t i = 0; i < numOldIterArgs; i++)
+    forOp.getResult(i).replaceAllUsesWith(newForOp.getResult(i));
+  forOp.t_end().replaceAllUsesWith(newForOp.t_end());
+  forOp.erase();
+  return success();
+}
+
+static LogicalResult insertShiftRegister(hir::ForOp forOp) {
+  if (!forOp.getInductionVar().getType().isa<IntegerType>())
+    return failure();
+  auto nextIterOp =
+      cast<hir::NextIterOp>(forOp.getLoopBody().front().getTerminator());
+  if (nextIterOp.condition())
+    return failure();
+  auto ii = helper::getTimeOffsetFrom(nextIterOp.tstart(), nextIterOp.offset(),
+                                      forOp.getIterTimeVar());
+  auto lb = helper::getConstantIntValue(forOp.lb());
+  auto step = helper::getConstantIntValue(forOp.step());
+  if (!ii || *ii <= 0 || !lb || !step || *step <= 0)
+    return failure();
+
+  for (auto &window : findWindows(forOp))
+    if (window.loads.size() > 1 &&
+        succeeded(insertShiftRegister(forOp, window, *step, *lb, *ii)))
+      return success();
+  return failure();
+}
+
+void StencilWindowPass::runOnOperation() {
+  hir::FuncOp funcOp = getOperation();
+  // Each rewrite replaces the loop, so start over after every change.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    funcOp.walk([&changed](hir::ForOp forOp) {
+      if (failed(insertShiftRegister(forOp)))
+        return WalkResult::advance();
+      changed = true;
+      return WalkResult::interrupt();
+    });
+  }
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createStencilWindowPass() {
+  return std::make_unique<StencilWindowPass>();
+}
+} // namespace hir
+} // namespace circt
@@ -13,6 +13,8 @@
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Value.h"
 #include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 #include <functional>
 #include <list>
@@ -21,6 +23,20 @@
 using namespace circt;
 using namespace hir;
 using namespace llvm;
+
+namespace {
+/// A load or store along with its start time relative to the root time var.
+struct MemAccess {
+  Operation *operation;
+  Optional<uint64_t> port;
+  SmallVector<Value> bankIndices;
+  SmallVector<Value> addrIndices;
+  Time rootTime;
+  int64_t delay;
+  bool isWrite;
+};
+} // namespace
+
 class VerifySchedulePass : public hir::VerifyScheduleBase<VerifySchedulePass> {
 public:
   void runOnOperation() override;
@@ -28,28 +44,171 @@ public:
 private:
   LogicalResult verifyCombOp(Operation *);
   LogicalResult verifyOp(ScheduledOp);
+  LogicalResult verifyOp(hir::ReturnOp);
+  LogicalResult verifySpeculation(hir::WhileOp);
   LogicalResult verifyOperation(Operation *);
+  void registerMemAccess(Operation *, Value mem, Optional<uint64_t> port,
+                         SmallVector<Value> bankIndices,
+                         SmallVector<Value> addrIndices, int64_t delay,
+                         bool isWrite);
+  LogicalResult verifyMemAccesses();
+  LogicalResult verifyPortConflict(MemAccess &, MemAccess &);
+  LogicalResult verifyLoopCarriedHazard(MemAccess &, MemAccess &);
+  void registerFifoAccesses(Operation *);
+  LogicalResult verifyFifoAccesses(ArrayRef<Operation *>, StringRef kind);
+  LogicalResult verifyInFlightOps(ArrayRef<Operation *>, StringRef what,
+                                  StringRef kind);
+  bool isOrderedAfter(Time, Operation *);
 
 private:
   TimingInfo *timingInfo;
+  llvm::MapVector<Value, SmallVector<MemAccess>> mapMemrefToAccesses;
+  llvm::MapVector<Value, SmallVector<Operation *>> mapFifoToReceivers;
+  llvm::MapVector<Value, SmallVector<Operation *>> mapFifoToSenders;
+  llvm::MapVector<StringAttr, SmallVector<Operation *>>
+      mapInstanceToDynamicCalls;
 };
 
+/// If timeVar is the iteration time var of a loop, return the loop op.
+static Operation *getLoopOfIterTimeVar(Value timeVar) {
+  auto arg = timeVar.dyn_cast<BlockArgument>();
+  if (!arg)
+    return nullptr;
+  auto *parentOp = arg.getOwner()->getParentOp();
+  if (!isa_and_nonnull<hir::ForOp, hir::WhileOp>(parentOp))
+    return nullptr;
+  return parentOp;
+}
+
+/// Get the initiation interval of the loop. If the attribute is missing, the
+/// II is inferred from the hir.next_iter terminator.
+static Optional<int64_t> getLoopII(Operation *loopOp) {
+  if (auto forOp = dyn_cast<hir::ForOp>(loopOp))
+    if (auto ii = forOp.getInitiationInterval())
+      return ii;
+  auto iterTimeVar = dyn_cast<RegionOp>(loopOp).getRegionTimeVars()[0];
+  auto nextIterOp =
+      dyn_cast<hir::NextIterOp>(loopOp->getRegion(0).front().getTerminator());
+  if (!nextIterOp || nextIterOp.tstart() != iterTimeVar)
+    return llvm::None;
+  return nextIterOp.offset();
+}
+
+/// Two ops in different branches of the same hir.if never execute together.
+static bool areMutuallyExclusive(Operation *op1, Operation *op2) {
+  for (auto ifOp = op1->getParentOfType<hir::IfOp>(); ifOp;
+       ifOp = ifOp->getParentOfType<hir::IfOp>()) {
+    if (!ifOp->isProperAncestor(op2))
+      continue;
+    bool op1InIf = ifOp.if_region().isAncestor(op1->getParentRegion());
+    bool op2InIf = ifOp.if_region().isAncestor(op2->getParentRegion());
+    return op1InIf != op2InIf;
+  }
+  return false;
+}
+
+/// Returns false if the bank indices are constants that differ, i.e. the two
+/// accesses are guaranteed to go to different banks.
+static bool mayAccessSameBank(MemAccess &a, MemAccess &b) {
+  for (size_t i = 0; i < a.bankIndices.size(); i++) {
+    auto idxA = helper::getConstantIntValue(a.bankIndices[i]);
+    auto idxB = helper::getConstantIntValue(b.bankIndices[i]);
+    if (idxA && idxB && idxA.getValue() != idxB.getValue())
+      return false;
+  }
+  return true;
+}
+
+/// In a speculative hir.while, the loop condition is read from the exit flag
+/// before the exits of the in-flight iterations are known.
+static bool isSpeculativeBreak(Operation *operation) {
+  auto whileOp = dyn_cast<hir::WhileOp>(operation->getParentOp());
+  if (!whileOp || !whileOp->hasAttr("squash_offset"))
+    return false;
+  auto nextIterOp =
+      cast<hir::NextIterOp>(whileOp.body().front().getTerminator());
+  return nextIterOp.condition() &&
+         nextIterOp.condition().getDefiningOp() == operation;
+}
+
+/// The done time of a dynamic-latency call is its first !hir.time result.
+static Value getDynamicDoneTime(hir::CallOp op) {
+  for (auto result : op.getResults())
+    if (result.getType().isa<hir::TimeType>())
+      return result;
+  return Value();
+}
+
+/// The time at which a fifo handshake or a dynamic-latency call completes.
+static Value getDoneTime(Operation *operation) {
+  if (auto op = dyn_cast<hir::FifoRecvOp>(operation))
+    return op.t_done();
+  if (auto op = dyn_cast<hir::CallOp>(operation))
+    return getDynamicDoneTime(op);
+  return cast<hir::FifoSendOp>(operation).t_done();
+}
+
+static bool isDefinedOutside(Value v, Operation *loopOp) {
+  if (helper::getConstantIntValue(v))
+    return true;
+  return !loopOp->getRegion(0).isAncestor(v.getParentRegion());
+}
+
 void VerifySchedulePass::runOnOperation() {
   hir::FuncOp funcOp = getOperation();
-  auto schedInfo = TimingInfo(funcOp);
-  this->timingInfo = &schedInfo;
-  funcOp.walk([this](Operation *operation) {
+  this->timingInfo = &getAnalysis<TimingInfo>();
+  auto walkResult = funcOp.walk([this](Operation *operation) {
     if (failed(verifyOperation(operation)))
       return WalkResult::interrupt();
     return WalkResult::advance();
   });
+  if (walkResult.wasInterrupted()) {
+    mapMemrefToAccesses.clear();
+    mapFifoToReceivers.clear();
+    mapFifoToSenders.clear();
+    mapInstanceToDynamicCalls.clear();
+    return signalPassFailure();
+  }
+  bool hasError = failed(verifyMemAccesses());
+  for (auto &fifoAndOps : mapFifoToReceivers)
+    if (failed(verifyFifoAccesses(fifoAndOps.second, "receive")))
+      hasError = true;
+  for (auto &fifoAndOps : mapFifoToSenders)
+    if (failed(verifyFifoAccesses(fifoAndOps.second, "send")))
+      hasError = true;
+  for (auto &instanceAndCalls : mapInstanceToDynamicCalls)
+    if (failed(verifyInFlightOps(instanceAndCalls.second,
+                                 "Dynamic-latency call", "call")))
+      hasError = true;
+  mapFifoToReceivers.clear();
+  mapFifoToSenders.clear();
+  mapInstanceToDynamicCalls.clear();
+  if (hasError)
+    signalPassFailure();
+  // The verifier does not modify the IR, so the cached TimingInfo is still
+  // valid for the passes that follow.
+  markAllAnalysesPreserved();
 }
 
 LogicalResult VerifySchedulePass::verifyOperation(Operation *operation) {
   if (isa<comb::CombDialect>(operation->getDialect()))
     return verifyCombOp(operation);
+  if (auto op = dyn_cast<hir::WhileOp>(operation))
+    if (failed(verifySpeculation(op)))
+      return failure();
+  if (auto op = dyn_cast<hir::LoadOp>(operation))
+    registerMemAccess(operation, op.mem(), op.port(),
+                      op.filterIndices(BANK), op.filterIndices(ADDR),
+                      op.delay(), /*isWrite*/ false);
+  else if (auto op = dyn_cast<hir::StoreOp>(operation))
+    registerMemAccess(operation, op.mem(), op.port(),
+                      op.filterIndices(BANK), op.filterIndices(ADDR),
+                      op.delay(), /*isWrite*/ true);
+  registerFifoAccesses(operation);
   if (auto op = dyn_cast<hir::ScheduledOp>(operation))
     return verifyOp(operation);
+  if (auto op = dyn_cast<hir::ReturnOp>(operation))
+    return verifyOp(op);
   return success();
 }
 
@@ -63,11 +222,12 @@ LogicalResult VerifySchedulePass::verifyCombOp(Operation *operation) {
       continue;
     }
     auto time = timingInfo->getTime(nonConstantOperand);
-    if (!timingInfo->isValidAtTime(operand, time)) {
-      operation->emitError("Error in scheduling of operand.")
-              .attachNote(operand.getLoc())
-          << "Operand defined here.";
-    }
+    if (!time)
+      continue;
+    if (!timingInfo->isValidAtTime(operand, *time))
+      return operation->emitError("Error in scheduling of operand.")
+                 .attachNote(operand.getLoc())
+             << "Operand defined here.";
   }
   return success();
 }
@@ -84,6 +244,307 @@ LogicalResult VerifySchedulePass::verifyOp(ScheduledOp op) {
   return success();
 }
 
+/// Iterations of a speculative hir.while start before the earlier ones have
+/// resolved the loop condition. Their side effects must be squashed by a
+/// hir.if that is issued once the exits of all earlier iterations are known.
+LogicalResult VerifySchedulePass::verifySpeculation(hir::WhileOp op) {
+  auto squashOffset = op->getAttrOfType<IntegerAttr>("squash_offset");
+  if (!squashOffset)
+    return success();
+  auto walkResult = op.body().walk([&](Operation *operation) {
+    if (isa<hir::CallOp, hir::BusSendOp, hir::FifoSendOp>(operation)) {
+      operation->emitError(
+          "Side effects in a speculative loop can not be squashed.");
+      return WalkResult::interrupt();
+    }
+    auto storeOp = dyn_cast<hir::StoreOp>(operation);
+    if (!storeOp)
+      return WalkResult::advance();
+    Optional<int64_t> squashTime;
+    auto ifOp = storeOp->getParentOfType<hir::IfOp>();
+    if (ifOp && op->isProperAncestor(ifOp))
+      squashTime = helper::getTimeOffsetFrom(ifOp.tstart(), ifOp.offset(),
+                                             op.getIterTimeVar());
+    if (!squashTime || *squashTime < squashOffset.getInt()) {
+      storeOp.emitError("Store in a speculative loop must be inside a hir.if "
+                        "issued at or after cycle ")
+          << squashOffset.getInt() << " of the iteration.";
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  return failure(walkResult.wasInterrupted());
+}
+
+/// A dynamic-latency result must be valid 'delay' cycles after the returned
+/// done time it is counted from. hir.time ops define root time vars, so a done
+/// time defined by one is replaced by the time it is offset from.
+LogicalResult VerifySchedulePass::verifyOp(hir::ReturnOp op) {
+  auto funcTy = op->getParentOfType<hir::FuncOp>().getFuncType();
+  for (size_t i = 0; i < op.operands().size(); i++) {
+    auto resultAttr = funcTy.getResultAttrs()[i];
+    auto delayFrom = helper::getHIRDelayFromAttr(resultAttr);
+    if (!delayFrom)
+      continue;
+    auto operand = op.operands()[i];
+    Time validTime(op.operands()[delayFrom.getValue()],
+                   helper::getHIRDelayAttr(resultAttr).getValue());
+    while (auto timeOp = validTime.getTimeVar().getDefiningOp<hir::TimeOp>())
+      validTime = Time(timeOp.timevar(), timeOp.offset()).addOffset(
+          validTime.getOffset());
+    if (!timingInfo->isValidAtTime(operand, validTime))
+      return op.emitError("Error in scheduling of returned value.")
+                 .attachNote(operand.getLoc())
+             << "Operand defined here. ";
+  }
+  return success();
+}
+
+void VerifySchedulePass::registerMemAccess(Operation *operation, Value mem,
+                                           Optional<uint64_t> port,
+                                           SmallVector<Value> bankIndices,
+                                           SmallVector<Value> addrIndices,
+                                           int64_t delay, bool isWrite) {
+  auto startTime = dyn_cast<ScheduledOp>(operation).getStartTime();
+  mapMemrefToAccesses[mem].push_back(
+      {operation, port, bankIndices, addrIndices,
+       timingInfo->getUngatedRootTime(startTime), delay, isWrite});
+}
+
+/// Check every pair of accesses to the same memref. Accesses are comparable
+/// only if their start times are derived from the same root time var.
+LogicalResult VerifySchedulePass::verifyMemAccesses() {
+  bool hasHazard = false;
+  for (auto &memrefAndAccesses : mapMemrefToAccesses) {
+    auto &accesses = memrefAndAccesses.second;
+    for (size_t i = 0; i < accesses.size(); i++) {
+      for (size_t j = i + 1; j < accesses.size(); j++) {
+        auto &a = accesses[i];
+        auto &b = accesses[j];
+        if (a.rootTime.getTimeVar() != b.rootTime.getTimeVar())
+          continue;
+        if (!mayAccessSameBank(a, b))
+          continue;
+        if (areMutuallyExclusive(a.operation, b.operation))
+          continue;
+        if (failed(verifyPortConflict(a, b)))
+          hasHazard = true;
+        if (failed(verifyLoopCarriedHazard(a, b)))
+          hasHazard = true;
+      }
+    }
+  }
+  mapMemrefToAccesses.clear();
+  return failure(hasHazard);
+}
+
+/// A call that is passed a fifo is one more receiver (or sender) of it. Calls
+/// with a dynamic latency are also registered, by the instance they use.
+void VerifySchedulePass::registerFifoAccesses(Operation *operation) {
+  if (auto op = dyn_cast<hir::FifoRecvOp>(operation)) {
+    mapFifoToReceivers[op.fifo()].push_back(operation);
+    return;
+  }
+  if (auto op = dyn_cast<hir::FifoSendOp>(operation)) {
+    mapFifoToSenders[op.fifo()].push_back(operation);
+    return;
+  }
+  auto callOp = dyn_cast<hir::CallOp>(operation);
+  if (!callOp)
+    return;
+  if (getDynamicDoneTime(callOp))
+    mapInstanceToDynamicCalls[callOp.instance_nameAttr()].push_back(operation);
+  auto funcTy = callOp.getFuncType();
+  for (size_t i = 0; i < callOp.operands().size(); i++) {
+    if (!funcTy.getInputTypes()[i].isa<hir::FifoType>())
+      continue;
+    auto fifo = callOp.operands()[i];
+    if (helper::extractBusPortFromDict(funcTy.getInputAttrs()[i]) == "send")
+      mapFifoToSenders[fifo].push_back(operation);
+    else
+      mapFifoToReceivers[fifo].push_back(operation);
+  }
+}
+
+/// The time starts at or after the fifo op or call completes, or after a loop
+/// that contains it ends. hir.time ops define root time vars,
+/// so they are followed back to the time they are offset from.
+bool VerifySchedulePass::isOrderedAfter(Time time, Operation *operation) {
+  time = timingInfo->getUngatedRootTime(time);
+  while (auto timeOp = time.getTimeVar().getDefiningOp<hir::TimeOp>())
+    time = timingInfo->getUngatedRootTime(
+        Time(timeOp.timevar(), timeOp.offset()).addOffset(time.getOffset()));
+  Value const root = time.getTimeVar();
+  if (root == getDoneTime(operation))
+    return true;
+  auto *loopOp = root.getDefiningOp();
+  return isa_and_nonnull<hir::ForOp, hir::WhileOp>(loopOp) &&
+         loopOp->isProperAncestor(operation);
+}
+
+/// All the receivers of a fifo share its read port, so a second receive that
+/// is in flight at the same time would complete on the same pop (and likewise
+/// for sends). A call may use the fifo at any time, so it must be the only
+/// receiver.
+LogicalResult
+VerifySchedulePass::verifyFifoAccesses(ArrayRef<Operation *> operations,
+                                       StringRef kind) {
+  for (size_t i = 1; i < operations.size(); i++) {
+    auto *prev = operations[i - 1];
+    auto *operation = operations[i];
+    if (isa<hir::CallOp>(prev) || isa<hir::CallOp>(operation)) {
+      auto diag = operation->emitError("Fifo is passed to a call and has ")
+                  << "more than one " << kind << ".";
+      diag.attachNote(prev->getLoc()) << "Other " << kind << " here.";
+      return failure();
+    }
+  }
+  if (operations.size() == 1 && isa<hir::CallOp>(operations.front()))
+    return success();
+  return verifyInFlightOps(operations, ("Fifo " + kind).str(), kind);
+}
+
+/// The ops have no handshake to stall an op that is issued while another one
+/// is in flight. Each op must start once the previous one is done, and a loop
+/// may only start its next iteration once the last op in the body is done.
+LogicalResult
+VerifySchedulePass::verifyInFlightOps(ArrayRef<Operation *> operations,
+                                      StringRef what, StringRef kind) {
+  bool hasError = false;
+  for (size_t i = 1; i < operations.size(); i++) {
+    auto *prev = operations[i - 1];
+    auto *operation = operations[i];
+    if (areMutuallyExclusive(prev, operation))
+      continue;
+    if (!isOrderedAfter(cast<ScheduledOp>(operation).getStartTime(), prev)) {
+      auto diag = operation->emitError(what)
+                  << " may overlap with an earlier " << kind << ".";
+      diag.attachNote(prev->getLoc())
+          << "Earlier " << kind << " here. The next " << kind
+          << " must start at or after its done time.";
+      hasError = true;
+    }
+  }
+
+  llvm::SmallPtrSet<Operation *, 4> checkedLoops;
+  for (auto *operation : operations) {
+    for (auto *loopOp = operation->getParentOp(); !isa<hir::FuncOp>(loopOp);
+         loopOp = loopOp->getParentOp()) {
+      if (!isa<hir::ForOp, hir::WhileOp>(loopOp) ||
+          !checkedLoops.insert(loopOp).second)
+        continue;
+      auto nextIterOp = dyn_cast<hir::NextIterOp>(
+          loopOp->getRegion(0).front().getTerminator());
+      if (!nextIterOp)
+        continue;
+      Operation *last = operation;
+      for (auto *op : operations)
+        if (loopOp->isProperAncestor(op))
+          last = op;
+      if (isOrderedAfter(Time(nextIterOp.tstart(), nextIterOp.offset()), last))
+        continue;
+      auto diag = last->emitError(what) << " may overlap with the " << kind
+                                        << " of the next loop iteration.";
+      diag.attachNote(nextIterOp.getLoc())
+          << "The next iteration starts here, before the " << kind
+          << " is done.";
+      hasError = true;
+    }
+  }
+  return failure(hasError);
+}
+
+/// A memory port can serve one access per cycle. In a pipelined loop, accesses
+/// whose start times are equal modulo II use the port in the same cycle.
+LogicalResult VerifySchedulePass::verifyPortConflict(MemAccess &a,
+                                                     MemAccess &b) {
+  if (a.port != b.port)
+    return success();
+
+  // The read port of a 'reg' is a wire, so it serves any number of loads.
+  if (!a.isWrite && !b.isWrite) {
+    auto allocaOp = cast<hir::LoadOp>(a.operation)
+                        .mem()
+                        .getDefiningOp<hir::AllocaOp>();
+    if (allocaOp && allocaOp.mem_kind() == MemKindEnum::reg)
+      return success();
+  }
+
+  int64_t cycleA = a.rootTime.getOffset();
+  int64_t cycleB = b.rootTime.getOffset();
+  Optional<int64_t> ii;
+  if (auto *loopOp = getLoopOfIterTimeVar(a.rootTime.getTimeVar()))
+    ii = getLoopII(loopOp);
+
+  bool conflict = ii && ii.getValue() > 0
+                      ? (cycleA - cycleB) % ii.getValue() == 0
+                      : cycleA == cycleB;
+  if (!conflict)
+    return success();
+
+  auto diag = b.operation->emitError("Memory port conflict. Port ")
+              << (b.port ? b.port.getValue() : 0) << " is used at cycle "
+              << cycleB;
+  if (ii)
+    diag << " (II = " << ii.getValue() << ")";
+  diag.attachNote(a.operation->getLoc())
+      << "Conflicting access at cycle " << cycleA << ".";
+  return failure();
+}
+
+/// If a load and a store in a pipelined loop use the same loop-invariant
+/// address then the store of one iteration must not overtake (or lag behind)
+/// the load of the neighbouring iteration.
+LogicalResult VerifySchedulePass::verifyLoopCarriedHazard(MemAccess &a,
+                                                          MemAccess &b) {
+  if (a.isWrite == b.isWrite)
+    return success();
+  auto *loopOp = getLoopOfIterTimeVar(a.rootTime.getTimeVar());
+  if (!loopOp)
+    return success();
+  auto ii = getLoopII(loopOp);
+  if (!ii)
+    return success();
+
+  auto &load = a.isWrite ? b : a;
+  auto &store = a.isWrite ? a : b;
+  if (isSpeculativeBreak(load.operation))
+    return success();
+  if (load.addrIndices != store.addrIndices ||
+      load.bankIndices != store.bankIndices)
+    return success();
+  for (auto idx : load.addrIndices)
+    if (!isDefinedOutside(idx, loopOp))
+      return success();
+  for (auto idx : load.bankIndices)
+    if (!isDefinedOutside(idx, loopOp))
+      return success();
+
+  int64_t rdCycle = load.rootTime.getOffset();
+  int64_t wrCycle = store.rootTime.getOffset();
+  int64_t wrDoneCycle = wrCycle + store.delay;
+  if (rdCycle < wrCycle && ii.getValue() + rdCycle < wrDoneCycle) {
+    auto diag = load.operation->emitError(
+                    "Read-after-write hazard across loop iterations. The "
+                    "next iteration reads at cycle ")
+                << ii.getValue() + rdCycle;
+    diag.attachNote(store.operation->getLoc())
+        << "Store at cycle " << wrCycle << " completes at cycle "
+        << wrDoneCycle << " (II = " << ii.getValue() << ").";
+    return failure();
+  }
+  if (rdCycle >= wrCycle && ii.getValue() + wrDoneCycle <= rdCycle) {
+    auto diag = store.operation->emitError(
+                    "Write-after-read hazard across loop iterations. The "
+                    "next iteration writes at cycle ")
+                << ii.getValue() + wrCycle;
+    diag.attachNote(load.operation->getLoc())
+        << "Load at cycle " << rdCycle << " (II = " << ii.getValue() << ").";
+    return failure();
+  }
+  return success();
+}
+
 namespace circt {
 namespace hir {
 std::unique_ptr<OperationPass<hir::FuncOp>> createVerifySchedulePass() {
@@ -0,0 +1,310 @@
+//=========- WidenMemrefPass.cpp - Pack adjacent memref elements---===//
+//
+// This file implements memref widening. If every access to a local memref is
+// part of a group of k accesses issued in the same cycle, through different
+// ports or to different banks, that read or write k neighbouring elements,
+// the k elements are packed into one wide word. Each group then becomes a
+// single wide access, and loads are followed by comb.extract to slice it.
+// Neighbouring elements are either k contiguous, aligned addresses of the
+// innermost address dimension, or the same address in all k banks of a bank
+// dimension.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "llvm/ADT/SmallBitVector.h"
+
+using namespace circt;
+
+/// Widest packing that is tried, in elements per word.
+static const int64_t kMaxWidenFactor = 8;
+
+namespace {
+
+class WidenMemrefPass : public hir::WidenMemrefBase<WidenMemrefPass> {
+public:
+  void runOnOperation() override;
+
+private:
+  LogicalResult widenMemref(hir::AllocaOp allocaOp);
+};
+
+/// A load or store, with the index of the widened dimension split into a loop
+/// induction var (or none, if the index is constant) and a constant offset.
+struct MemAccess {
+  Operation *operation;
+  SmallVector<Value> indices;
+  Value iv;
+  int64_t offset;
+};
+} // end anonymous namespace
+
+static int64_t floorDiv(int64_t a, int64_t b) {
+  return (a >= 0 ? a : a - b + 1) / b;
+}
+
+static SmallVector<Value> getIndices(Operation *operation) {
+  if (auto loadOp = dyn_cast<hir::LoadOp>(operation))
+    return SmallVector<Value>(loadOp.indices().begin(), loadOp.indices().end());
+  auto storeOp = cast<hir::StoreOp>(operation);
+  return SmallVector<Value>(storeOp.indices().begin(), storeOp.indices().end());
+}
+
+/// Returns the induction var of the hir.for that v is, or is a zero-based
+/// slice of.
+static Optional<std::pair<Value, hir::ForOp>> getInductionVar(Value v) {
+  if (auto extractOp = dyn_cast_or_null<comb::ExtractOp>(v.getDefiningOp()))
+    if (extractOp.lowBit() == 0)
+      v = extractOp.input();
+  auto arg = v.dyn_cast<BlockArgument>();
+  if (!arg)
+    return llvm::None;
+  auto forOp = dyn_cast<hir::ForOp>(arg.getOwner()->getParentOp());
+  if (!forOp || forOp.getInductionVar() != arg)
+    return llvm::None;
+  return std::make_pair(v, forOp);
+}
+
+static Optional<MemAccess> getMemAccess(Operation *operation, unsigned dim,
+                                        int64_t factor, bool isBankDim) {
+  MemAccess access{operation, getIndices(operation), Value(), 0};
+  Value const idx = access.indices[dim];
+  if (auto c = helper::getConstantIntValue(idx)) {
+    access.offset = *c;
+    return access;
+  }
+  if (isBankDim)
+    return llvm::None;
+
+  // The base of the index must be a multiple of the packing factor in every
+  // iteration.
+  auto baseAndOffset = helper::splitConstantOffset(idx);
+  auto ivAndLoop = getInductionVar(baseAndOffset.first);
+  if (!ivAndLoop)
+    return llvm::None;
+  auto lb = helper::getConstantIntValue(ivAndLoop->second.lb());
+  auto step = helper::getConstantIntValue(ivAndLoop->second.step());
+  if (!lb || !step || *lb % factor != 0 || *step % factor != 0)
+    return llvm::None;
+  access.iv = ivAndLoop->first;
+  access.offset = baseAndOffset.second;
+  return access;
+}
+
+/// Two accesses can share a word if they are of the same kind, issued at the
+/// same time with the same latency and fall in the same aligned word. They
+/// may use different ports, since the word is accessed through one of them.
+static bool isSameWord(MemAccess &a, MemAccess &b, unsigned dim,
+                       int64_t factor) {
+  Operation *opA = a.operation;
+  Operation *opB = b.operation;
+  if (opA->getName() != opB->getName() || opA->getBlock() != opB->getBlock())
+    return false;
+  if (opA->getOperand(opA->getNumOperands() - 1) !=
+          opB->getOperand(opB->getNumOperands() - 1) ||
+      opA->getAttr("offset") != opB->getAttr("offset") ||
+      opA->getAttr("delay") != opB->getAttr("delay"))
+    return false;
+  for (size_t i = 0; i < a.indices.size(); i++)
+    if (i != dim && a.indices[i] != b.indices[i])
+      return false;
+  return a.iv == b.iv &&
+         floorDiv(a.offset, factor) == floorDiv(b.offset, factor);
+}
+
+/// Partitions the accesses into complete words of `factor` elements.
+static Optional<SmallVector<SmallVector<MemAccess>>>
+groupAccesses(ArrayRef<Operation *> operations, unsigned dim, int64_t factor,
+              bool isBankDim) {
+  SmallVector<SmallVector<MemAccess>> groups;
+  for (auto *operation : operations) {
+    auto access = getMemAccess(operation, dim, factor, isBankDim);
+    if (!access)
+      return llvm::None;
+    auto *group = llvm::find_if(groups, [&](SmallVector<MemAccess> &g) {
+      return isSameWord(g.front(), *access, dim, factor);
+    });
+    if (group == groups.end()) {
+      groups.push_back({});
+      group = &groups.back();
+    }
+    group->push_back(*access);
+  }
+
+  for (auto &group : groups) {
+    if ((int64_t)group.size() != factor)
+      return llvm::None;
+    llvm::SmallBitVector lanes(factor);
+    for (auto &access : group) {
+      auto lane = access.offset - floorDiv(access.offset, factor) * factor;
+      if (lanes.test(lane))
+        return llvm::None;
+      lanes.set(lane);
+    }
+    llvm::sort(group, [](const MemAccess &a, const MemAccess &b) {
+      return a.offset < b.offset;
+    });
+  }
+  return groups;
+}
+
+/// Index of the wide word that holds the first element of the group.
+static Value emitWordIndex(OpBuilder &builder, MemAccess &first,
+                           int64_t factor, Type wordIdxTy) {
+  auto uLoc = builder.getUnknownLoc();
+  if (!first.iv)
+    return builder.create<hw::ConstantOp>(
+        uLoc, IntegerAttr::get(wordIdxTy, first.offset / factor));
+  Value addr = first.iv;
+  if (first.offset != 0)
+    addr = builder.create<comb::AddOp>(
+        uLoc, addr,
+        builder.create<hw::ConstantOp>(
+            uLoc, IntegerAttr::get(addr.getType(), first.offset)));
+  return builder.create<comb::ExtractOp>(
+      uLoc, wordIdxTy, addr, builder.getI32IntegerAttr(llvm::Log2_64(factor)));
+}
+
+LogicalResult WidenMemrefPass::widenMemref(hir::AllocaOp allocaOp) {
+  auto memTy = allocaOp.getType().cast<hir::MemrefType>();
+  auto elementTy = memTy.getElementType().dyn_cast<IntegerType>();
+  if (!elementTy)
+    return failure();
+
+  // Pack all the banks of a bank dimension, or else 8, 4 or 2 elements of the
+  // innermost address dimension.
+  auto shape = memTy.getShape();
+  auto dimKinds = memTy.getDimKinds();
+  SmallVector<std::pair<unsigned, int64_t>> candidates;
+  for (size_t i = 0; i < shape.size(); i++)
+    if (dimKinds[i] == hir::DimKind::BANK && shape.size() > 1 &&
+        shape[i] > 1 && shape[i] <= kMaxWidenFactor)
+      candidates.push_back(std::make_pair(i, shape[i]));
+  for (size_t i = shape.size(); i-- > 0;) {
+    if (dimKinds[i] != hir::DimKind::ADDR)
+      continue;
+    for (int64_t factor = kMaxWidenFactor; factor > 1; factor /= 2)
+      if (shape[i] % factor == 0 && shape[i] / factor >= 2)
+        candidates.push_back(std::make_pair(i, factor));
+    break;
+  }
+
+  SmallVector<Operation *> accesses;
+  for (auto &use : allocaOp.getResult().getUses()) {
+    auto *user = use.getOwner();
+    if (isa<hir::LoadOp>(user) && use.getOperandNumber() == 0)
+      accesses.push_back(user);
+    else if (isa<hir::StoreOp>(user) && use.getOperandNumber() == 1)
+      accesses.push_back(user);
+    else
+      return failure();
+  }
+  if (accesses.empty())
+    return failure();
+
+  for (auto dimAndFactor : candidates) {
+    unsigned const dim = dimAndFactor.first;
+    int64_t const factor = dimAndFactor.second;
+    bool const isBankDim = dimKinds[dim] == hir::DimKind::BANK;
+    auto groups = groupAccesses(accesses, dim, factor, isBankDim);
+    if (!groups)
+      continue;
+
+    // A bank dimension is removed, an address dimension is divided by the
+    // factor.
+    OpBuilder builder(allocaOp);
+    auto uLoc = builder.getUnknownLoc();
+    SmallVector<int64_t> wideShape(shape.begin(), shape.end());
+    SmallVector<hir::DimKind> wideDimKinds(dimKinds.begin(), dimKinds.end());
+    Type wordIdxTy;
+    if (isBankDim) {
+      wideShape.erase(wideShape.begin() + dim);
+      wideDimKinds.erase(wideDimKinds.begin() + dim);
+    } else {
+      wideShape[dim] /= factor;
+      wordIdxTy = builder.getIntegerType(helper::clog2(wideShape[dim]));
+    }
+    auto wordTy = builder.getIntegerType(elementTy.getWidth() * factor);
+    auto wideMemTy = hir::MemrefType::get(builder.getContext(), wideShape,
+                                          wordTy, wideDimKinds);
+    auto wideAllocaOp = builder.create<hir::AllocaOp>(
+        allocaOp.getLoc(), wideMemTy, allocaOp.mem_kindAttr(),
+        allocaOp.ports());
+    wideAllocaOp->setAttrs(allocaOp->getAttrs());
+
+    // The word is accessed through the port of the access to its first
+    // element. Every group holds its own lane-0 access, and lane-0 accesses of
+    // one cycle already use distinct ports of the same bank, so the wide
+    // accesses stay conflict-free.
+    for (auto &group : *groups) {
+      auto &first = group.front();
+      SmallVector<Value> indices = first.indices;
+      auto setWordIndex = [&] {
+        if (isBankDim)
+          indices.erase(indices.begin() + dim);
+        else
+          indices[dim] = emitWordIndex(builder, first, factor, wordIdxTy);
+      };
+      if (auto loadOp = dyn_cast<hir::LoadOp>(first.operation)) {
+        // The word is read where the first of the loads was.
+        Operation *insertionPoint = first.operation;
+        for (auto &access : group)
+          if (access.operation->isBeforeInBlock(insertionPoint))
+            insertionPoint = access.operation;
+        builder.setInsertionPoint(insertionPoint);
+        setWordIndex();
+        Value const word = builder.create<hir::LoadOp>(
+            uLoc, wordTy, wideAllocaOp, indices, loadOp.portAttr(),
+            loadOp.delayAttr(), loadOp.tstart(), loadOp.offsetAttr());
+        for (auto &access : group) {
+          auto lowBit = (access.offset - first.offset) * elementTy.getWidth();
+          Value const slice = builder.create<comb::ExtractOp>(
+              uLoc, elementTy, word, builder.getI32IntegerAttr(lowBit));
+          access.operation->getResult(0).replaceAllUsesWith(slice);
+        }
+      } else {
+        // The word is written where the last of the stores was, so that all
+        // the values are available.
+        auto storeOp = cast<hir::StoreOp>(first.operation);
+        Operation *insertionPoint = first.operation;
+        for (auto &access : group)
+          if (insertionPoint->isBeforeInBlock(access.operation))
+            insertionPoint = access.operation;
+        builder.setInsertionPoint(insertionPoint);
+        setWordIndex();
+        SmallVector<Value> values;
+        for (auto &access : llvm::reverse(group))
+          values.push_back(cast<hir::StoreOp>(access.operation).value());
+        Value const word = builder.create<comb::ConcatOp>(uLoc, wordTy, values);
+        builder.create<hir::StoreOp>(uLoc, word, wideAllocaOp, indices,
+                                     storeOp.portAttr(), storeOp.delayAttr(),
+                                     storeOp.tstart(), storeOp.offsetAttr());
+      }
+      for (auto &access : group)
+        access.operation->erase();
+    }
+    allocaOp.erase();
+    return success();
+  }
+  return failure();
+}
+
+void WidenMemrefPass::runOnOperation() {
+  hir::FuncOp funcOp = getOperation();
+  SmallVector<hir::AllocaOp> allocaOps;
+  funcOp.walk([&allocaOps](hir::AllocaOp op) { allocaOps.push_back(op); });
+  for (auto allocaOp : allocaOps)
+    (void)widenMemref(allocaOp);
+}
+
+namespace circt {
+namespace hir {
+std::unique_ptr<OperationPass<hir::FuncOp>> createWidenMemrefPass() {
+  return std::make_unique<WidenMemrefPass>();
+}
+} // namespace hir
+} // namespace circt
@@ -0,0 +1,168 @@
+//===- HWDedup.cpp - HW module deduping -------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements deduplication of structurally identical hw.modules.
+// Modules are hashed bottom-up, so that parents of deduplicated modules can be
+// deduplicated in turn.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/HW/HWInstanceGraph.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/HW/HWPasses.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Support/SHA256.h"
+#include <map>
+
+using namespace circt;
+using namespace hw;
+
+namespace {
+/// Hashes the body and the interface of a module. The module name is not
+/// part of the hash, except for extern modules. Values are hashed by their
+/// order of appearance.
+/// hw.module bodies are graph regions where an operand may be defined after
+/// its user, so all values are numbered before any op is hashed.
+struct StructuralHasher {
+  explicit StructuralHasher(MLIRContext *context) {
+    nonessentialAttributes.insert(StringAttr::get(context, "sym_name"));
+    nonessentialAttributes.insert(StringAttr::get(context, "comment"));
+  }
+
+  std::array<uint8_t, 32> hash(Operation *module) {
+    numberValues(module);
+    // An extern module has no body, so the verilog module it names, which is
+    // its symbol unless verilogName is set, is what identifies it.
+    if (isa<HWModuleExternOp>(module))
+      update(getVerilogModuleNameAttr(module).getAsOpaquePointer());
+    update(module);
+    auto hash = sha.final();
+    currentIndex = 0;
+    indexes.clear();
+    sha.init();
+    return hash;
+  }
+
+private:
+  void update(const void *pointer) {
+    auto *addr = reinterpret_cast<const uint8_t *>(&pointer);
+    sha.update(llvm::makeArrayRef(addr, sizeof pointer));
+  }
+
+  void update(size_t value) {
+    auto *addr = reinterpret_cast<const uint8_t *>(&value);
+    sha.update(llvm::makeArrayRef(addr, sizeof value));
+  }
+
+  // NOLINTNEXTLINE(misc-no-recursion)
+  void numberValues(Operation *op) {
+    for (auto &region : op->getRegions())
+      for (auto &block : region) {
+        for (auto arg : block.getArguments())
+          indexes[arg] = currentIndex++;
+        for (auto &nested : block)
+          numberValues(&nested);
+      }
+    for (auto result : op->getResults())
+      indexes[result] = currentIndex++;
+  }
+
+  void update(Value value) { update(value.getType().getAsOpaquePointer()); }
+
+  void update(DictionaryAttr dict) {
+    for (auto namedAttr : dict) {
+      if (nonessentialAttributes.contains(namedAttr.getName()))
+        continue;
+      // Attributes are interned, so the pointer identifies the value.
+      update(namedAttr.getName().getAsOpaquePointer());
+      update(namedAttr.getValue().getAsOpaquePointer());
+    }
+  }
+
+  // NOLINTNEXTLINE(misc-no-recursion)
+  void update(Operation *op) {
+    update(op->getName().getAsOpaquePointer());
+    update(op->getAttrDictionary());
+    for (auto operand : op->getOperands()) {
+      auto it = indexes.find(operand);
+      assert(it != indexes.end() && "operand should have been numbered");
+      update((size_t)it->second);
+    }
+    // An empty region must not hash the same as no region.
+    update((size_t)op->getNumRegions());
+    for (auto &region : op->getRegions())
+      for (auto &block : region) {
+        for (auto arg : block.getArguments())
+          update(arg);
+        for (auto &nested : block)
+          update(&nested);
+      }
+    for (auto result : op->getResults())
+      update(result);
+  }
+
+  unsigned currentIndex = 0;
+  DenseMap<Value, unsigned> indexes;
+  DenseSet<Attribute> nonessentialAttributes;
+  llvm::SHA256 sha;
+};
+
+struct HWDedupPass : public HWDedupBase<HWDedupPass> {
+  void runOnOperation() override;
+};
+} // end anonymous namespace
+
+void HWDedupPass::runOnOperation() {
+  auto &instanceGraph = getAnalysis<InstanceGraph>();
+  StructuralHasher hasher(&getContext());
+
+  // Children come before their parents, so that the instances in a parent
+  // already point to the deduplicated modules when it is hashed. The list is
+  // copied first since modules are erased on the way.
+  SmallVector<InstanceGraphNode *> nodes;
+  for (auto *node : llvm::post_order(&instanceGraph))
+    if (node->getModule())
+      nodes.push_back(node);
+
+  // Extern modules that name the same verilog module with the same ports, such
+  // as the decls hir-to-hw emits for each hir.func.extern, hash the same.
+  std::map<std::array<uint8_t, 32>, Operation *> modulesByHash;
+  bool changed = false;
+  for (auto *node : nodes) {
+    Operation *module = node->getModule().getOperation();
+    auto hwModule = dyn_cast<HWModuleOp>(module);
+    if (hwModule ? !hwModule.parameters().empty()
+                 : !isa<HWModuleExternOp>(module))
+      continue;
+
+    auto it = modulesByHash.insert({hasher.hash(module), module});
+    if (it.second)
+      continue;
+
+    // A public module that is not instantiated is a top level module and
+    // keeps its name.
+    if (hwModule && !hwModule.isPrivate() && node->noUses())
+      continue;
+
+    auto moduleNameAttr = FlatSymbolRefAttr::get(
+        SymbolTable::getSymbolName(it.first->second));
+    for (auto *record : node->uses())
+      record->getInstance()->setAttr("moduleName", moduleNameAttr);
+    module->erase();
+    changed = true;
+  }
+
+  if (!changed)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<mlir::Pass> circt::hw::createHWDedupPass() {
+  return std::make_unique<HWDedupPass>();
+}
@@ -0,0 +1,442 @@
+//===- HWRegisterFanout.cpp - Register duplication and retiming -*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass works on registers of the form emitted by the HIR to HW lowering:
+// an sv.reg that is assigned once in an sv.alwaysff, optionally under an sv.if
+// enable such as the loop counters of SimplifyCtrl. Registers whose output
+// has more than `max-fanout` uses are duplicated and the uses are split between
+// the copies. All copies are driven by the same input, so when that input is
+// itself a register it may go over the limit and get duplicated in turn, which
+// builds a tree of registers without adding latency.
+//
+// Before that, registers can be retimed across a single comb op when this
+// lowers the comb depth of the deeper of the two stages around the register.
+// Both transformations keep the number of registers on every path, so the
+// latencies fixed by the HIR schedule are preserved.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/SV/SVOps.h"
+#include "circt/Dialect/SV/SVPasses.h"
+#include "mlir/IR/Builders.h"
+#include "llvm/ADT/DenseMap.h"
+
+using namespace circt;
+using namespace sv;
+
+//===----------------------------------------------------------------------===//
+// Helper utilities
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// An sv.reg of integer type that is assigned exactly once in the body of an
+/// sv.alwaysff, and at most once in the reset block of the same alwaysff. The
+/// assignment in the body may be guarded by an sv.if without an else, whose
+/// condition is the enable of the register.
+struct SimpleReg {
+  RegOp reg;
+  AlwaysFFOp alwaysFF;
+  PAssignOp assign;
+  PAssignOp resetAssign;
+  Value enable;
+  SmallVector<ReadInOutOp> reads;
+
+  Value getInput() { return assign.getSrc(); }
+
+  /// True if the register is reset to zero, false if it is not reset at all.
+  /// Returns None for any other reset value.
+  Optional<bool> isResetToZero() {
+    if (!resetAssign)
+      return false;
+    auto constOp = resetAssign.getSrc().getDefiningOp<hw::ConstantOp>();
+    if (!constOp || !constOp.getValue().isZero())
+      return llvm::None;
+    return true;
+  }
+
+  size_t getFanout() {
+    size_t fanout = 0;
+    for (auto read : reads)
+      fanout += std::distance(read->use_begin(), read->use_end());
+    return fanout;
+  }
+
+  /// Erases the register along with its assignments. The reads must not have
+  /// any uses left.
+  void erase() {
+    for (auto read : reads)
+      read.erase();
+    auto *assignBlock = assign->getBlock();
+    assign.erase();
+    if (enable && assignBlock->empty())
+      assignBlock->getParentOp()->erase();
+    if (resetAssign)
+      resetAssign.erase();
+    reg.erase();
+    if (alwaysFF.getBodyBlock()->empty() &&
+        (alwaysFF.getResetBlk().empty() || alwaysFF.getResetBlock()->empty()))
+      alwaysFF.erase();
+  }
+};
+} // end anonymous namespace
+
+static Optional<SimpleReg> matchSimpleReg(RegOp reg) {
+  if (reg.getInnerSymAttr() || !reg.getElementType().isa<IntegerType>())
+    return llvm::None;
+
+  SimpleReg simpleReg;
+  simpleReg.reg = reg;
+  for (auto *user : reg->getUsers()) {
+    if (auto read = dyn_cast<ReadInOutOp>(user)) {
+      simpleReg.reads.push_back(read);
+      continue;
+    }
+    auto assign = dyn_cast<PAssignOp>(user);
+    if (!assign || assign.getDest() != reg.getResult())
+      return llvm::None;
+    // An enable guards the assignment directly in the body of the alwaysff.
+    Operation *parentOp = assign->getParentOp();
+    auto ifOp = dyn_cast<IfOp>(parentOp);
+    if (ifOp) {
+      if (ifOp.hasElse())
+        return llvm::None;
+      parentOp = ifOp->getParentOp();
+    }
+    auto alwaysFF = dyn_cast_or_null<AlwaysFFOp>(parentOp);
+    if (!alwaysFF || (simpleReg.alwaysFF && simpleReg.alwaysFF != alwaysFF))
+      return llvm::None;
+    simpleReg.alwaysFF = alwaysFF;
+    Block *block = ifOp ? ifOp->getBlock() : assign->getBlock();
+    if (block == alwaysFF.getBodyBlock()) {
+      if (simpleReg.assign)
+        return llvm::None;
+      simpleReg.assign = assign;
+      if (ifOp)
+        simpleReg.enable = ifOp.getCond();
+    } else if (!ifOp && !alwaysFF.getResetBlk().empty() &&
+               block == alwaysFF.getResetBlock()) {
+      if (simpleReg.resetAssign)
+        return llvm::None;
+      simpleReg.resetAssign = assign;
+    } else {
+      return llvm::None;
+    }
+  }
+  if (!simpleReg.assign)
+    return llvm::None;
+
+  // Copies of the register live in alwaysff blocks of their own, so they can
+  // not use values defined in this one.
+  auto isDefinedInside = [&simpleReg](Value v) {
+    return simpleReg.alwaysFF->isAncestor(v.getParentBlock()->getParentOp());
+  };
+  if (isDefinedInside(simpleReg.assign.getSrc()) ||
+      (simpleReg.enable && isDefinedInside(simpleReg.enable)) ||
+      (simpleReg.resetAssign &&
+       isDefinedInside(simpleReg.resetAssign.getSrc())))
+    return llvm::None;
+  return simpleReg;
+}
+
+/// Creates a register with the clock, reset and enable of `proto`, in an
+/// alwaysff of its own, and returns its output. `resetValue` is ignored if
+/// `proto` is not reset.
+static Value createRegLike(OpBuilder &builder, SimpleReg &proto, Value input,
+                           Value resetValue, StringAttr name) {
+  auto loc = proto.reg.getLoc();
+  auto reg = builder.create<RegOp>(loc, input.getType(), name);
+  auto read = builder.create<ReadInOutOp>(loc, reg);
+  auto alwaysFF = proto.alwaysFF;
+  auto enable = proto.enable;
+  auto bodyCtor = [&builder, &reg, &input, &enable, loc] {
+    if (!enable) {
+      builder.create<PAssignOp>(loc, reg.getResult(), input);
+      return;
+    }
+    builder.create<IfOp>(loc, enable, [&builder, &reg, &input, loc] {
+      builder.create<PAssignOp>(loc, reg.getResult(), input);
+    });
+  };
+  if (proto.resetAssign) {
+    builder.create<AlwaysFFOp>(
+        loc, alwaysFF.getClockEdge(), alwaysFF.getClock(),
+        alwaysFF.getResetStyle(), alwaysFF.getResetEdge().getValue(),
+        alwaysFF.getReset(), bodyCtor, [&builder, &reg, &resetValue, loc] {
+          builder.create<PAssignOp>(loc, reg.getResult(), resetValue);
+        });
+  } else {
+    builder.create<AlwaysFFOp>(loc, alwaysFF.getClockEdge(),
+                               alwaysFF.getClock(), bodyCtor);
+  }
+  return read;
+}
+
+/// Two registers can be merged into one if they use the same clock, reset and
+/// enable.
+static bool haveSameClockAndReset(SimpleReg &a, SimpleReg &b) {
+  return a.enable == b.enable &&
+         a.alwaysFF.getClock() == b.alwaysFF.getClock() &&
+         a.alwaysFF.getClockEdge() == b.alwaysFF.getClockEdge() &&
+         a.alwaysFF.getReset() == b.alwaysFF.getReset() &&
+         a.alwaysFF.getResetEdge() == b.alwaysFF.getResetEdge() &&
+         a.alwaysFF.getResetStyle() == b.alwaysFF.getResetStyle() &&
+         a.isResetToZero() == b.isResetToZero();
+}
+
+/// Comb ops that a register can be moved across. If the registers are reset
+/// to zero, the op must also map all-zero inputs to zero.
+static bool isRetimable(Operation *op, bool resetToZero) {
+  if (!op || op->getNumResults() != 1 ||
+      !isa<comb::CombDialect>(op->getDialect()) ||
+      !isa<hw::HWModuleOp>(op->getParentOp()) ||
+      !op->getResult(0).getType().isa<IntegerType>())
+    return false;
+  if (!resetToZero)
+    return true;
+  return isa<comb::AndOp, comb::OrOp, comb::XorOp, comb::AddOp, comb::SubOp,
+             comb::MulOp, comb::ShlOp, comb::ShrUOp, comb::ConcatOp,
+             comb::ExtractOp, comb::MuxOp>(op);
+}
+
+static Value getZero(OpBuilder &builder, Location loc, Type type) {
+  return builder.create<hw::ConstantOp>(loc, IntegerAttr::get(type, 0));
+}
+
+namespace {
+/// Longest chain of comb ops into and out of each value, up to the nearest
+/// register, port or instance.
+class CombDepth {
+public:
+  unsigned getArrival(Value v) {
+    auto it = arrival.find(v);
+    if (it != arrival.end())
+      return it->second;
+    arrival[v] = 0;
+    unsigned depth = 0;
+    auto *op = v.getDefiningOp();
+    if (op && isa<comb::CombDialect>(op->getDialect()))
+      for (auto operand : op->getOperands())
+        depth = std::max(depth, getArrival(operand) + 1);
+    return arrival[v] = depth;
+  }
+
+  unsigned getDeparture(Value v) {
+    auto it = departure.find(v);
+    if (it != departure.end())
+      return it->second;
+    departure[v] = 0;
+    unsigned depth = 0;
+    for (auto *user : v.getUsers())
+      if (isa<comb::CombDialect>(user->getDialect()))
+        for (auto result : user->getResults())
+          depth = std::max(depth, getDeparture(result) + 1);
+    return departure[v] = depth;
+  }
+
+private:
+  llvm::DenseMap<Value, unsigned> arrival;
+  llvm::DenseMap<Value, unsigned> departure;
+};
+} // end anonymous namespace
+
+/// Moves the register from the output of the comb op that drives it to the
+/// inputs of that op.
+static LogicalResult retimeBackward(SimpleReg &reg, CombDepth &depth) {
+  Value const input = reg.getInput();
+  auto *op = input.getDefiningOp();
+  auto resetToZero = reg.isResetToZero();
+  if (!resetToZero || !isRetimable(op, *resetToZero) || !input.hasOneUse())
+    return failure();
+  // With a reset, constant inputs would not map zero to zero.
+  auto isConstant = [](Value v) { return v.getDefiningOp<hw::ConstantOp>(); };
+  if (*resetToZero && llvm::any_of(op->getOperands(), isConstant))
+    return failure();
+  unsigned maxDeparture = 0;
+  for (auto read : reg.reads)
+    maxDeparture = std::max(maxDeparture, depth.getDeparture(read));
+  if (depth.getArrival(input) <= maxDeparture + 1)
+    return failure();
+
+  OpBuilder builder(reg.alwaysFF);
+  auto loc = reg.reg.getLoc();
+  for (auto &operand : op->getOpOperands()) {
+    if (isConstant(operand.get()))
+      continue;
+    auto name = builder.getStringAttr(reg.reg.getName() + "_rt" +
+                                      Twine(operand.getOperandNumber()));
+    auto resetValue = *resetToZero
+                          ? getZero(builder, loc, operand.get().getType())
+                          : Value();
+    operand.set(
+        createRegLike(builder, reg, operand.get(), resetValue, name));
+  }
+  for (auto read : reg.reads)
+    read.getResult().replaceAllUsesWith(op->getResult(0));
+  reg.erase();
+  return success();
+}
+
+/// Moves the registers on all inputs of a comb op to its output. Each of the
+/// registers must only drive this op.
+static LogicalResult retimeForward(Operation *op, CombDepth &depth,
+                                   llvm::DenseMap<Value, SimpleReg> &regs) {
+  SmallVector<SimpleReg *> inputRegs;
+  for (auto operand : op->getOperands()) {
+    if (operand.getDefiningOp<hw::ConstantOp>())
+      continue;
+    auto it = regs.find(operand);
+    if (it == regs.end() || !operand.hasOneUse() ||
+        it->second.reads.size() != 1)
+      return failure();
+    inputRegs.push_back(&it->second);
+  }
+  if (inputRegs.empty())
+    return failure();
+  SimpleReg &proto = *inputRegs.front();
+  auto resetToZero = proto.isResetToZero();
+  if (!resetToZero || !isRetimable(op, *resetToZero))
+    return failure();
+  // Constant inputs are not registered, so they would break the zero reset.
+  if (*resetToZero && inputRegs.size() != op->getNumOperands())
+    return failure();
+  unsigned maxArrival = 0;
+  for (auto *inputReg : inputRegs) {
+    if (!haveSameClockAndReset(proto, *inputReg))
+      return failure();
+    maxArrival = std::max(maxArrival, depth.getArrival(inputReg->getInput()));
+  }
+  if (depth.getDeparture(op->getResult(0)) <= maxArrival + 1)
+    return failure();
+
+  Value const result = op->getResult(0);
+  SmallVector<OpOperand *> uses;
+  for (auto &use : result.getUses())
+    uses.push_back(&use);
+  OpBuilder builder(proto.alwaysFF);
+  auto loc = proto.reg.getLoc();
+  auto resetValue =
+      *resetToZero ? getZero(builder, loc, result.getType()) : Value();
+  auto output =
+      createRegLike(builder, proto, result, resetValue,
+                    builder.getStringAttr(proto.reg.getName() + "_rt"));
+  for (auto *use : uses)
+    use->set(output);
+  for (auto *inputReg : inputRegs) {
+    auto read = inputReg->reads.front();
+    read.getResult().replaceAllUsesWith(inputReg->getInput());
+    inputReg->erase();
+  }
+  return success();
+}
+
+/// Splits the uses of a register between copies of it, so that none of them
+/// has more than `maxFanout` uses.
+static LogicalResult duplicateRegister(SimpleReg &reg, size_t maxFanout) {
+  size_t const fanout = reg.getFanout();
+  if (fanout <= maxFanout)
+    return failure();
+  SmallVector<OpOperand *> uses;
+  for (auto read : reg.reads)
+    for (auto &use : read->getUses())
+      uses.push_back(&use);
+
+  size_t const numCopies = (fanout + maxFanout - 1) / maxFanout;
+  size_t const usesPerCopy = (fanout + numCopies - 1) / numCopies;
+  Value const resetValue =
+      reg.resetAssign ? reg.resetAssign.getSrc() : Value();
+  OpBuilder builder(reg.alwaysFF);
+  SmallVector<Value> copies;
+  for (size_t i = 1; i < numCopies; i++)
+    copies.push_back(createRegLike(
+        builder, reg, reg.getInput(), resetValue,
+        builder.getStringAttr(reg.reg.getName() + "_dup" + Twine(i))));
+  for (size_t i = usesPerCopy; i < uses.size(); i++)
+    uses[i]->set(copies[i / usesPerCopy - 1]);
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// HWRegisterFanoutPass
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct HWRegisterFanoutPass
+    : public sv::HWRegisterFanoutBase<HWRegisterFanoutPass> {
+  void runOnOperation() override;
+
+private:
+  bool retimeOnce(hw::HWModuleOp module);
+};
+} // end anonymous namespace
+
+/// Applies the first profitable retiming move that is found. The depths have
+/// to be recomputed after each move since it changes the depth of the
+/// neighbouring stages.
+bool HWRegisterFanoutPass::retimeOnce(hw::HWModuleOp module) {
+  CombDepth depth;
+  SmallVector<SimpleReg> regs;
+  llvm::DenseMap<Value, SimpleReg> regsByOutput;
+  for (auto reg : module.getBodyBlock()->getOps<RegOp>()) {
+    auto simpleReg = matchSimpleReg(reg);
+    if (!simpleReg)
+      continue;
+    regs.push_back(*simpleReg);
+    for (auto read : simpleReg->reads)
+      regsByOutput[read] = *simpleReg;
+  }
+
+  for (auto &reg : regs)
+    if (succeeded(retimeBackward(reg, depth)))
+      return true;
+  for (auto &op : *module.getBodyBlock())
+    if (isa<comb::CombDialect>(op.getDialect()) &&
+        succeeded(retimeForward(&op, depth, regsByOutput)))
+      return true;
+  return false;
+}
+
+void HWRegisterFanoutPass::runOnOperation() {
+  auto module = getOperation();
+  if (maxFanout < 2) {
+    module.emitError("max-fanout must be at least 2");
+    return signalPassFailure();
+  }
+
+  bool changed = false;
+  if (retime) {
+    // Every move strictly lowers the depth of the deeper stage around the
+    // register, the bound only guards against pathological inputs.
+    size_t const maxMoves = module.getBodyBlock()->getOperations().size();
+    for (size_t i = 0; i < maxMoves && retimeOnce(module); i++)
+      changed = true;
+  }
+
+  SmallVector<RegOp> worklist(module.getBodyBlock()->getOps<RegOp>());
+  while (!worklist.empty()) {
+    auto reg = worklist.pop_back_val();
+    auto simpleReg = matchSimpleReg(reg);
+    if (!simpleReg || failed(duplicateRegister(*simpleReg, maxFanout)))
+      continue;
+    changed = true;
+    // The copies add to the fanout of the register that drives them.
+    if (auto read = simpleReg->getInput().getDefiningOp<ReadInOutOp>())
+      if (auto driver = read.getInput().getDefiningOp<RegOp>())
+        if (driver != reg)
+          worklist.push_back(driver);
+  }
+
+  if (!changed)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<Pass> circt::sv::createHWRegisterFanoutPass() {
+  return std::make_unique<HWRegisterFanoutPass>();
+}
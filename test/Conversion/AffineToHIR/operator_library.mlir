@@ -0,0 +1,40 @@
+// RUN: circt-opt -hir-pragma="function=scale operator-library=%S/Inputs/operators.json" %s | FileCheck %s
+
+// Both arith.mulf ops call the one fmul_f32 decl, which carries the latency
+// from the library as its result delay. The 32 bit arith.muli uses mul_i32,
+// which has the default II of 1. arith.addi has no entry and stays as it is.
+// CHECK: func.func private @fmul_f32(f32 {hir.delay = 0 : i64}, f32 {hir.delay = 0 : i64}) -> (f32 {hir.delay = 4 : i64}) {{.*}}hir.ii = 1 : i64, hir.resource_cost = {dsp = 3 : i64, lut = 120 : i64}
+// CHECK: func.func private @mul_i32(i32 {hir.delay = 0 : i64}, i32 {hir.delay = 0 : i64}) -> (i32 {hir.delay = 2 : i64}) {{.*}}hir.ii = 1 : i64, hir.resource_cost = {dsp = 1 : i64}
+// CHECK-NOT: fdiv_f32
+// CHECK-LABEL: func.func @scale
+// CHECK: affine.for
+// CHECK: call @fmul_f32(%{{.+}}, %{{.+}}) {result_delays = [4 : i64]} : (f32, f32) -> f32
+// CHECK: call @fmul_f32(%{{.+}}, %{{.+}}) {result_delays = [4 : i64]} : (f32, f32) -> f32
+// CHECK: call @mul_i32(%{{.+}}, %{{.+}}) {result_delays = [2 : i64]} : (i32, i32) -> i32
+// CHECK: arith.addi
+// CHECK-NOT: arith.mul
+func.func @scale(
+    %A: memref<8xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %B: memref<8xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %C: memref<8xi32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %k: f32 {hls.INTERFACE_LATENCY = 0 : i64},
+    %n: i32 {hls.INTERFACE_LATENCY = 0 : i64})
+    attributes {argNames = ["A", "B", "C", "k", "n"]} {
+  affine.for %i = 0 to 8 {
+    %a = affine.load %A[%i] : memref<8xf32>
+    %x = arith.mulf %a, %k : f32
+    %y = arith.mulf %x, %k : f32
+    affine.store %y, %B[%i] : memref<8xf32>
+    %c = affine.load %C[%i] : memref<8xi32>
+    %m = arith.muli %c, %n : i32
+    %s = arith.addi %m, %n : i32
+    affine.store %s, %C[%i] : memref<8xi32>
+  } {hls.PIPELINE_II = 1 : i64}
+  return
+}
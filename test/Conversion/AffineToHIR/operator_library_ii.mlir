@@ -0,0 +1,22 @@
+// REQUIRES: or-tools
+// RUN: circt-opt -hir-pragma="function=ratio operator-library=%S/Inputs/operators.json" -affine-to-hir -verify-diagnostics %s
+
+// fdiv_f32 accepts new inputs every 4 cycles, which a loop with an II of 1
+// can not respect.
+func.func @ratio(
+    %A: memref<8xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %B: memref<8xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %k: f32 {hls.INTERFACE_LATENCY = 0 : i64})
+    attributes {argNames = ["A", "B", "k"]} {
+  affine.for %i = 0 to 8 {
+    %a = affine.load %A[%i] : memref<8xf32>
+    // expected-error @+1 {{Callee fdiv_f32 has II 4 but the enclosing loops may issue it every 1 cycles.}}
+    %x = arith.divf %a, %k : f32
+    affine.store %x, %B[%i] : memref<8xf32>
+  } {hls.PIPELINE_II = 1 : i64}
+  return
+}
@@ -0,0 +1,33 @@
+// REQUIRES: or-tools
+// RUN: circt-opt -hir-pragma="function=scale2 operator-limits=mul_f32:1" -affine-to-hir %s | FileCheck %s
+
+func.func private @mul_f32(f32 {hls.INTERFACE_LATENCY = 0 : i64},
+                           f32 {hls.INTERFACE_LATENCY = 0 : i64})
+    -> (f32 {hls.INTERFACE_LATENCY = 2 : i64})
+    attributes {argNames = ["a", "b"], resultNames = ["out"]}
+
+// Both multiplies are bound to the one allowed instance. The second one can
+// not be issued two cycles after the first, since that is the same cycle
+// modulo the II, so the scheduler delays it.
+// CHECK-LABEL: hir.func @scale2
+// CHECK: hir.for
+// CHECK: hir.call "mul_f32_shared0" @mul_f32
+// CHECK: hir.call "mul_f32_shared0" @mul_f32
+// CHECK-NOT: hir.call
+func.func @scale2(
+    %A: memref<8xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %B: memref<8xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %k: f32 {hls.INTERFACE_LATENCY = 0 : i64})
+    attributes {argNames = ["A", "B", "k"]} {
+  affine.for %i = 0 to 8 {
+    %a = affine.load %A[%i] : memref<8xf32>
+    %x = arith.mulf %a, %k : f32
+    %y = arith.mulf %x, %k : f32
+    affine.store %y, %B[%i] : memref<8xf32>
+  } {hls.PIPELINE_II = 2 : i64}
+  return
+}
@@ -0,0 +1,61 @@
+// RUN: circt-opt -hir-pragma="function=sum split-reductions=true" %s | FileCheck %s
+
+func.func private @add_f32(f32 {hls.INTERFACE_LATENCY = 0 : i64},
+                           f32 {hls.INTERFACE_LATENCY = 0 : i64})
+    -> (f32 {hls.INTERFACE_LATENCY = 3 : i64})
+    attributes {argNames = ["a", "b"], resultNames = ["out"]}
+
+// An accumulation through the add takes 4 cycles, so the loop is unrolled by 4
+// over 4 partial accumulators and its II goes from 1 to 4. The partial sums
+// are added by a tree after the loop.
+// CHECK-LABEL: func.func @sum
+// CHECK: %[[P1:.+]] = memref.alloca()
+// CHECK: %[[P2:.+]] = memref.alloca()
+// CHECK: %[[P3:.+]] = memref.alloca()
+// CHECK: %[[ACC:.+]] = memref.alloca()
+// CHECK: affine.store %{{.+}}, %[[ACC]][0]
+// CHECK: %[[ZERO:.+]] = arith.constant 0.000000e+00 : f32
+// CHECK-NEXT: affine.store %[[ZERO]], %[[P1]][0]
+// CHECK-NEXT: affine.store %[[ZERO]], %[[P2]][0]
+// CHECK-NEXT: affine.store %[[ZERO]], %[[P3]][0]
+// CHECK: affine.for %[[I:.+]] = 0 to 16 step 4 {
+// CHECK: affine.load %[[ACC]][0]
+// CHECK: affine.store %{{.+}}, %[[ACC]][0]
+// CHECK: affine.load %{{.+}}[%[[I]] + 1]
+// CHECK: affine.load %[[P1]][0]
+// CHECK: affine.store %{{.+}}, %[[P1]][0]
+// CHECK: affine.load %{{.+}}[%[[I]] + 2]
+// CHECK: affine.load %[[P2]][0]
+// CHECK: affine.store %{{.+}}, %[[P2]][0]
+// CHECK: affine.load %{{.+}}[%[[I]] + 3]
+// CHECK: affine.load %[[P3]][0]
+// CHECK: affine.store %{{.+}}, %[[P3]][0]
+// CHECK: } {II = 4 : i64}
+// CHECK: %[[S0:.+]] = affine.load %[[ACC]][0]
+// CHECK: %[[S1:.+]] = affine.load %[[P1]][0]
+// CHECK: %[[S2:.+]] = affine.load %[[P2]][0]
+// CHECK: %[[S3:.+]] = affine.load %[[P3]][0]
+// CHECK: %[[S01:.+]] = call @add_f32(%[[S0]], %[[S1]])
+// CHECK: %[[S23:.+]] = call @add_f32(%[[S2]], %[[S3]])
+// CHECK: %[[S:.+]] = call @add_f32(%[[S01]], %[[S23]])
+// CHECK: affine.store %[[S]], %[[ACC]][0]
+func.func @sum(
+    %A: memref<16xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                        hls.INTERFACE_RD_LATENCY = 1 : i64,
+                        hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %out: memref<1xf32> {hls.INTERFACE_STORAGE_TYPE = "ram_1p",
+                         hls.INTERFACE_WR_LATENCY = 1 : i64})
+    attributes {argNames = ["A", "out"]} {
+  %zero = arith.constant 0.0 : f32
+  %acc = memref.alloca() : memref<1xf32>
+  affine.store %zero, %acc[0] : memref<1xf32>
+  affine.for %i = 0 to 16 {
+    %a = affine.load %A[%i] : memref<16xf32>
+    %s = affine.load %acc[0] : memref<1xf32>
+    %r = arith.addf %s, %a : f32
+    affine.store %r, %acc[0] : memref<1xf32>
+  } {hls.PIPELINE_II = 1 : i64}
+  %sum = affine.load %acc[0] : memref<1xf32>
+  affine.store %sum, %out[0] : memref<1xf32>
+  return
+}
@@ -0,0 +1,37 @@
+// RUN: circt-opt %s | FileCheck %s
+// RUN: circt-opt %s | circt-opt | FileCheck %s
+
+// Callee types and memref port dictionaries are printed once as aliases, and
+// the printed aliases parse back to the same IR.
+// CHECK-DAG: #port_r1 = {rd_latency = 1 : i64}
+// CHECK-DAG: #port_w1 = {wr_latency = 1 : i64}
+// CHECK-DAG: #port_r0_w1 = {rd_latency = 0 : i64, wr_latency = 1 : i64}
+// CHECK-DAG: !hir_func = !hir.func<
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+#reg_rw = {"rd_latency" = 0, "wr_latency" = 1}
+
+hir.func.extern @mult at %t (%a: i32, %b: i32) -> (%p: i32 delay 2) {argNames=["a","b","t"],resultNames=["p"]}
+
+// CHECK-LABEL: hir.func @square_sum
+// CHECK-SAME: ports [#port_r1]
+// CHECK-SAME: ports [#port_w1]
+hir.func @square_sum at %t(%A :!hir.memref<4xi32> ports [#bram_r],
+  %B :!hir.memref<4xi32> ports [#bram_w]) {
+  %c0_i2 = hw.constant 0:i2
+  %c1_i2 = hw.constant 1:i2
+  %c0 = arith.constant 0:index
+  // CHECK: hir.alloca reg {{.+}} ports [#port_r0_w1]
+  %acc = hir.alloca reg : !hir.memref<(bank 1)xi32> ports [#reg_rw]
+  %x = hir.load %A[port 0][%c0_i2] at %t : !hir.memref<4xi32> delay 1
+  %y = hir.load %A[port 0][%c1_i2] at %t + 1 : !hir.memref<4xi32> delay 1
+  // CHECK: hir.call "mult0" @mult({{.+}}) at {{.+}} : !hir_func
+  // CHECK: hir.call "mult1" @mult({{.+}}) at {{.+}} : !hir_func
+  %xx = hir.call "mult0" @mult(%x, %x) at %t + 1 : !hir.func<(i32, i32) -> (i32 delay 2)>
+  %yy = hir.call "mult1" @mult(%y, %y) at %t + 2 : !hir.func<(i32, i32) -> (i32 delay 2)>
+  %xx_1 = hir.delay %xx by 1 at %t + 3 : i32
+  %s = comb.add %xx_1, %yy : i32
+  hir.store %s to %acc[port 0][%c0] at %t + 4 : !hir.memref<(bank 1)xi32> delay 1
+  hir.store %s to %B[port 0][%c0_i2] at %t + 4 : !hir.memref<4xi32> delay 1
+  hir.return
+}
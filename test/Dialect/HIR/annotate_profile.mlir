@@ -0,0 +1,30 @@
+// RUN: circt-opt -hir-annotate-profile=profile=%S/Inputs/profile.json %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+
+// The first loop ran three times, for 2, 5 and 5 iterations. The second loop
+// never ran, so it is not annotated.
+// CHECK-LABEL: hir.func @search
+hir.func @search at %t(%A :!hir.memref<16xi32> ports [#bram_r], %key :i32) {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  %true = hw.constant 1:i1
+  // CHECK: hir.while
+  // CHECK: hir.profile = {executions = 3 : i64, max_trip_count = 5 : i64, mean_trip_count = 4 : i64}
+  %i_last, %t_1 = hir.while %true iter_args(%i = %c0_i4 : i4) iter_time(%ti = %t + 1){
+    %v = hir.load %A[port 0][%i] at %ti : !hir.memref<16xi32> delay 1
+    %found = comb.icmp eq %v, %key : i32
+    %i_1 = hir.delay %i by 1 at %ti : i4
+    %i_next = comb.add %i_1, %c1_i4 : i4
+    hir.next_iter break %found iter_args(%i_next) at %ti + 1 : (i4)
+  }
+  // CHECK: hir.while
+  // CHECK-NOT: hir.profile
+  %j_last, %t_2 = hir.while %true iter_args(%j = %c0_i4 : i4) iter_time(%tj = %t_1 + 1){
+    %v = hir.load %A[port 0][%j] at %tj : !hir.memref<16xi32> delay 1
+    %found = comb.icmp eq %v, %key : i32
+    %j_1 = hir.delay %j by 1 at %tj : i4
+    %j_next = comb.add %j_1, %c1_i4 : i4
+    hir.next_iter break %found iter_args(%j_next) at %tj + 1 : (i4)
+  }
+  hir.return
+}
@@ -0,0 +1,33 @@
+// RUN: circt-opt -hir-to-hw="balance-mux-chains=true min-mux-chain-length=3" %s | FileCheck %s
+
+// A priority chain of four muxes becomes a tree of depth two, plus the mux
+// that falls back to %d. The first half of the chain still wins.
+// CHECK-LABEL: hw.module @chain4
+// CHECK-NEXT: %[[M01:.+]] = comb.mux %s0, %v0, %v1 : i32
+// CHECK-NEXT: %[[S01:.+]] = comb.or %s0, %s1 : i1
+// CHECK-NEXT: %[[M23:.+]] = comb.mux %s2, %v2, %v3 : i32
+// CHECK-NEXT: %[[S23:.+]] = comb.or %s2, %s3 : i1
+// CHECK-NEXT: %[[M03:.+]] = comb.mux %[[S01]], %[[M01]], %[[M23]] : i32
+// CHECK-NEXT: %[[S03:.+]] = comb.or %[[S01]], %[[S23]] : i1
+// CHECK-NEXT: %[[ROOT:.+]] = comb.mux %[[S03]], %[[M03]], %d : i32
+// CHECK-NEXT: hw.output %[[ROOT]] : i32
+hw.module @chain4(%s0: i1, %s1: i1, %s2: i1, %s3: i1, %v0: i32, %v1: i32,
+                  %v2: i32, %v3: i32, %d: i32) -> (out: i32) {
+  %m3 = comb.mux %s3, %v3, %d : i32
+  %m2 = comb.mux %s2, %v2, %m3 : i32
+  %m1 = comb.mux %s1, %v1, %m2 : i32
+  %m0 = comb.mux %s0, %v0, %m1 : i32
+  hw.output %m0 : i32
+}
+
+// A chain shorter than min-mux-chain-length is left alone.
+// CHECK-LABEL: hw.module @chain2
+// CHECK-NEXT: %[[M1:.+]] = comb.mux %s1, %v1, %d : i32
+// CHECK-NEXT: %[[M0:.+]] = comb.mux %s0, %v0, %[[M1]] : i32
+// CHECK-NEXT: hw.output %[[M0]] : i32
+hw.module @chain2(%s0: i1, %s1: i1, %v0: i32, %v1: i32, %d: i32)
+    -> (out: i32) {
+  %m1 = comb.mux %s1, %v1, %d : i32
+  %m0 = comb.mux %s0, %v0, %m1 : i32
+  hw.output %m0 : i32
+}
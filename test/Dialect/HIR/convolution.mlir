@@ -1,4 +1,5 @@
 // RUN: circt-opt -hir-simplify -hir-to-hw %s
+// RUN: circt-opt -hir-simplify -hir-to-hw="balance-mux-chains=true min-mux-chain-length=2" %s
 #bram_r = {"rd_latency"=1}
 #reg_r = {"rd_latency"=0}
 #bram_w = {"wr_latency"=1}
@@ -0,0 +1,134 @@
+// RUN: circt-opt -hir-double-buffer %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+#bram_rw = {"rd_latency" = 1, "wr_latency" = 1}
+
+// Each frame is copied into %buf and then read back in reverse. After the pass
+// %buf holds two frames and the copy of frame N+1 overlaps the read of frame N.
+// The reader starts 18 cycles into its frame, after the next frame has begun,
+// so it gets the frame index and parity through hir.delay ops.
+// CHECK-LABEL: hir.func @reverse_frames
+// CHECK: hir.alloca bram : !hir.memref<2x16xi32>
+// CHECK-COUNT-2: hir.delay {{.*}} by 18
+hir.func @reverse_frames at %t(
+  %A :!hir.memref<4x16xi32> ports [#bram_r],
+  %B :!hir.memref<4x16xi32> ports [#bram_w]) {
+  %c0_i3 = hw.constant 0:i3
+  %c1_i3 = hw.constant 1:i3
+  %c4_i3 = hw.constant 4:i3
+  %c0_i5 = hw.constant 0:i5
+  %c1_i5 = hw.constant 1:i5
+  %c16_i5 = hw.constant 16:i5
+  %c15_i4 = hw.constant 15:i4
+  %buf = hir.alloca bram : !hir.memref<16xi32> ports [#bram_r, #bram_w]
+
+  %t_end = hir.for %f : i3 = %c0_i3 to %c4_i3 step %c1_i3 iter_time(%tf = %t + 1){
+    %f2 = comb.extract %f from 0: (i3)->(i2)
+    %tp_end = hir.for %i : i5 = %c0_i5 to %c16_i5 step %c1_i5 iter_time(%ti = %tf){
+      %i4 = comb.extract %i from 0: (i5)->(i4)
+      %v = hir.load %A[port 0][%f2, %i4] at %ti : !hir.memref<4x16xi32> delay 1
+      %i4_1 = hir.delay %i4 by 1 at %ti : i4
+      hir.store %v to %buf[port 1][%i4_1] at %ti + 1 : !hir.memref<16xi32> delay 1
+      hir.next_iter at %ti + 1
+    }
+    %tc_end = hir.for %j : i5 = %c0_i5 to %c16_i5 step %c1_i5 iter_time(%tj = %tp_end + 2){
+      %j4 = comb.extract %j from 0: (i5)->(i4)
+      %jr = comb.sub %c15_i4, %j4 : i4
+      %w = hir.load %buf[port 0][%jr] at %tj : !hir.memref<16xi32> delay 1
+      %g2 = comb.extract %f from 0: (i3)->(i2)
+      %g2_1 = hir.delay %g2 by 1 at %tj : i2
+      %j4_1 = hir.delay %j4 by 1 at %tj : i4
+      hir.store %w to %B[port 0][%g2_1, %j4_1] at %tj + 1 : !hir.memref<4x16xi32> delay 1
+      hir.next_iter at %tj + 1
+    }
+    hir.next_iter at %tc_end + 1
+  }
+  hir.return
+}
+
+// The copy and the read share the only port of %buf, so they can not overlap.
+// CHECK-LABEL: hir.func @shared_port
+// CHECK: hir.alloca bram : !hir.memref<16xi32>
+// CHECK-NOT: by 18
+hir.func @shared_port at %t(
+  %A :!hir.memref<4x16xi32> ports [#bram_r],
+  %B :!hir.memref<4x16xi32> ports [#bram_w]) {
+  %c0_i3 = hw.constant 0:i3
+  %c1_i3 = hw.constant 1:i3
+  %c4_i3 = hw.constant 4:i3
+  %c0_i5 = hw.constant 0:i5
+  %c1_i5 = hw.constant 1:i5
+  %c16_i5 = hw.constant 16:i5
+  %buf = hir.alloca bram : !hir.memref<16xi32> ports [#bram_rw]
+
+  %t_end = hir.for %f : i3 = %c0_i3 to %c4_i3 step %c1_i3 iter_time(%tf = %t + 1){
+    %f2 = comb.extract %f from 0: (i3)->(i2)
+    %tp_end = hir.for %i : i5 = %c0_i5 to %c16_i5 step %c1_i5 iter_time(%ti = %tf){
+      %i4 = comb.extract %i from 0: (i5)->(i4)
+      %v = hir.load %A[port 0][%f2, %i4] at %ti : !hir.memref<4x16xi32> delay 1
+      %i4_1 = hir.delay %i4 by 1 at %ti : i4
+      hir.store %v to %buf[port 0][%i4_1] at %ti + 1 : !hir.memref<16xi32> delay 1
+      hir.next_iter at %ti + 1
+    }
+    %tc_end = hir.for %j : i5 = %c0_i5 to %c16_i5 step %c1_i5 iter_time(%tj = %tp_end + 2){
+      %j4 = comb.extract %j from 0: (i5)->(i4)
+      %w = hir.load %buf[port 0][%j4] at %tj : !hir.memref<16xi32> delay 1
+      %g2 = comb.extract %f from 0: (i3)->(i2)
+      %g2_1 = hir.delay %g2 by 1 at %tj : i2
+      %j4_1 = hir.delay %j4 by 1 at %tj : i4
+      hir.store %w to %B[port 0][%g2_1, %j4_1] at %tj + 1 : !hir.memref<4x16xi32> delay 1
+      hir.next_iter at %tj + 1
+    }
+    hir.next_iter at %tc_end + 1
+  }
+  hir.return
+}
+
+// The same copy and reverse read in the shape AffineToHIR emits: both loops
+// and the next outer iteration are scheduled at static offsets from %tf, and
+// the frame index reaches each loop through an hir.delay and an iter_arg.
+// CHECK-LABEL: hir.func @reverse_frames_static
+// CHECK: hir.alloca bram : !hir.memref<2x16xi32>
+// CHECK: hir.for %[[F:.+]] : i64 = {{.*}} iter_time( %[[TF:.+]] = %{{.+}} + 1)
+// CHECK: %[[P:.+]] = comb.extract %[[F]] from 0 : (i64) -> i1
+// CHECK: %[[CP:.+]] = hir.delay %[[P]] by 18 at %[[TF]] : i1
+// CHECK: %[[FC:.+]] = hir.delay %[[F]] by 18 at %[[TF]] : i64
+// CHECK: hir.for {{.*}} iter_args(%{{.+}}=%[[FC]]: i64,%{{.+}}=%[[CP]]: i1)
+// CHECK: hir.next_iter at %[[TF]] + 17
+// CHECK-NEXT: } {initiation_interval = 17 : i64}
+hir.func @reverse_frames_static at %t(
+  %A :!hir.memref<4x16xi32> ports [#bram_r],
+  %B :!hir.memref<4x16xi32> ports [#bram_w]) {
+  %c0 = hw.constant 0:i64
+  %c1 = hw.constant 1:i64
+  %c4 = hw.constant 4:i64
+  %c16 = hw.constant 16:i64
+  %c15_i4 = hw.constant 15:i4
+  %buf = hir.alloca bram : !hir.memref<16xi32> ports [#bram_r, #bram_w]
+
+  %t_end = hir.for %f : i64 = %c0 to %c4 step %c1 iter_time(%tf = %t + 1){
+    %tp_end = hir.for %i : i64 = %c0 to %c16 step %c1 iter_args(%fp = %f : i64) iter_time(%ti = %tf){
+      %i4 = comb.extract %i from 0: (i64)->(i4)
+      %f2 = comb.extract %fp from 0: (i64)->(i2)
+      %v = hir.load %A[port 0][%f2, %i4] at %ti : !hir.memref<4x16xi32> delay 1
+      %i4_1 = hir.delay %i4 by 1 at %ti : i4
+      hir.store %v to %buf[port 1][%i4_1] at %ti + 1 : !hir.memref<16xi32> delay 1
+      %fp_1 = hir.delay %fp by 1 at %ti : i64
+      hir.next_iter iter_args(%fp_1) at %ti + 1
+    } {initiation_interval = 1}
+    %f_18 = hir.delay %f by 18 at %tf : i64
+    %tc_end = hir.for %j : i64 = %c0 to %c16 step %c1 iter_args(%fc = %f_18 : i64) iter_time(%tj = %tf + 18){
+      %j4 = comb.extract %j from 0: (i64)->(i4)
+      %jr = comb.sub %c15_i4, %j4 : i4
+      %w = hir.load %buf[port 0][%jr] at %tj : !hir.memref<16xi32> delay 1
+      %g2 = comb.extract %fc from 0: (i64)->(i2)
+      %g2_1 = hir.delay %g2 by 1 at %tj : i2
+      %j4_1 = hir.delay %j4 by 1 at %tj : i4
+      hir.store %w to %B[port 0][%g2_1, %j4_1] at %tj + 1 : !hir.memref<4x16xi32> delay 1
+      %fc_1 = hir.delay %fc by 1 at %tj : i64
+      hir.next_iter iter_args(%fc_1) at %tj + 1
+    } {initiation_interval = 1}
+    hir.next_iter at %tf + 35
+  } {initiation_interval = 35}
+  hir.return
+}
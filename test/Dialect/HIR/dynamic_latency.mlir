@@ -0,0 +1,79 @@
+// RUN: circt-opt -hir-verify-schedule -split-input-file -verify-diagnostics %s
+
+// A divider with a data dependent latency. The quotient is valid one cycle
+// after the done signal.
+hir.func.extern @div_i32 at %t(%a:i32, %b:i32) ->(%done:!hir.time, %q:i32 delay 1 from 0)
+
+hir.func @div_x2 at %t(%a:i32, %b:i32) ->(%done:!hir.time, %res:i32 delay 0 from 0){
+  %done_div, %q = hir.call "div" @div_i32(%a,%b) at %t
+    : !hir.func<(i32, i32) -> (!hir.time, i32 delay 1 from 0)>
+  // Only the ops that depend on the quotient wait for the divider.
+  %t_q = hir.time %done_div + 1 : !hir.time
+  %res = comb.add %q, %q : i32
+  hir.return (%t_q, %res) : (!hir.time, i32)
+}
+
+// -----
+
+hir.func.extern @div_i32 at %t(%a:i32, %b:i32) ->(%done:!hir.time, %q:i32 delay 1 from 0)
+
+// The quotient is returned one cycle before it is valid.
+hir.func @div_early at %t(%a:i32, %b:i32) ->(%done:!hir.time, %res:i32 delay 0 from 0){
+  // expected-note @+1 {{Operand defined here.}}
+  %done_div, %q = hir.call "div" @div_i32(%a,%b) at %t
+    : !hir.func<(i32, i32) -> (!hir.time, i32 delay 1 from 0)>
+  // expected-error @+1 {{Error in scheduling of returned value.}}
+  hir.return (%done_div, %q) : (!hir.time, i32)
+}
+
+// -----
+
+hir.func.extern @div_i32 at %t(%a:i32, %b:i32) ->(%done:!hir.time, %q:i32 delay 1 from 0)
+
+// The second division starts once the first one is done, so both can use the
+// same divider instance.
+hir.func @div_twice at %t(%a:i32, %b:i32) ->(%done:!hir.time, %res:i32 delay 1 from 0){
+  %done0, %q0 = hir.call "div" @div_i32(%a,%b) at %t
+    : !hir.func<(i32, i32) -> (!hir.time, i32 delay 1 from 0)>
+  %t_q0 = hir.time %done0 + 1 : !hir.time
+  %done1, %q1 = hir.call "div" @div_i32(%q0,%q0) at %t_q0
+    : !hir.func<(i32, i32) -> (!hir.time, i32 delay 1 from 0)>
+  hir.return (%done1, %q1) : (!hir.time, i32)
+}
+
+// -----
+
+hir.func.extern @div_i32 at %t(%a:i32, %b:i32) ->(%done:!hir.time, %q:i32 delay 1 from 0)
+
+// The divider has no ready output, so it can not be issued again while it is
+// busy.
+hir.func @div_reissue at %t(%a:i32, %b:i32) {
+  // expected-note @+1 {{Earlier call here. The next call must start at or after its done time.}}
+  %done0, %q0 = hir.call "div" @div_i32(%a,%b) at %t
+    : !hir.func<(i32, i32) -> (!hir.time, i32 delay 1 from 0)>
+  %a1 = hir.delay %a by 1 at %t : i32
+  %b1 = hir.delay %b by 1 at %t : i32
+  // expected-error @+1 {{Dynamic-latency call may overlap with an earlier call.}}
+  %done1, %q1 = hir.call "div" @div_i32(%a1,%b1) at %t + 1
+    : !hir.func<(i32, i32) -> (!hir.time, i32 delay 1 from 0)>
+  hir.return
+}
+
+// -----
+
+hir.func.extern @div_i32 at %t(%a:i32, %b:i32) ->(%done:!hir.time, %q:i32 delay 1 from 0)
+
+// A pipelined loop issues the divider every cycle.
+hir.func @div_loop at %t() {
+  %c0 = hw.constant 0 : i32
+  %c1 = hw.constant 1 : i32
+  %c4 = hw.constant 4 : i32
+  hir.for %i : i32 = %c0 to %c4 step %c1 iter_time(%ti = %t + 1){
+    // expected-error @+1 {{Dynamic-latency call may overlap with the call of the next loop iteration.}}
+    %done, %q = hir.call "div" @div_i32(%i,%c4) at %ti
+      : !hir.func<(i32, i32) -> (!hir.time, i32 delay 1 from 0)>
+    // expected-note @+1 {{The next iteration starts here, before the call is done.}}
+    hir.next_iter at %ti + 1
+  }
+  hir.return
+}
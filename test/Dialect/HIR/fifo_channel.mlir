@@ -0,0 +1,65 @@
+// RUN: circt-opt -hir-verify-schedule %s
+// RUN: circt-opt -hir-to-hw %s | FileCheck %s
+
+// The second send starts once the first one is accepted. Each send holds the
+// fifo valid (and its data) until the fifo is ready.
+// CHECK-LABEL: hw.module @producer(
+// CHECK-SAME: %out_ready: i1, %t: i1, %clk: i1, %rst: i1) -> (out_data: i32, out_valid: i1)
+// CHECK: %[[ACT1:[a-z0-9_]+]] = comb.or %t, %{{.+}} : i1
+// CHECK: %[[D1:[a-z0-9_]+]] = comb.mux %[[ACT1]], %{{.+}}, %{{.+}} : i32
+// CHECK: %[[V1:[a-z0-9_]+]] = comb.or %[[ACT1]], %{{.+}} : i1
+// CHECK: %[[DONE1:[a-z0-9_]+]] = comb.and %[[ACT1]], %out_ready : i1
+// CHECK: comb.mux %[[DONE1]], %{{.+}}, %{{.+}} : i32
+// CHECK: %[[ACT2:[a-z0-9_]+]] = comb.or %[[DONE1]], %{{.+}} : i1
+// CHECK: %[[D2:[a-z0-9_]+]] = comb.mux %[[ACT2]], %{{.+}}, %[[D1]] : i32
+// CHECK: %[[V2:[a-z0-9_]+]] = comb.or %[[ACT2]], %[[V1]] : i1
+// CHECK: hw.output %[[D2]], %[[V2]] : i32, i1
+hir.func @producer at %t(%out : !hir.fifo<i32, 4> ports [send]){
+  %c1 = hw.constant 1 : i32
+  %t1 = hir.fifo.send %c1 to %out at %t : !hir.fifo<i32, 4>
+  %c2 = hw.constant 2 : i32
+  %t2 = hir.fifo.send %c2 to %out at %t1 : !hir.fifo<i32, 4>
+  hir.return
+}
+
+// The value is valid when the recv completes, so it is returned along with
+// that time.
+// CHECK-LABEL: hw.module @consumer(
+// CHECK-SAME: %in_data: i32, %in_valid: i1, %t: i1, %clk: i1, %rst: i1) -> (in_ready: i1, done: i1, res: i32)
+// CHECK: %[[ACT:[a-z0-9_]+]] = comb.or %t, %{{.+}} : i1
+// CHECK: %[[READY:[a-z0-9_]+]] = comb.or %[[ACT]], %{{.+}} : i1
+// CHECK: %[[DONE:[a-z0-9_]+]] = comb.and %[[ACT]], %in_valid : i1
+// CHECK: hw.output %[[READY]], %[[DONE]], %in_data : i1, i1, i32
+hir.func @consumer at %t(%in : !hir.fifo<i32, 4> ports [recv])
+    -> (%done : !hir.time, %res : i32 delay 0 from 0){
+  %v, %t1 = hir.fifo.recv %in at %t : !hir.fifo<i32, 4>
+  hir.return (%t1, %v) : (!hir.time, i32)
+}
+
+// A local fifo becomes an instance of a generated fifo module. The producer
+// drives its write end and the consumer its read end.
+// CHECK-LABEL: hw.module @hir_fifo_w32_d4(
+// CHECK-SAME: %wr_data: i32, %wr_valid: i1, %rd_ready: i1, %clk: i1, %rst: i1) -> (wr_ready: i1, rd_data: i32, rd_valid: i1)
+// CHECK: %[[WR_READY:[a-z0-9_]+]] = comb.icmp ne %[[COUNT:[a-z0-9_]+]], %{{.+}} : i3
+// CHECK: %[[RD_VALID:[a-z0-9_]+]] = comb.icmp ne %[[COUNT]], %{{.+}} : i3
+// CHECK: %[[RD_DATA:[a-z0-9_]+]] = hw.array_get
+// CHECK: sv.alwaysff(posedge %clk)
+// CHECK: hw.output %[[WR_READY]], %[[RD_DATA]], %[[RD_VALID]] : i1, i32, i1
+
+// CHECK-LABEL: hw.module @top(
+// CHECK: %[[WR_READY:[a-z0-9_]+]], %[[RD_DATA:[a-z0-9_]+]], %[[RD_VALID:[a-z0-9_]+]] = hw.instance "{{.+}}" @hir_fifo_w32_d4(wr_data: %[[WD:[a-z0-9_]+]]: i32, wr_valid: %[[WV:[a-z0-9_]+]]: i1, rd_ready: %[[RR:[a-z0-9_]+]]: i1, clk: %clk: i1, rst: %rst: i1)
+// CHECK: %[[P_DATA:[a-z0-9_]+]], %[[P_VALID:[a-z0-9_]+]] = hw.instance "producer" @producer(out_ready: %[[WR_READY]]: i1, t: %t: i1, clk: %clk: i1, rst: %rst: i1)
+// CHECK: %[[WD]] = comb.mux %[[P_VALID]], %[[P_DATA]], %{{.+}} : i32
+// CHECK: %[[WV]] = comb.or %[[P_VALID]], %{{.+}} : i1
+// CHECK: %[[C_READY:[a-z0-9_]+]], %[[C_DONE:[a-z0-9_]+]], %[[C_RES:[a-z0-9_]+]] = hw.instance "consumer" @consumer(in_data: %[[RD_DATA]]: i32, in_valid: %[[RD_VALID]]: i1, t: %t: i1, clk: %clk: i1, rst: %rst: i1)
+// CHECK: %[[RR]] = comb.or %[[C_READY]], %{{.+}} : i1
+// CHECK: hw.output %[[C_DONE]], %[[C_RES]] : i1, i32
+hir.func @top at %t() -> (%done : !hir.time, %res : i32 delay 0 from 0){
+  %f = hir.fifo : !hir.fifo<i32, 4>
+  hir.call "producer" @producer(%f) at %t
+    : !hir.func<(!hir.fifo<i32, 4> ports [send]) -> ()>
+  %t_v, %v = hir.call "consumer" @consumer(%f) at %t
+    : !hir.func<(!hir.fifo<i32, 4> ports [recv])
+        -> (!hir.time, i32 delay 0 from 0)>
+  hir.return (%t_v, %v) : (!hir.time, i32)
+}
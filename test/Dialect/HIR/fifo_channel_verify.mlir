@@ -0,0 +1,66 @@
+// RUN: circt-opt -hir-verify-schedule -split-input-file -verify-diagnostics %s
+
+// Each iteration starts once its receive is done.
+hir.func @drain at %t(%in : !hir.fifo<i32, 4> ports [recv]) {
+  %c0 = hw.constant 0 : i4
+  %c1 = hw.constant 1 : i4
+  %c4 = hw.constant 4 : i4
+  hir.for %i : i4 = %c0 to %c4 step %c1 iter_time(%ti = %t + 1){
+    %v, %t_v = hir.fifo.recv %in at %ti : !hir.fifo<i32, 4>
+    hir.next_iter at %t_v + 1
+  }
+  hir.return
+}
+
+// -----
+
+// Both receives wait for the same pop.
+hir.func @same_cycle at %t(%in : !hir.fifo<i32, 4> ports [recv]) {
+  // expected-note @+1 {{Earlier receive here.}}
+  %v0, %t0 = hir.fifo.recv %in at %t : !hir.fifo<i32, 4>
+  // expected-error @+1 {{Fifo receive may overlap with an earlier receive.}}
+  %v1, %t1 = hir.fifo.recv %in at %t : !hir.fifo<i32, 4>
+  hir.return
+}
+
+// -----
+
+// The first receive may still be waiting one cycle later.
+hir.func @next_cycle at %t(%in : !hir.fifo<i32, 4> ports [recv]) {
+  // expected-note @+1 {{Earlier receive here.}}
+  %v0, %t0 = hir.fifo.recv %in at %t : !hir.fifo<i32, 4>
+  // expected-error @+1 {{Fifo receive may overlap with an earlier receive.}}
+  %v1, %t1 = hir.fifo.recv %in at %t + 1 : !hir.fifo<i32, 4>
+  hir.return
+}
+
+// -----
+
+// Each iteration starts one cycle after the previous one, whether or not its
+// send is done.
+hir.func @static_ii at %t(%out : !hir.fifo<i4, 4> ports [send]) {
+  %c0 = hw.constant 0 : i4
+  %c1 = hw.constant 1 : i4
+  %c4 = hw.constant 4 : i4
+  hir.for %i : i4 = %c0 to %c4 step %c1 iter_time(%ti = %t + 1){
+    // expected-error @+1 {{Fifo send may overlap with the send of the next loop iteration.}}
+    %t_sent = hir.fifo.send %i to %out at %ti : !hir.fifo<i4, 4>
+    // expected-note @+1 {{The next iteration starts here, before the send is done.}}
+    hir.next_iter at %ti + 1
+  }
+  hir.return
+}
+
+// -----
+
+hir.func.extern @drain at %t(%in : !hir.fifo<i32, 4> ports [recv])
+
+// The callee may receive at any time.
+hir.func @call_and_recv at %t(%in : !hir.fifo<i32, 4> ports [recv]) {
+  // expected-note @+1 {{Other receive here.}}
+  hir.call "drain" @drain(%in) at %t
+    : !hir.func<(!hir.fifo<i32, 4> ports [recv]) -> ()>
+  // expected-error @+1 {{Fifo is passed to a call and has more than one receive.}}
+  %v, %t_v = hir.fifo.recv %in at %t : !hir.fifo<i32, 4>
+  hir.return
+}
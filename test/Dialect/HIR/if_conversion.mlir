@@ -0,0 +1,75 @@
+// RUN: circt-opt -hir-if-convert %s | FileCheck %s
+#bram_w = {"wr_latency" = 1}
+
+// Both branches become comb.mux ops. The outer result is valid one cycle after
+// the branch starts, so it is selected with the delayed condition.
+// CHECK-LABEL: hir.func @clamp
+// CHECK-NOT: hir.if
+// CHECK: comb.mux
+// CHECK: %[[COND:.+]] = hir.delay %{{.+}} by 1 at %{{.+}} : i1
+// CHECK-NEXT: comb.mux %[[COND]]
+// CHECK-NOT: hir.if
+// CHECK: hir.return
+hir.func @clamp at %t(%x :i32, %lo :i32, %hi :i32) -> (%r :i32 delay 1) {
+  %below = comb.icmp slt %x, %lo : i32
+  %above = comb.icmp sgt %x, %hi : i32
+  %r = hir.if %below at time(%tf = %t) -> (i32 delay 1) {
+    %lo_1 = hir.delay %lo by 1 at %tf : i32
+    hir.yield (%lo_1) : (i32)
+  } else {
+    %y = hir.if %above at time(%te = %tf) -> (i32) {
+      hir.yield (%hi) : (i32)
+    } else {
+      hir.yield (%x) : (i32)
+    }
+    %y_1 = hir.delay %y by 1 at %tf : i32
+    hir.yield (%y_1) : (i32)
+  }
+  hir.return (%r) : (i32)
+}
+
+// Each store is moved into an hir.if at its own time, on the condition for the
+// if region and on its negation for the else region.
+// CHECK-LABEL: hir.func @cond_store
+// CHECK: %[[SUM:.+]] = hir.delay %{{.+}} by 1 at %{{.+}} : i32
+// CHECK: %[[C1:.+]] = hir.delay %[[C:.+]] by 1 at %{{.+}} : i1
+// CHECK: hir.if %[[C1]] at time(%[[TS:.+]] = %{{.+}} + 1)
+// CHECK-NEXT: hir.store %[[SUM]] to %{{.+}}[port 0][%{{.+}}] at %[[TS]] :
+// CHECK: %[[NC:.+]] = comb.xor %[[C]], %{{.+}} : i1
+// CHECK: hir.if %[[NC]] at time(%[[TE:.+]] = %{{[^ +]+}})
+// CHECK-NEXT: hir.store %{{.+}} to %{{.+}}[port 0][%{{.+}}] at %[[TE]] :
+hir.func @cond_store at %t(
+  %A :!hir.memref<16xi32> ports [#bram_w],
+  %B :!hir.memref<16xi32> ports [#bram_w],
+  %c :i1, %x :i32, %y :i32) {
+  %c0_i4 = hw.constant 0:i4
+  hir.if %c at time(%tf = %t) {
+    %s = comb.add %x, %y : i32
+    %s_1 = hir.delay %s by 1 at %tf : i32
+    hir.store %s_1 to %A[port 0][%c0_i4] at %tf + 1 : !hir.memref<16xi32> delay 1
+    hir.yield
+  } else {
+    hir.store %y to %B[port 0][%c0_i4] at %tf : !hir.memref<16xi32> delay 1
+    hir.yield
+  }
+  hir.return
+}
+
+// Both regions would write through the same port, so the branch is kept.
+// CHECK-LABEL: hir.func @same_port
+// CHECK: hir.if
+// CHECK: hir.store %{{.+}} to %{{.+}}[port 0]
+// CHECK: else
+// CHECK-NEXT: hir.store %{{.+}} to %{{.+}}[port 0]
+hir.func @same_port at %t(%A :!hir.memref<16xi32> ports [#bram_w], %c :i1,
+  %x :i32, %y :i32) {
+  %c0_i4 = hw.constant 0:i4
+  hir.if %c at time(%tf = %t) {
+    hir.store %x to %A[port 0][%c0_i4] at %tf : !hir.memref<16xi32> delay 1
+    hir.yield
+  } else {
+    hir.store %y to %A[port 0][%c0_i4] at %tf : !hir.memref<16xi32> delay 1
+    hir.yield
+  }
+  hir.return
+}
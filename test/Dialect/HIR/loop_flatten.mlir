@@ -0,0 +1,71 @@
+// RUN: circt-opt -hir-loop-flatten %s | FileCheck %s
+#rd = {rd_latency=1}
+#wr = {wr_latency=1}
+
+// The inner loop restarts one cycle after the previous one finished. After
+// flattening, a new (i,j) pair is issued every cycle.
+// CHECK-LABEL: hir.func @transpose
+// CHECK: hir.for %{{.+}} : i7 = %{{.+}} to %{{.+}} step %{{.+}} iter_args([[I:%[a-z0-9_]+]]=%{{.+}}: i4,[[J:%[a-z0-9_]+]]=%{{.+}}: i4) iter_time( %[[TF:.+]] = %{{.+}} + 2)
+// CHECK-NOT: hir.for
+// CHECK: comb.extract [[I]] from 0 : (i4) -> i3
+// CHECK: comb.extract [[J]] from 0 : (i4) -> i3
+// CHECK: hir.load %{{.+}}[port 0][%{{.+}}, %{{.+}}] at %[[TF]] :
+// CHECK: hir.store %{{.+}} to %{{.+}}[port 0][%{{.+}}, %{{.+}}] at %[[TF]] + 1 :
+// CHECK: %[[WRAP:.+]] = comb.icmp eq [[J]], %{{.+}} : i4
+// CHECK: %[[JN:.+]] = comb.mux %[[WRAP]], %{{.+}}, %{{.+}} : i4
+// CHECK: %[[IN:.+]] = comb.mux %[[WRAP]], %{{.+}}, [[I]] : i4
+// CHECK: %[[IN1:.+]] = hir.delay %[[IN]] by 1 at %[[TF]] : i4
+// CHECK: %[[JN1:.+]] = hir.delay %[[JN]] by 1 at %[[TF]] : i4
+// CHECK: hir.next_iter iter_args(%[[IN1]], %[[JN1]]) at %[[TF]] + 1
+// CHECK: initiation_interval = 1
+hir.func @transpose at %t(
+%A :!hir.memref<8x8xi32> ports [#rd],
+%B :!hir.memref<8x8xi32> ports [#wr]){
+  %c0 = hw.constant 0 : i4
+  %c1 = hw.constant 1 : i4
+  %c8 = hw.constant 8 : i4
+  %t_end = hir.for %i:i4 = %c0 to %c8 step %c1 iter_time(%ti = %t + 1){
+    %tj_end = hir.for %j:i4 = %c0 to %c8 step %c1 iter_time(%tj = %ti + 1){
+      %i3 = comb.extract %i from 0 : (i4) -> (i3)
+      %j3 = comb.extract %j from 0 : (i4) -> (i3)
+      %v = hir.load %A[port 0][%i3, %j3] at %tj : !hir.memref<8x8xi32> delay 1
+      %j3_1 = hir.delay %j3 by 1 at %tj : i3
+      %i3_1 = hir.delay %i3 by 1 at %tj : i3
+      hir.store %v to %B[port 0][%j3_1, %i3_1] at %tj + 1
+        : !hir.memref<8x8xi32> delay 1
+      hir.next_iter at %tj + 1
+    }
+    hir.next_iter at %tj_end + 1
+  }
+  hir.return
+}
+
+// The inner loop is marked for unrolling, so the nest is left alone for
+// -hir-loop-unroll.
+// CHECK-LABEL: hir.func @unrolled_inner
+// CHECK: hir.for %{{.+}} : i4 = {{.*}} iter_time(
+// CHECK: hir.for %{{.+}} : i2 = {{.*}} iter_time(
+// CHECK: } {unroll}
+hir.func @unrolled_inner at %t(
+%A :!hir.memref<8x4xi32> ports [#rd],
+%B :!hir.memref<8x4xi32> ports [#wr]){
+  %c0 = hw.constant 0 : i4
+  %c1 = hw.constant 1 : i4
+  %c8 = hw.constant 8 : i4
+  %c0_i2 = hw.constant 0 : i2
+  %c1_i2 = hw.constant 1 : i2
+  %c3_i2 = hw.constant 3 : i2
+  %t_end = hir.for %i:i4 = %c0 to %c8 step %c1 iter_time(%ti = %t + 1){
+    %tj_end = hir.for %j:i2 = %c0_i2 to %c3_i2 step %c1_i2 iter_time(%tj = %ti + 1){
+      %i3 = comb.extract %i from 0 : (i4) -> (i3)
+      %v = hir.load %A[port 0][%i3, %j] at %tj : !hir.memref<8x4xi32> delay 1
+      %i3_1 = hir.delay %i3 by 1 at %tj : i3
+      %j_1 = hir.delay %j by 1 at %tj : i2
+      hir.store %v to %B[port 0][%i3_1, %j_1] at %tj + 1
+        : !hir.memref<8x4xi32> delay 1
+      hir.next_iter at %tj + 1
+    } {unroll}
+    hir.next_iter at %tj_end + 1
+  }
+  hir.return
+}
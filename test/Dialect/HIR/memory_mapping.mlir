@@ -0,0 +1,27 @@
+// RUN: circt-opt -hir-map-memory=report -verify-diagnostics %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+#lutram_r = {"rd_latency" = 0}
+
+// %small fits in a few LUTs, %large needs a block RAM and %comb must stay in
+// distributed RAM because it is read combinationally. Distributed RAM has one
+// write port, so %two_writes goes to a block RAM although it is small, and
+// nothing provides the ports of %no_fit, which keeps its memory kind.
+// CHECK-LABEL: hir.func @mapping
+hir.func @mapping at %t() {
+  // CHECK: hir.alloca lutram : !hir.memref<16xi8>
+  // expected-remark @+1 {{Mapped to lutram with 8 primitive(s) per bank, cost 8.}}
+  %small = hir.alloca "bram" : !hir.memref<16xi8> ports [#bram_r, #bram_w]
+  // CHECK: hir.alloca bram : !hir.memref<1024xi32>
+  // expected-remark @+1 {{Mapped to bram with 1 primitive(s) per bank, cost 60.}}
+  %large = hir.alloca "lutram" : !hir.memref<1024xi32> ports [#bram_r, #bram_w]
+  // CHECK: hir.alloca lutram : !hir.memref<1024xi32>
+  // expected-remark @+1 {{Mapped to lutram with 512 primitive(s) per bank, cost 512.}}
+  %comb = hir.alloca "lutram" : !hir.memref<1024xi32> ports [#lutram_r, #bram_w]
+  // CHECK: hir.alloca bram : !hir.memref<16xi8>
+  // expected-remark @+1 {{Mapped to bram with 1 primitive(s) per bank, cost 60.}}
+  %two_writes = hir.alloca "lutram" : !hir.memref<16xi8> ports [#bram_w, #bram_w]
+  // CHECK: hir.alloca lutram : !hir.memref<16xi8>
+  %no_fit = hir.alloca "lutram" : !hir.memref<16xi8> ports [#lutram_r, #bram_w, #bram_w]
+  hir.return
+}
@@ -0,0 +1,47 @@
+// RUN: circt-opt %s -split-input-file -hir-lower-memref | FileCheck %s
+#reg_rd = {rd_latency=0}
+#reg_wr = {wr_latency=1}
+
+// Only bank 3 of port 0 gets a memory interface. The other banks of port 0
+// have their enables tied to zero one by one, and the unused port 1 is
+// disabled with a single broadcast.
+// CHECK-LABEL: hir.func @test_banked_arg
+// CHECK-SAME: %[[RD_EN:[^ ]+]] : !hir.bus_tensor<64xi1> ports [send], %[[RD_DATA:[^ ]+]] : !hir.bus_tensor<64xi32> ports [recv], %[[WR_EN:[^ ]+]] : !hir.bus_tensor<64xi1> ports [send], %{{[^ ]+}} : !hir.bus_tensor<64xi32> ports [send]
+// CHECK: %[[ZERO:.+]] = hir.cast %{{.+}} : i1 -> !hir.bus<i1>
+// CHECK: %[[C3:.+]] = arith.constant 3 : index
+// CHECK-NEXT: %[[EN:.+]] = hir.bus : !hir.bus<i1>
+// CHECK-NEXT: hir.bus_tensor.assign_element %[[RD_EN]][%[[C3]]], %[[EN]] : !hir.bus_tensor<64xi1>, !hir.bus<i1>
+// CHECK-NEXT: %[[DATA:.+]] = hir.bus_tensor.get_element %[[RD_DATA]][%[[C3]]] : !hir.bus_tensor<64xi32> -> !hir.bus<i32>
+// CHECK-NOT: hir.bus_tensor.get_element
+// CHECK: hir.bus.recv %[[DATA]] at %{{.+}} : !hir.bus<i32> -> i32
+// CHECK-COUNT-63: hir.bus_tensor.assign_element %[[RD_EN]][%{{.+}}], %[[ZERO]]
+// CHECK-NOT: hir.bus_tensor.assign_element
+// CHECK: %[[OFF:.+]] = hir.bus.broadcast %[[ZERO]] : !hir.bus<i1> -> !hir.bus_tensor<64xi1>
+// CHECK-NEXT: hir.bus_tensor.assign %[[WR_EN]], %[[OFF]] : !hir.bus_tensor<64xi1>
+hir.func @test_banked_arg at %t(
+%a :!hir.memref<(bank 64)xi32> ports [#reg_rd,#reg_wr])->(%r:i32) {
+  %3 = arith.constant 3:index
+  %v = hir.load %a[port 0][%3] at %t: !hir.memref<(bank 64)xi32> delay 0
+  hir.return (%v) : (i32)
+}
+
+// -----
+
+#reg_rd = {rd_latency=0}
+#reg_wr = {wr_latency=1}
+
+// A register file with 1024 banks. The lowered function has one bus tensor
+// per port signal and builds the interface of the one bank that is read, so
+// its size grows with the number of accessed banks plus one tie-off per
+// unaccessed bank, not with banks times interface signals.
+// CHECK-LABEL: hir.func @test_1024_banks
+// CHECK-COUNT-1: hir.bus_tensor.get_element
+// CHECK-NOT: hir.bus_tensor.get_element
+// CHECK-COUNT-1: hir.bus.broadcast
+// CHECK-NOT: hir.bus.broadcast
+hir.func @test_1024_banks at %t(
+%a :!hir.memref<(bank 1024)xi8> ports [#reg_rd,#reg_wr])->(%r:i8) {
+  %1000 = arith.constant 1000:index
+  %v = hir.load %a[port 0][%1000] at %t: !hir.memref<(bank 1024)xi8> delay 0
+  hir.return (%v) : (i8)
+}
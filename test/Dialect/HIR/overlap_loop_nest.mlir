@@ -0,0 +1,78 @@
+// RUN: circt-opt -hir-overlap-loop-nest %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// Each row of %A is scaled into %B. The next row only waits for the inner
+// loop to finish issuing, not for the store of the last element and the
+// epilogue after it. The load after the nest is scheduled from its t_end, so
+// it can not overlap the nest.
+// CHECK-LABEL: hir.func @scale_rows
+// CHECK: hir.for %{{.+}} : i3 = {{.+}} iter_time( %[[TF:[^ ]+]] = %{{.+}} + 1)
+// CHECK: hir.for %{{.+}} : i5 = {{.+}} iter_args(
+// CHECK: hir.next_iter at %[[TF]] + 16
+// CHECK: %[[TEND:.+]] = hir.time %{{.+}} + 2
+// CHECK: hir.load %{{.+}}[port 0][%{{.+}}] at %[[TEND]] + 1
+hir.func @scale_rows at %t(
+  %A :!hir.memref<4x16xi32> ports [#bram_r],
+  %B :!hir.memref<4x16xi32> ports [#bram_w]) {
+  %c0_i2 = hw.constant 0:i2
+  %c0_i3 = hw.constant 0:i3
+  %c1_i3 = hw.constant 1:i3
+  %c4_i3 = hw.constant 4:i3
+  %c0_i4 = hw.constant 0:i4
+  %c0_i5 = hw.constant 0:i5
+  %c1_i5 = hw.constant 1:i5
+  %c16_i5 = hw.constant 16:i5
+
+  %t_end = hir.for %f : i3 = %c0_i3 to %c4_i3 step %c1_i3 iter_time(%tf = %t + 1){
+    %f2 = comb.extract %f from 0: (i3)->(i2)
+    %ti_end = hir.for %i : i5 = %c0_i5 to %c16_i5 step %c1_i5 iter_time(%ti = %tf){
+      %i4 = comb.extract %i from 0: (i5)->(i4)
+      %v = hir.load %A[port 0][%f2, %i4] at %ti : !hir.memref<4x16xi32> delay 1
+      %v2 = comb.add %v, %v : i32
+      %f2_1 = hir.delay %f2 by 1 at %ti : i2
+      %i4_1 = hir.delay %i4 by 1 at %ti : i4
+      hir.store %v2 to %B[port 0][%f2_1, %i4_1] at %ti + 1 : !hir.memref<4x16xi32> delay 1
+      hir.next_iter at %ti + 1
+    }
+    hir.next_iter at %ti_end + 2
+  }
+  %x = hir.load %A[port 0][%c0_i2, %c0_i4] at %t_end + 1 : !hir.memref<4x16xi32> delay 1
+  hir.return
+}
+
+// The load at %t + 35 uses the port of %A while the nest runs. It does not
+// conflict with the nest now, but it could once the outer iterations overlap,
+// so the nest is left alone.
+// CHECK-LABEL: hir.func @sibling_load
+// CHECK: hir.next_iter at %{{.+}} + 2
+// CHECK-NOT: hir.time
+// CHECK: hir.return
+hir.func @sibling_load at %t(
+  %A :!hir.memref<4x16xi32> ports [#bram_r],
+  %B :!hir.memref<4x16xi32> ports [#bram_w]) {
+  %c0_i2 = hw.constant 0:i2
+  %c0_i3 = hw.constant 0:i3
+  %c1_i3 = hw.constant 1:i3
+  %c4_i3 = hw.constant 4:i3
+  %c0_i4 = hw.constant 0:i4
+  %c0_i5 = hw.constant 0:i5
+  %c1_i5 = hw.constant 1:i5
+  %c16_i5 = hw.constant 16:i5
+
+  %t_end = hir.for %f : i3 = %c0_i3 to %c4_i3 step %c1_i3 iter_time(%tf = %t + 1){
+    %f2 = comb.extract %f from 0: (i3)->(i2)
+    %ti_end = hir.for %i : i5 = %c0_i5 to %c16_i5 step %c1_i5 iter_time(%ti = %tf){
+      %i4 = comb.extract %i from 0: (i5)->(i4)
+      %v = hir.load %A[port 0][%f2, %i4] at %ti : !hir.memref<4x16xi32> delay 1
+      %v2 = comb.add %v, %v : i32
+      %f2_1 = hir.delay %f2 by 1 at %ti : i2
+      %i4_1 = hir.delay %i4 by 1 at %ti : i4
+      hir.store %v2 to %B[port 0][%f2_1, %i4_1] at %ti + 1 : !hir.memref<4x16xi32> delay 1
+      hir.next_iter at %ti + 1
+    }
+    hir.next_iter at %ti_end + 2
+  }
+  %x = hir.load %A[port 0][%c0_i2, %c0_i4] at %t + 35 : !hir.memref<4x16xi32> delay 1
+  hir.return
+}
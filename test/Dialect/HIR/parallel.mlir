@@ -0,0 +1,57 @@
+// RUN: circt-opt -hir-simplify %s > %t.mt
+// RUN: circt-opt -hir-simplify --mlir-disable-threading %s > %t.st
+// RUN: diff %t.mt %t.st
+
+// Many functions with loops so that the per-function passes run on different
+// threads. The output must not depend on the order in which they run.
+
+hir.func @loop0 at %t()->(%out:i4){
+  %c0 = hw.constant 0   : i4
+  %c1 = hw.constant 1   : i4
+  %c15 = hw.constant 15 : i4
+  %x, %tf = hir.for %i:i4 = %c0 to %c15 step %c1 iter_args(%xi=%c0:i4) iter_time(%ti = %t+1){
+    %x1 = comb.add %xi, %c1 :i4
+    %xx = hir.delay %x1 by 1 at %ti : i4
+    hir.next_iter iter_args(%xx) at %ti+1 :(i4)
+  }
+  hir.return (%x) :(i4)
+}
+
+hir.func @loop1 at %t()->(%out:i4){
+  %c0 = hw.constant 0   : i4
+  %c1 = hw.constant 1   : i4
+  %c15 = hw.constant 15 : i4
+  %x, %tf = hir.for %i:i4 = %c0 to %c15 step %c1 iter_args(%xi=%c0:i4) iter_time(%ti = %t+1){
+    %x1 = comb.add %xi, %i :i4
+    %xx = hir.delay %x1 by 1 at %ti : i4
+    hir.next_iter iter_args(%xx) at %ti+1 :(i4)
+  }
+  hir.return (%x) :(i4)
+}
+
+hir.func @loop2 at %t()->(%out:i4){
+  %c0 = hw.constant 0   : i4
+  %c1 = hw.constant 1   : i4
+  %c7 = hw.constant 7 : i4
+  %x, %tf = hir.for %i:i4 = %c0 to %c7 step %c1 iter_args(%xi=%c0:i4) iter_time(%ti = %t+1){
+    %y, %tj_end = hir.for %j:i4 = %c0 to %c7 step %c1 iter_args(%yj=%xi:i4) iter_time(%tj = %ti+1){
+      %y1 = comb.add %yj, %j :i4
+      %yy = hir.delay %y1 by 1 at %tj : i4
+      hir.next_iter iter_args(%yy) at %tj+1 :(i4)
+    }
+    hir.next_iter iter_args(%y) at %tj_end+1 :(i4)
+  }
+  hir.return (%x) :(i4)
+}
+
+hir.func @loop3 at %t()->(%out:i4){
+  %c0 = hw.constant 0   : i4
+  %c2 = hw.constant 2   : i4
+  %c15 = hw.constant 15 : i4
+  %x, %tf = hir.for %i:i4 = %c0 to %c15 step %c2 iter_args(%xi=%c15:i4) iter_time(%ti = %t+1){
+    %x1 = comb.sub %xi, %i :i4
+    %xx = hir.delay %x1 by 1 at %ti : i4
+    hir.next_iter iter_args(%xx) at %ti+1 :(i4)
+  }
+  hir.return (%x) :(i4)
+}
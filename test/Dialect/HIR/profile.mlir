@@ -0,0 +1,33 @@
+// RUN: circt-opt -hir-instrument-profile %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// The loop gets a probe at its start and at the start of each iteration.
+// CHECK-LABEL: hir.func @count_until
+// CHECK: hir.probe {{.*}} name "count_until_while0_start"
+// CHECK: hir.while
+// CHECK-NEXT: hir.probe {{.*}} name "count_until_while0_iter"
+// CHECK-NOT: hir.probe
+hir.func @count_until at %t(
+  %A :!hir.memref<16xi32> ports [#bram_r],
+  %B :!hir.memref<16xi32> ports [#bram_w],
+  %key :i32) {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  %true = hw.constant 1:i1
+  %i_last, %t_end = hir.while %true iter_args(%i = %c0_i4 : i4) iter_time(%ti = %t + 1){
+    %v = hir.load %A[port 0][%i] at %ti : !hir.memref<16xi32> delay 1
+    %found = comb.icmp eq %v, %key : i32
+    %i_1 = hir.delay %i by 1 at %ti : i4
+    hir.if %found at time(%tf = %ti + 1) {
+      hir.store %v to %B[port 0][%i_1] at %tf : !hir.memref<16xi32> delay 1
+      hir.yield
+    } else {
+      hir.yield
+    }
+    %found_1 = hir.delay %found by 1 at %ti + 1 : i1
+    %i_next = comb.add %i, %c1_i4 : i4
+    hir.next_iter break %found_1 iter_args(%i_next) at %ti + 2 : (i4)
+  }
+  hir.return
+}
@@ -0,0 +1,43 @@
+// RUN: circt-opt -hir-scalar-replace %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// All accesses to %taps use constant indices, so it becomes four registers and
+// the two loads read from separate banks with a delay of one cycle.
+// CHECK-LABEL: hir.func @sum_taps
+// CHECK: %[[REG:.+]] = hir.alloca reg : !hir.memref<(bank 4)xi32> ports [{rd_latency = 0 : i64}, {wr_latency = 1 : i64}]
+// CHECK-NOT: hir.alloca
+// CHECK: hir.store %{{.+}} to %[[REG]][port 1][%{{.+}}] at %[[T:.+]] : !hir.memref<(bank 4)xi32> delay 1
+// CHECK: hir.store %{{.+}} to %[[REG]][port 1][%{{.+}}] at %[[T]] : !hir.memref<(bank 4)xi32> delay 1
+// CHECK: %[[X:.+]] = hir.load %[[REG]][port 0][%{{.+}}] at %[[T]] + 1 : !hir.memref<(bank 4)xi32> delay 0
+// CHECK-NEXT: %[[X1:.+]] = hir.delay %[[X]] by 1 at %[[T]] + 1 : i32
+// CHECK: %[[Y:.+]] = hir.load %[[REG]][port 0][%{{.+}}] at %[[T]] + 2 : !hir.memref<(bank 4)xi32> delay 0
+// CHECK-NEXT: %[[Y1:.+]] = hir.delay %[[Y]] by 1 at %[[T]] + 2 : i32
+// CHECK-NEXT: %[[X2:.+]] = hir.delay %[[X1]] by 1 at %[[T]] + 2 : i32
+// CHECK-NEXT: comb.add %[[X2]], %[[Y1]] : i32
+hir.func @sum_taps at %t(%a :i32, %b :i32) -> (%r :i32 delay 3) {
+  %c0_i2 = hw.constant 0:i2
+  %c3_i2 = hw.constant 3:i2
+  %taps = hir.alloca bram : !hir.memref<4xi32> ports [#bram_r, #bram_w]
+  hir.store %a to %taps[port 1][%c0_i2] at %t : !hir.memref<4xi32> delay 1
+  hir.store %b to %taps[port 1][%c3_i2] at %t : !hir.memref<4xi32> delay 1
+  %x = hir.load %taps[port 0][%c0_i2] at %t + 1 : !hir.memref<4xi32> delay 1
+  %y = hir.load %taps[port 0][%c3_i2] at %t + 2 : !hir.memref<4xi32> delay 1
+  %x_1 = hir.delay %x by 1 at %t + 2 : i32
+  %r = comb.add %x_1, %y : i32
+  hir.return (%r) : (i32)
+}
+
+// The store index is only known at run time, so %buf stays a memory.
+// CHECK-LABEL: hir.func @indexed
+// CHECK: hir.alloca bram : !hir.memref<4xi32>
+// CHECK-NOT: hir.alloca reg
+// CHECK: hir.load %{{.+}}[port 0][%{{.+}}] at %{{.+}} + 1 : !hir.memref<4xi32> delay 1
+// CHECK-NOT: hir.delay
+hir.func @indexed at %t(%a :i32, %i :i2) -> (%r :i32 delay 2) {
+  %c0_i2 = hw.constant 0:i2
+  %buf = hir.alloca bram : !hir.memref<4xi32> ports [#bram_r, #bram_w]
+  hir.store %a to %buf[port 1][%i] at %t : !hir.memref<4xi32> delay 1
+  %x = hir.load %buf[port 0][%c0_i2] at %t + 1 : !hir.memref<4xi32> delay 1
+  hir.return (%x) : (i32)
+}
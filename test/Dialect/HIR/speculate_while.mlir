@@ -0,0 +1,71 @@
+// RUN: circt-opt -hir-speculate-while -hir-verify-schedule %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// Elements of %A are copied to %B up to (and including) the first one that
+// matches %key. The match is known two cycles into the iteration, but the next
+// element is read every cycle. The copies of the elements after the match are
+// squashed.
+// CHECK-LABEL: hir.func @copy_until
+// CHECK: %[[FLAG:.+]] = hir.alloca reg
+// CHECK: hir.store %{{.+}} to %[[FLAG]][port 1]
+// CHECK: hir.while {{.+}} iter_time(%[[TI:[^ ]+]] = %{{.+}} + 1)
+// CHECK: %[[EXITED:.+]] = hir.load %[[FLAG]][port 0][%{{.+}}] at %[[TI]] + 2
+// CHECK: %[[LIVE:.+]] = comb.xor %[[EXITED]], %{{.+}} : i1
+// CHECK: %[[V:.+]] = hir.load %{{.+}}[port 0]
+// CHECK: %[[V1:.+]] = hir.delay %[[V]] by 1 at %[[TI]] + 1 : i32
+// CHECK: hir.if %[[LIVE]] at time(%[[TS:.+]] = %[[TI]] + 2)
+// CHECK-NEXT: hir.store %[[V1]] to %{{.+}}[port 0][%{{.+}}] at %[[TS]] :
+// CHECK: hir.if %[[LIVE]] at time(%[[TE:.+]] = %[[TI]] + 2)
+// CHECK-NEXT: hir.store %{{.+}} to %[[FLAG]][port 1][%{{.+}}] at %[[TE]] :
+// CHECK: %[[BREAK:.+]] = hir.load %[[FLAG]][port 0][%{{.+}}] at %[[TI]] + 1
+// CHECK: hir.next_iter break %[[BREAK]] iter_args(%{{.+}}) at %[[TI]] + 1
+// CHECK: squash_offset = 2
+hir.func @copy_until at %t(
+  %A :!hir.memref<16xi32> ports [#bram_r],
+  %B :!hir.memref<16xi32> ports [#bram_w],
+  %key :i32) {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  %true = hw.constant 1:i1
+  %i_last, %t_end = hir.while %true iter_args(%i = %c0_i4 : i4) iter_time(%ti = %t + 1){
+    %v = hir.load %A[port 0][%i] at %ti : !hir.memref<16xi32> delay 1
+    %found = comb.icmp eq %v, %key : i32
+    %found_1 = hir.delay %found by 1 at %ti + 1 : i1
+    %i_1 = hir.delay %i by 1 at %ti : i4
+    hir.store %v to %B[port 0][%i_1] at %ti + 1 : !hir.memref<16xi32> delay 1
+    %i_next = comb.add %i, %c1_i4 : i4
+    hir.next_iter break %found_1 iter_args(%i_next) at %ti + 2 : (i4)
+  }
+  hir.return
+}
+
+// The next iteration may read the bin that this iteration has not written yet,
+// so the loop is not speculated.
+// CHECK-LABEL: hir.func @histogram
+// CHECK-NOT: hir.if
+// CHECK: hir.next_iter break %{{.+}} at %{{.+}} + 3
+// CHECK-NOT: squash_offset
+hir.func @histogram at %t(
+  %A :!hir.memref<16xi32> ports [#bram_r],
+  %H :!hir.memref<16xi32> ports [#bram_r, #bram_w]) {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  %c15_i4 = hw.constant 15:i4
+  %c1_i32 = hw.constant 1:i32
+  %true = hw.constant 1:i1
+  %i_last, %t_end = hir.while %true iter_args(%i = %c0_i4 : i4) iter_time(%ti = %t + 1){
+    %v = hir.load %A[port 0][%i] at %ti : !hir.memref<16xi32> delay 1
+    %bin = comb.extract %v from 0 : (i32) -> (i4)
+    %n = hir.load %H[port 0][%bin] at %ti + 1 : !hir.memref<16xi32> delay 1
+    %n_1 = comb.add %n, %c1_i32 : i32
+    %bin_1 = hir.delay %bin by 1 at %ti + 1 : i4
+    hir.store %n_1 to %H[port 1][%bin_1] at %ti + 2 : !hir.memref<16xi32> delay 1
+    %last = comb.icmp eq %i, %c15_i4 : i4
+    %last_3 = hir.delay %last by 3 at %ti : i1
+    %i_next = comb.add %i, %c1_i4 : i4
+    %i_next_3 = hir.delay %i_next by 3 at %ti : i4
+    hir.next_iter break %last_3 iter_args(%i_next_3) at %ti + 3 : (i4)
+  }
+  hir.return
+}
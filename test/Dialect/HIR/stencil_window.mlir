@@ -0,0 +1,42 @@
+// RUN: circt-opt -hir-stencil-window %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// A 3-point stencil. After the pass only A[i+2] is read in the loop, A[i+1]
+// and A[i] come from a shift register that is filled before the loop.
+// CHECK-LABEL: hir.func @stencil_3pt
+// CHECK: %[[F0:.+]] = hir.load %[[A:[^ ]+]][port 2][%{{.+}}] at %[[T:[^ ]+]] + 1 :
+// CHECK: %[[R0:.+]] = hir.delay %[[F0]] by 2 at %[[T]] + 2 : i32
+// CHECK: %[[F1:.+]] = hir.load %[[A]][port 2][%{{.+}}] at %[[T]] + 2 :
+// CHECK: %[[R1:.+]] = hir.delay %[[F1]] by 1 at %[[T]] + 3 : i32
+// CHECK: hir.for %{{.+}} iter_args(%[[W0:[^=]+]]=%[[R0]]: {{.+}},%[[W1:[^=]+]]=%[[R1]]: {{.+}}) iter_time( %[[TI:[^ ]+]] = %[[T]] + 3)
+// CHECK: %[[V2:.+]] = hir.load %[[A]][port 2][%{{.+}}] at %[[TI]] :
+// CHECK-NOT: hir.load %[[A]]
+// CHECK: comb.add %[[W0]], %[[W1]], %[[V2]] : i32
+// CHECK: %[[N0:.+]] = hir.delay %[[W1]] by 1 at %[[TI]] + 1 : i32
+// CHECK: %[[N1:.+]] = hir.delay %[[V2]] by 1 at %[[TI]] + 1 : i32
+// CHECK: hir.next_iter iter_args(%[[N0]], %[[N1]]) at %[[TI]] + 1
+hir.func @stencil_3pt at %t(
+  %A :!hir.memref<64xi32> ports [#bram_r, #bram_r, #bram_r],
+  %B :!hir.memref<64xi32> ports [#bram_w]) {
+  %c0_i7 = hw.constant 0:i7
+  %c1_i6 = hw.constant 1:i6
+  %c2_i6 = hw.constant 2:i6
+  %c1_i7 = hw.constant 1:i7
+  %c62_i7 = hw.constant 62:i7
+
+  hir.for %i : i7 = %c0_i7 to %c62_i7 step %c1_i7 iter_time(%ti = %t + 1){
+    %i_i6 = comb.extract %i from 0: (i7)->(i6)
+    %i1 = comb.add %i_i6, %c1_i6 : i6
+    %i2 = comb.add %i_i6, %c2_i6 : i6
+    %v0 = hir.load %A[port 0][%i_i6] at %ti : !hir.memref<64xi32> delay 1
+    %v1 = hir.load %A[port 1][%i1] at %ti : !hir.memref<64xi32> delay 1
+    %v2 = hir.load %A[port 2][%i2] at %ti : !hir.memref<64xi32> delay 1
+    %s0 = comb.add %v0, %v1, %v2 : i32
+    %i_i6_1 = hir.delay %i_i6 by 1 at %ti : i6
+    hir.store %s0 to %B[port 0][%i_i6_1] at %ti + 1
+        : !hir.memref<64xi32> delay 1
+    hir.next_iter at %ti + 1
+  }
+  hir.return
+}
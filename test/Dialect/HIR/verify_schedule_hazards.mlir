@@ -0,0 +1,71 @@
+// RUN: circt-opt -hir-verify-schedule -split-input-file -verify-diagnostics %s
+#bram_r = {"rd_latency" = 1}
+
+hir.func @same_cycle at %t(%A :!hir.memref<16xi32> ports [#bram_r]) {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  // expected-note @+1 {{Conflicting access at cycle 0.}}
+  %x = hir.load %A[port 0][%c0_i4] at %t : !hir.memref<16xi32> delay 1
+  // expected-error @+1 {{Memory port conflict. Port 0 is used at cycle 0}}
+  %y = hir.load %A[port 0][%c1_i4] at %t : !hir.memref<16xi32> delay 1
+  hir.return
+}
+
+// -----
+#bram_r = {"rd_latency" = 1}
+
+// Cycles 0 and 2 of an iteration use the port together when the II is 2.
+hir.func @modulo_ii at %t(%A :!hir.memref<16xi32> ports [#bram_r]) {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  %c4_i4 = hw.constant 4:i4
+  %t_end = hir.for %i : i4 = %c0_i4 to %c4_i4 step %c1_i4 iter_time(%ti = %t + 1){
+    // expected-note @+1 {{Conflicting access at cycle 0.}}
+    %x = hir.load %A[port 0][%c0_i4] at %ti : !hir.memref<16xi32> delay 1
+    // expected-error @+1 {{Memory port conflict. Port 0 is used at cycle 2 (II = 2)}}
+    %y = hir.load %A[port 0][%c1_i4] at %ti + 2 : !hir.memref<16xi32> delay 1
+    hir.next_iter at %ti + 2
+  }
+  hir.return
+}
+
+// -----
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// The next iteration reads %acc before this iteration's store completes.
+hir.func @raw at %t() {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  %c4_i4 = hw.constant 4:i4
+  %acc = hir.alloca bram : !hir.memref<16xi32> ports [#bram_r, #bram_w]
+  %t_end = hir.for %i : i4 = %c0_i4 to %c4_i4 step %c1_i4 iter_time(%ti = %t + 1){
+    // expected-error @+1 {{Read-after-write hazard across loop iterations. The next iteration reads at cycle 1}}
+    %v = hir.load %acc[port 0][%c0_i4] at %ti : !hir.memref<16xi32> delay 1
+    // expected-note @+1 {{Store at cycle 1 completes at cycle 2 (II = 1).}}
+    hir.store %v to %acc[port 1][%c0_i4] at %ti + 1 : !hir.memref<16xi32> delay 1
+    hir.next_iter at %ti + 1
+  }
+  hir.return
+}
+
+// -----
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// The next iteration overwrites %buf before this iteration reads it.
+hir.func @war at %t() {
+  %c0_i4 = hw.constant 0:i4
+  %c1_i4 = hw.constant 1:i4
+  %c4_i4 = hw.constant 4:i4
+  %c0_i32 = hw.constant 0:i32
+  %buf = hir.alloca bram : !hir.memref<16xi32> ports [#bram_r, #bram_w]
+  %t_end = hir.for %i : i4 = %c0_i4 to %c4_i4 step %c1_i4 iter_time(%ti = %t + 1){
+    // expected-error @+1 {{Write-after-read hazard across loop iterations. The next iteration writes at cycle 2}}
+    hir.store %c0_i32 to %buf[port 1][%c0_i4] at %ti : !hir.memref<16xi32> delay 1
+    // expected-note @+1 {{Load at cycle 3 (II = 2).}}
+    %v = hir.load %buf[port 0][%c0_i4] at %ti + 3 : !hir.memref<16xi32> delay 1
+    hir.next_iter at %ti + 2
+  }
+  hir.return
+}
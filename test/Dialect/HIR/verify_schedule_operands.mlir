@@ -0,0 +1,23 @@
+// RUN: circt-opt -hir-verify-schedule -split-input-file -verify-diagnostics %s
+// RUN: not circt-opt -hir-verify-schedule %s -o /dev/null
+
+// The operands of a comb op must be valid in the same cycle.
+hir.func @comb_operands at %t(%a :i32, %b :i32) {
+  %a1 = hir.delay %a by 1 at %t : i32
+  // expected-note @+1 {{Operand defined here.}}
+  %b2 = hir.delay %b by 2 at %t : i32
+  // expected-error @+1 {{Error in scheduling of operand.}}
+  %s = comb.add %a1, %b2 : i32
+  hir.return
+}
+
+// -----
+
+// The operand of a scheduled op must be valid at its start time.
+hir.func @scheduled_operand at %t(%a :i32) {
+  // expected-note @+1 {{Operand defined here.}}
+  %a1 = hir.delay %a by 1 at %t : i32
+  // expected-error @+1 {{Error in scheduling of operand.}}
+  %a2 = hir.delay %a1 by 1 at %t + 2 : i32
+  hir.return
+}
@@ -0,0 +1,85 @@
+// RUN: circt-opt -hir-verify-schedule -hir-widen-memref -hir-verify-schedule %s | FileCheck %s
+#bram_r = {"rd_latency" = 1}
+#bram_w = {"wr_latency" = 1}
+
+// All four banks of %buf are written and read in the same cycle. After the
+// pass the bank dimension is gone and %buf is a 16 x i128 memory with one
+// access per cycle and port.
+// CHECK-LABEL: hir.func @vec4_sum
+hir.func @vec4_sum at %t(
+  %x0 :i32, %x1 :i32, %x2 :i32, %x3 :i32,
+  %B :!hir.memref<16xi32> ports [#bram_w]) {
+  %c0_i5 = hw.constant 0:i5
+  %c1_i5 = hw.constant 1:i5
+  %c16_i5 = hw.constant 16:i5
+  %0 = arith.constant 0:index
+  %1 = arith.constant 1:index
+  %2 = arith.constant 2:index
+  %3 = arith.constant 3:index
+  // CHECK: %[[BUF:.+]] = hir.alloca {{.*}}!hir.memref<16xi128>
+  // CHECK-NOT: hir.alloca
+  %buf = hir.alloca bram : !hir.memref<(bank 4)x16xi32> ports [#bram_r, #bram_w]
+
+  // CHECK: hir.for {{.*}} iter_time( %[[TI:.+]] = %{{.+}} + 1)
+  hir.for %i : i5 = %c0_i5 to %c16_i5 step %c1_i5 iter_time(%ti = %t + 1){
+    %a = comb.extract %i from 0: (i5)->(i4)
+    // CHECK: %[[W:.+]] = comb.concat %{{.+}}, %{{.+}}, %{{.+}}, %{{.+}} : i32, i32, i32, i32
+    // CHECK-NEXT: hir.store %[[W]] to %[[BUF]][port 1][%{{.+}}] at %[[TI]] : !hir.memref<16xi128> delay 1
+    // CHECK-NOT: hir.store {{.*}} to %[[BUF]]
+    hir.store %x0 to %buf[port 1][%0, %a] at %ti : !hir.memref<(bank 4)x16xi32> delay 1
+    hir.store %x1 to %buf[port 1][%1, %a] at %ti : !hir.memref<(bank 4)x16xi32> delay 1
+    hir.store %x2 to %buf[port 1][%2, %a] at %ti : !hir.memref<(bank 4)x16xi32> delay 1
+    hir.store %x3 to %buf[port 1][%3, %a] at %ti : !hir.memref<(bank 4)x16xi32> delay 1
+    %a1 = hir.delay %a by 1 at %ti : i4
+    // CHECK: %[[R:.+]] = hir.load %[[BUF]][port 0][%{{.+}}] at %[[TI]] + 1 : !hir.memref<16xi128> delay 1
+    // CHECK-NOT: hir.load {{.*}}%[[BUF]]
+    // CHECK-DAG: comb.extract %[[R]] from 0 :
+    // CHECK-DAG: comb.extract %[[R]] from 32 :
+    // CHECK-DAG: comb.extract %[[R]] from 64 :
+    // CHECK-DAG: comb.extract %[[R]] from 96 :
+    %v0 = hir.load %buf[port 0][%0, %a1] at %ti + 1 : !hir.memref<(bank 4)x16xi32> delay 1
+    %v1 = hir.load %buf[port 0][%1, %a1] at %ti + 1 : !hir.memref<(bank 4)x16xi32> delay 1
+    %v2 = hir.load %buf[port 0][%2, %a1] at %ti + 1 : !hir.memref<(bank 4)x16xi32> delay 1
+    %v3 = hir.load %buf[port 0][%3, %a1] at %ti + 1 : !hir.memref<(bank 4)x16xi32> delay 1
+    %s = comb.add %v0, %v1, %v2, %v3 : i32
+    %a2 = hir.delay %a by 2 at %ti : i4
+    hir.store %s to %B[port 0][%a2] at %ti + 2 : !hir.memref<16xi32> delay 1
+    hir.next_iter at %ti + 1
+  }
+  hir.return
+}
+
+// Two contiguous elements are written through ports 2 and 3 and read through
+// ports 0 and 1, all in the same cycle. They are packed into one i64 word that
+// is accessed through the port of the first element.
+// CHECK-LABEL: hir.func @pair_copy
+hir.func @pair_copy at %t(
+  %x :i32, %y :i32,
+  %B :!hir.memref<64xi32> ports [#bram_w]) {
+  %c0_i7 = hw.constant 0:i7
+  %c1_i6 = hw.constant 1:i6
+  %c2_i7 = hw.constant 2:i7
+  %c64_i7 = hw.constant 64:i7
+  // CHECK: %[[BUF:.+]] = hir.alloca {{.*}}!hir.memref<32xi64>
+  %buf = hir.alloca bram : !hir.memref<64xi32> ports [#bram_r, #bram_r, #bram_w, #bram_w]
+
+  // CHECK: hir.for %[[I:.+]] : i7 = {{.*}} iter_time( %[[TI:.+]] = %{{.+}} + 1)
+  hir.for %i : i7 = %c0_i7 to %c64_i7 step %c2_i7 iter_time(%ti = %t + 1){
+    %i0 = comb.extract %i from 0: (i7)->(i6)
+    %i1 = comb.add %i0, %c1_i6 : i6
+    // CHECK: %[[WI:.+]] = comb.extract %[[I]] from 1 : (i7) -> i5
+    // CHECK-NEXT: %[[W:.+]] = comb.concat
+    // CHECK-NEXT: hir.store %[[W]] to %[[BUF]][port 2][%[[WI]]] at %[[TI]] : !hir.memref<32xi64> delay 1
+    hir.store %x to %buf[port 2][%i0] at %ti : !hir.memref<64xi32> delay 1
+    hir.store %y to %buf[port 3][%i1] at %ti : !hir.memref<64xi32> delay 1
+    // CHECK: %[[R:.+]] = hir.load %[[BUF]][port 0][%{{.+}}] at %[[TI]] : !hir.memref<32xi64> delay 1
+    // CHECK-NOT: hir.load {{.*}}%[[BUF]]
+    %v0 = hir.load %buf[port 0][%i0] at %ti : !hir.memref<64xi32> delay 1
+    %v1 = hir.load %buf[port 1][%i1] at %ti : !hir.memref<64xi32> delay 1
+    %s = comb.add %v0, %v1 : i32
+    %j0 = hir.delay %i0 by 1 at %ti : i6
+    hir.store %s to %B[port 0][%j0] at %ti + 1 : !hir.memref<64xi32> delay 1
+    hir.next_iter at %ti + 1
+  }
+  hir.return
+}
@@ -0,0 +1,86 @@
+// RUN: circt-opt -hw-dedup %s | FileCheck %s
+
+// CHECK-LABEL: hw.module private @Add0
+// CHECK-NOT: hw.module private @Add1
+hw.module private @Add0(%a: i8, %b: i8) -> (out: i8) {
+  %0 = comb.add %a, %b : i8
+  hw.output %0 : i8
+}
+hw.module private @Add1(%a: i8, %b: i8) -> (out: i8) {
+  %0 = comb.add %a, %b : i8
+  hw.output %0 : i8
+}
+
+// The ports are the same but the body is not.
+// CHECK-LABEL: hw.module private @Sub
+hw.module private @Sub(%a: i8, %b: i8) -> (out: i8) {
+  %0 = comb.sub %a, %b : i8
+  hw.output %0 : i8
+}
+
+// The wrappers only become identical once Add1 is replaced by Add0.
+// CHECK-LABEL: hw.module private @Wrap0
+// CHECK-NOT: hw.module private @Wrap1
+hw.module private @Wrap0(%a: i8) -> (out: i8) {
+  %0 = hw.instance "add" @Add0(a: %a: i8, b: %a: i8) -> (out: i8)
+  hw.output %0 : i8
+}
+hw.module private @Wrap1(%a: i8) -> (out: i8) {
+  %0 = hw.instance "add" @Add1(a: %a: i8, b: %a: i8) -> (out: i8)
+  hw.output %0 : i8
+}
+
+// Graph regions may use a value before its definition.
+// CHECK-LABEL: hw.module private @Fwd0
+// CHECK-NOT: hw.module private @Fwd1
+hw.module private @Fwd0(%a: i8) -> (out: i8) {
+  %1 = comb.add %0, %a : i8
+  %0 = comb.xor %a, %a : i8
+  hw.output %1 : i8
+}
+hw.module private @Fwd1(%a: i8) -> (out: i8) {
+  %1 = comb.add %0, %a : i8
+  %0 = comb.xor %a, %a : i8
+  hw.output %1 : i8
+}
+
+// Extern decls of the same verilog module, as emitted for each
+// hir.func.extern, are merged.
+// CHECK: hw.module.extern @mult0
+// CHECK-NOT: hw.module.extern @mult1
+hw.module.extern @mult0(%a: i8, %b: i8) -> (out: i8)
+  attributes {verilogName = "mult"}
+hw.module.extern @mult1(%a: i8, %b: i8) -> (out: i8)
+  attributes {verilogName = "mult"}
+
+// Extern modules with the same ports that name different verilog modules are
+// kept.
+// CHECK: hw.module.extern @fadd
+// CHECK: hw.module.extern @fmul
+hw.module.extern @fadd(%a: i8, %b: i8) -> (out: i8)
+hw.module.extern @fmul(%a: i8, %b: i8) -> (out: i8)
+
+// CHECK-LABEL: hw.module @Top
+// CHECK: hw.instance "w0" @Wrap0
+// CHECK: hw.instance "w1" @Wrap0
+// CHECK: hw.instance "s" @Sub
+// CHECK: hw.instance "f0" @Fwd0
+// CHECK: hw.instance "f1" @Fwd0
+// CHECK: hw.instance "m0" @mult0
+// CHECK: hw.instance "m1" @mult0
+// CHECK: hw.instance "fa" @fadd
+// CHECK: hw.instance "fm" @fmul
+hw.module @Top(%a: i8) -> (x: i8, y: i8, z: i8, u: i8, v: i8, p: i8, q: i8,
+                           r: i8, s: i8) {
+  %0 = hw.instance "w0" @Wrap0(a: %a: i8) -> (out: i8)
+  %1 = hw.instance "w1" @Wrap1(a: %a: i8) -> (out: i8)
+  %2 = hw.instance "s" @Sub(a: %a: i8, b: %a: i8) -> (out: i8)
+  %3 = hw.instance "f0" @Fwd0(a: %a: i8) -> (out: i8)
+  %4 = hw.instance "f1" @Fwd1(a: %a: i8) -> (out: i8)
+  %5 = hw.instance "m0" @mult0(a: %a: i8, b: %a: i8) -> (out: i8)
+  %6 = hw.instance "m1" @mult1(a: %a: i8, b: %a: i8) -> (out: i8)
+  %7 = hw.instance "fa" @fadd(a: %a: i8, b: %a: i8) -> (out: i8)
+  %8 = hw.instance "fm" @fmul(a: %a: i8, b: %a: i8) -> (out: i8)
+  hw.output %0, %1, %2, %3, %4, %5, %6, %7, %8
+    : i8, i8, i8, i8, i8, i8, i8, i8, i8
+}
@@ -0,0 +1,135 @@
+// RUN: circt-opt -hw-register-fanout="max-fanout=2 retime=false" %s | FileCheck %s --check-prefix=FANOUT
+// RUN: circt-opt -hw-register-fanout %s | FileCheck %s --check-prefix=RETIME
+
+// The five uses of %r are split between %r and two copies of it.
+// FANOUT-LABEL: hw.module @fanout
+// FANOUT-DAG: %r = sv.reg : !hw.inout<i8>
+// FANOUT-DAG: %r_dup1 = sv.reg : !hw.inout<i8>
+// FANOUT-DAG: %r_dup2 = sv.reg : !hw.inout<i8>
+// FANOUT-DAG: sv.passign %r_dup1, %a : i8
+// FANOUT-DAG: sv.passign %r_dup2, %a : i8
+// FANOUT-NOT: %r_dup3
+hw.module @fanout(%clk: i1, %rst: i1, %a: i8) -> (o1: i8, o2: i8, o3: i8, o4: i8, o5: i8) {
+  %c0_i8 = hw.constant 0 : i8
+  %r = sv.reg : !hw.inout<i8>
+  sv.alwaysff(posedge %clk) {
+    sv.passign %r, %a : i8
+  }(syncreset : posedge %rst) {
+    sv.passign %r, %c0_i8 : i8
+  }
+  %q = sv.read_inout %r : !hw.inout<i8>
+  %0 = comb.xor %q, %a : i8
+  %1 = comb.and %q, %a : i8
+  %2 = comb.or %q, %a : i8
+  %3 = comb.add %q, %a : i8
+  %4 = comb.sub %q, %a : i8
+  hw.output %0, %1, %2, %3, %4 : i8, i8, i8, i8, i8
+}
+
+// The copies of an enabled register keep the enable.
+// FANOUT-LABEL: hw.module @enable
+// FANOUT: %r_dup1 = sv.reg : !hw.inout<i8>
+// FANOUT: sv.alwaysff(posedge %clk)
+// FANOUT-NEXT: sv.if %en {
+// FANOUT-NEXT: sv.passign %r_dup1, %a : i8
+// FANOUT-NOT: %r_dup2
+hw.module @enable(%clk: i1, %en: i1, %a: i8) -> (o1: i8, o2: i8, o3: i8) {
+  %r = sv.reg : !hw.inout<i8>
+  sv.alwaysff(posedge %clk) {
+    sv.if %en {
+      sv.passign %r, %a : i8
+    }
+  }
+  %q = sv.read_inout %r : !hw.inout<i8>
+  %0 = comb.xor %q, %a : i8
+  %1 = comb.and %q, %a : i8
+  %2 = comb.or %q, %a : i8
+  hw.output %0, %1, %2 : i8, i8, i8
+}
+
+// The loop counter registers of SimplifyCtrl share an enable and a reset.
+// FANOUT-LABEL: hw.module @counter
+// FANOUT: %done_reg_dup1 = sv.reg : !hw.inout<i1>
+// FANOUT: sv.alwaysff(posedge %clk)
+// FANOUT-NEXT: sv.if %en {
+// FANOUT-NEXT: sv.passign %done_reg_dup1, %d : i1
+// FANOUT: }(syncreset : posedge %rst) {
+// FANOUT-NEXT: sv.passign %done_reg_dup1, %{{.+}} : i1
+// FANOUT-NOT: %iv_reg_dup
+hw.module @counter(%clk: i1, %rst: i1, %en: i1, %iv: i8, %d: i1)
+    -> (o1: i1, o2: i1, o3: i1, o4: i8) {
+  %false = hw.constant false
+  %x = sv.constantX : i8
+  %iv_reg = sv.reg : !hw.inout<i8>
+  %done_reg = sv.reg : !hw.inout<i1>
+  sv.alwaysff(posedge %clk) {
+    sv.if %en {
+      sv.passign %iv_reg, %iv : i8
+      sv.passign %done_reg, %d : i1
+    }
+  }(syncreset : posedge %rst) {
+    sv.passign %iv_reg, %x : i8
+    sv.passign %done_reg, %false : i1
+  }
+  %q = sv.read_inout %iv_reg : !hw.inout<i8>
+  %done = sv.read_inout %done_reg : !hw.inout<i1>
+  %0 = comb.xor %done, %en : i1
+  %1 = comb.and %done, %en : i1
+  %2 = comb.or %done, %en : i1
+  hw.output %0, %1, %2, %q : i1, i1, i1, i8
+}
+
+// An assignment under an sv.if with an else, or under an sv.if in the reset
+// block, is not matched.
+// FANOUT-LABEL: hw.module @not_simple
+// FANOUT-NOT: _dup
+hw.module @not_simple(%clk: i1, %rst: i1, %en: i1, %a: i8, %b: i8)
+    -> (o1: i8, o2: i8, o3: i8, o4: i8, o5: i8, o6: i8) {
+  %c0_i8 = hw.constant 0 : i8
+  %r1 = sv.reg : !hw.inout<i8>
+  %r2 = sv.reg : !hw.inout<i8>
+  sv.alwaysff(posedge %clk) {
+    sv.if %en {
+      sv.passign %r1, %a : i8
+    } else {
+      sv.passign %r1, %b : i8
+    }
+  }
+  sv.alwaysff(posedge %clk) {
+    sv.passign %r2, %a : i8
+  }(syncreset : posedge %rst) {
+    sv.if %en {
+      sv.passign %r2, %c0_i8 : i8
+    }
+  }
+  %q1 = sv.read_inout %r1 : !hw.inout<i8>
+  %q2 = sv.read_inout %r2 : !hw.inout<i8>
+  %0 = comb.xor %q1, %a : i8
+  %1 = comb.and %q1, %a : i8
+  %2 = comb.or %q1, %a : i8
+  %3 = comb.xor %q2, %a : i8
+  %4 = comb.and %q2, %a : i8
+  %5 = comb.or %q2, %a : i8
+  hw.output %0, %1, %2, %3, %4, %5 : i8, i8, i8, i8, i8, i8
+}
+
+// The register is moved before the last add, so that the adds are split
+// between the two stages.
+// RETIME-LABEL: hw.module @retime_backward
+// RETIME-DAG: %r_rt0 = sv.reg : !hw.inout<i8>
+// RETIME-DAG: %r_rt1 = sv.reg : !hw.inout<i8>
+// RETIME-DAG: [[Q0:%.+]] = sv.read_inout %r_rt0
+// RETIME-DAG: [[Q1:%.+]] = sv.read_inout %r_rt1
+// RETIME-DAG: [[SUM:%.+]] = comb.add [[Q0]], [[Q1]] : i8
+// RETIME: hw.output [[SUM]] : i8
+hw.module @retime_backward(%clk: i1, %a: i8, %b: i8, %c: i8, %d: i8) -> (out: i8) {
+  %0 = comb.add %a, %b : i8
+  %1 = comb.add %0, %c : i8
+  %2 = comb.add %1, %d : i8
+  %r = sv.reg : !hw.inout<i8>
+  sv.alwaysff(posedge %clk) {
+    sv.passign %r, %2 : i8
+  }
+  %q = sv.read_inout %r : !hw.inout<i8>
+  hw.output %q : i8
+}
@@ -0,0 +1,28 @@
+// REQUIRES: or-tools
+// RUN: hirtool %s -dse-space=%S/Inputs/dse_space.json -dse-function=copy -dse-jobs=1 | FileCheck %s
+
+// Both configurations compile. The front is sorted by latency, so the
+// configuration with the lowest II comes first.
+// CHECK: "candidates": 2,
+// CHECK: "failed": 0,
+// CHECK: "pareto": [
+// CHECK-NEXT: {
+// CHECK-NEXT: "config": {
+// CHECK-NEXT: "loop0.ii": 1
+// CHECK-NEXT: },
+// CHECK-NEXT: "latency": {{[0-9]+}},
+// CHECK: "failures": []
+func.func @copy(
+    %A: memref<8xi32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64},
+    %B: memref<8xi32> {hls.INTERFACE_STORAGE_TYPE = "ram_2p",
+                       hls.INTERFACE_RD_LATENCY = 1 : i64,
+                       hls.INTERFACE_WR_LATENCY = 1 : i64})
+    attributes {argNames = ["A", "B"]} {
+  affine.for %i = 0 to 8 {
+    %a = affine.load %A[%i] : memref<8xi32>
+    affine.store %a, %B[%i] : memref<8xi32>
+  }
+  return
+}
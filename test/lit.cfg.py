@@ -57,7 +57,7 @@ tool_dirs = [
 ]
 tools = [
     'firtool', 'handshake-runner', 'circt-opt', 'circt-reduce',
-    'circt-translate', 'circt-capi-ir-test', 'esi-tester'
+    'circt-translate', 'circt-capi-ir-test', 'esi-tester', 'hirtool'
 ]
 
 # Enable Verilator if it has been detected.
@@ -0,0 +1,527 @@
+//===- DesignSpaceExploration.cpp - Pragma search in hirtool --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the design-space exploration mode of hirtool. Every
+// configuration of the search space is compiled in its own MLIRContext, on a
+// thread pool. A candidate is first lowered through hir-pragma, affine-to-hir
+// and hir-opt, where its latency and resources are estimated on the structured
+// HIR. Candidates that are dominated by an already compiled one are dropped
+// at this point, the rest are lowered through hir-simplify.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DesignSpaceExploration.h"
+#include "circt/Dialect/Comb/CombDialect.h"
+#include "circt/Dialect/HIR/IR/HIR.h"
+#include "circt/Dialect/HIR/IR/helper.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Affine/LoopUtils.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include <limits>
+#include <mutex>
+#include <vector>
+
+using namespace mlir;
+using namespace circt;
+
+namespace {
+/// A pragma that is varied during the exploration.
+struct Knob {
+  enum Kind { II, Unroll, Partition };
+  Kind kind;
+  /// Pre-order number of the affine.for (or memref.alloca) in the top level
+  /// function.
+  size_t index;
+  SmallVector<int64_t> values;
+
+  std::string getName() const {
+    switch (kind) {
+    case II:
+      return "loop" + std::to_string(index) + ".ii";
+    case Unroll:
+      return "loop" + std::to_string(index) + ".unroll";
+    case Partition:
+      return "alloca" + std::to_string(index) + ".partition";
+    }
+    llvm_unreachable("Unknown knob.");
+  }
+};
+
+/// Estimated cost of a candidate. The latency is unknown if the schedule is
+/// not static.
+struct Estimate {
+  Optional<int64_t> latency;
+  int64_t combBits = 0;
+  int64_t regBits = 0;
+  int64_t memBits = 0;
+  int64_t instances = 0;
+
+  SmallVector<int64_t> getCosts() const {
+    return {latency.value_or(std::numeric_limits<int64_t>::max()), combBits,
+            regBits, memBits, instances};
+  }
+
+  bool dominates(const Estimate &other) const {
+    auto costs = getCosts();
+    auto otherCosts = other.getCosts();
+    for (size_t i = 0; i < costs.size(); i++)
+      if (costs[i] > otherCosts[i])
+        return false;
+    return costs != otherCosts;
+  }
+};
+
+struct Candidate {
+  enum Status { Pending, Compiled, Pruned, Failed };
+  SmallVector<int64_t> config;
+  Estimate estimate;
+  Status status = Pending;
+  std::string error;
+};
+
+class DesignSpaceExplorer {
+public:
+  DesignSpaceExplorer(StringRef input, const hir::DSEOptions &options,
+                      const DialectRegistry &registry, ArrayRef<Knob> knobs)
+      : input(input), options(options), registry(registry),
+        knobs(knobs.begin(), knobs.end()) {}
+  void run();
+  void printResults(raw_ostream &os);
+
+private:
+  void compile(Candidate &);
+  bool isDominated(const Estimate &);
+  void addToFront(Candidate &);
+  std::string getSchedulePipeline();
+
+private:
+  StringRef input;
+  const hir::DSEOptions &options;
+  const DialectRegistry &registry;
+  SmallVector<Knob> knobs;
+  std::vector<Candidate> candidates;
+  std::mutex frontMutex;
+  SmallVector<Candidate *> front;
+};
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Search space.
+//-----------------------------------------------------------------------------
+
+static LogicalResult parseKnob(const llvm::json::Object &entry, StringRef key,
+                               Knob::Kind kind, size_t index,
+                               SmallVectorImpl<Knob> &knobs) {
+  auto *values = entry.getArray(key);
+  if (!values)
+    return success();
+  Knob knob{kind, index, {}};
+  for (auto &value : *values) {
+    if (kind == Knob::Partition) {
+      auto partition = value.getAsBoolean();
+      if (!partition)
+        return llvm::errs() << "Expected booleans in \"" << key << "\".\n",
+               failure();
+      knob.values.push_back(*partition);
+      continue;
+    }
+    auto factor = value.getAsInteger();
+    if (!factor || *factor <= 0)
+      return llvm::errs() << "Expected positive integers in \"" << key
+                          << "\".\n",
+             failure();
+    knob.values.push_back(*factor);
+  }
+  if (knob.values.empty())
+    return llvm::errs() << "Empty list of values for \"" << key << "\".\n",
+           failure();
+  knobs.push_back(knob);
+  return success();
+}
+
+static LogicalResult parseSearchSpace(StringRef searchSpace,
+                                      SmallVectorImpl<Knob> &knobs) {
+  auto json = llvm::json::parse(searchSpace);
+  if (!json)
+    return llvm::errs() << "Could not parse the search space: "
+                        << llvm::toString(json.takeError()) << "\n",
+           failure();
+  auto *root = json->getAsObject();
+  if (!root)
+    return llvm::errs() << "Expected a json object as the search space.\n",
+           failure();
+
+  if (auto *loops = root->getArray("loops")) {
+    for (auto &entry : *loops) {
+      auto *obj = entry.getAsObject();
+      auto index = obj ? obj->getInteger("loop") : llvm::None;
+      if (!index || *index < 0)
+        return llvm::errs() << "Loop entries need a \"loop\" number.\n",
+               failure();
+      if (failed(parseKnob(*obj, "ii", Knob::II, *index, knobs)) ||
+          failed(parseKnob(*obj, "unroll", Knob::Unroll, *index, knobs)))
+        return failure();
+    }
+  }
+  if (auto *memrefs = root->getArray("memrefs")) {
+    for (auto &entry : *memrefs) {
+      auto *obj = entry.getAsObject();
+      auto index = obj ? obj->getInteger("alloca") : llvm::None;
+      if (!index || *index < 0)
+        return llvm::errs() << "Memref entries need an \"alloca\" number.\n",
+               failure();
+      if (failed(parseKnob(*obj, "partition", Knob::Partition, *index, knobs)))
+        return failure();
+    }
+  }
+  return success();
+}
+
+/// Set the hls pragmas of the top level function (as read by -hir-pragma) to
+/// the values of the configuration. Unroll factors are applied directly on the
+/// affine loops.
+static LogicalResult applyConfig(ModuleOp moduleOp, ArrayRef<Knob> knobs,
+                                 ArrayRef<int64_t> config, StringRef funcName) {
+  auto funcOp = moduleOp.lookupSymbol<func::FuncOp>(funcName);
+  if (!funcOp)
+    return moduleOp.emitError("Could not find function ") << funcName << ".";
+  SmallVector<AffineForOp> loops;
+  SmallVector<memref::AllocaOp> allocas;
+  funcOp.walk<WalkOrder::PreOrder>([&](Operation *operation) {
+    if (auto forOp = dyn_cast<AffineForOp>(operation))
+      loops.push_back(forOp);
+    else if (auto allocaOp = dyn_cast<memref::AllocaOp>(operation))
+      allocas.push_back(allocaOp);
+  });
+
+  Builder builder(moduleOp.getContext());
+  SmallVector<int64_t> unrollFactors(loops.size(), 1);
+  for (size_t i = 0; i < knobs.size(); i++) {
+    auto &knob = knobs[i];
+    size_t const numOps =
+        knob.kind == Knob::Partition ? allocas.size() : loops.size();
+    if (knob.index >= numOps)
+      return funcOp.emitError("Search space refers to a missing op: ")
+             << knob.getName();
+    switch (knob.kind) {
+    case Knob::II:
+      loops[knob.index]->setAttr("hls.PIPELINE_II",
+                                 builder.getI64IntegerAttr(config[i]));
+      break;
+    case Knob::Unroll:
+      unrollFactors[knob.index] = config[i];
+      break;
+    case Knob::Partition:
+      // Partitioning dim 0 completely turns the memref into registers.
+      if (config[i])
+        allocas[knob.index]->setAttr("hls.ARRAY_PARTITION_DIM",
+                                     builder.getI64IntegerAttr(0));
+      else
+        allocas[knob.index]->removeAttr("hls.ARRAY_PARTITION_DIM");
+      break;
+    }
+  }
+
+  // Inner loops come later in pre-order. They are unrolled first, so that the
+  // handles of the outer loops stay valid.
+  for (size_t i = loops.size(); i-- > 0;)
+    if (unrollFactors[i] > 1 &&
+        failed(loopUnrollByFactor(loops[i], unrollFactors[i])))
+      return loops[i].emitError("Could not unroll by ") << unrollFactors[i];
+  return success();
+}
+
+//-----------------------------------------------------------------------------
+// Estimates.
+//-----------------------------------------------------------------------------
+
+/// Cycles (from the start time var of the block) until all the ops of the
+/// block are done. The times of the time vars defined in the block are added
+/// to timeOffsets. Returns None if some op is not statically scheduled.
+static Optional<int64_t>
+estimateLatency(Block &block, llvm::DenseMap<Value, int64_t> &timeOffsets) {
+  int64_t latency = 0;
+  for (auto &operation : block) {
+    auto scheduledOp = dyn_cast<hir::ScheduledOp>(operation);
+    if (!scheduledOp)
+      continue;
+    auto startTime = scheduledOp.getStartTime();
+    auto startIter = timeOffsets.find(startTime.getTimeVar());
+    if (startIter == timeOffsets.end())
+      return llvm::None;
+    int64_t const time = startIter->second + startTime.getOffset();
+    int64_t end = time;
+
+    if (auto forOp = dyn_cast<hir::ForOp>(operation)) {
+      // The body is estimated once. The last iteration starts
+      // (tripCount - 1) * II cycles after the first one.
+      Block &body = forOp.getLoopBody().front();
+      llvm::DenseMap<Value, int64_t> bodyOffsets;
+      bodyOffsets[forOp.getIterTimeVar()] = 0;
+      auto bodyLatency = estimateLatency(body, bodyOffsets);
+      auto nextIterOp = cast<hir::NextIterOp>(body.getTerminator());
+      auto iiIter = bodyOffsets.find(nextIterOp.tstart());
+      auto tripCount = forOp.getTripCount();
+      if (!bodyLatency || !tripCount || iiIter == bodyOffsets.end())
+        return llvm::None;
+      int64_t const ii = iiIter->second + nextIterOp.offset();
+      end = time + (*tripCount - 1) * ii + std::max(*bodyLatency, ii);
+      timeOffsets[forOp.t_end()] = time + *tripCount * ii;
+    } else if (auto storeOp = dyn_cast<hir::StoreOp>(operation)) {
+      end = time + storeOp.delay();
+    } else {
+      for (auto resultWithTime : scheduledOp.getResultsWithTime()) {
+        auto resultTime = resultWithTime.second;
+        if (!resultTime)
+          continue;
+        auto resultIter = timeOffsets.find(resultTime->getTimeVar());
+        if (resultIter == timeOffsets.end())
+          continue;
+        int64_t const offset = resultIter->second + resultTime->getOffset();
+        end = std::max(end, offset);
+        if (resultWithTime.first.getType().isa<hir::TimeType>())
+          timeOffsets[resultWithTime.first] = offset;
+      }
+    }
+    latency = std::max(latency, end);
+  }
+  return latency;
+}
+
+/// Bits of logic, registers and memory. Loop bodies are counted once, since
+/// all the iterations share the same hardware.
+static void estimateResources(hir::FuncOp funcOp, Estimate &estimate) {
+  funcOp.walk([&estimate](Operation *operation) {
+    if (isa_and_nonnull<comb::CombDialect>(operation->getDialect())) {
+      for (auto result : operation->getResults())
+        estimate.combBits += helper::getBitWidth(result.getType()).value_or(0);
+    } else if (auto delayOp = dyn_cast<hir::DelayOp>(operation)) {
+      estimate.regBits +=
+          helper::getBitWidth(delayOp.getType()).value_or(0) * delayOp.delay();
+    } else if (auto allocaOp = dyn_cast<hir::AllocaOp>(operation)) {
+      auto memrefTy = allocaOp.getType().cast<hir::MemrefType>();
+      int64_t const bits =
+          memrefTy.getNumBanks() * memrefTy.getNumElementsPerBank() *
+          helper::getBitWidth(memrefTy.getElementType()).value_or(0);
+      if (allocaOp.mem_kind() == hir::MemKindEnum::reg)
+        estimate.regBits += bits;
+      else
+        estimate.memBits += bits;
+    } else if (isa<hir::CallOp>(operation)) {
+      estimate.instances++;
+    }
+  });
+}
+
+static Estimate estimate(ModuleOp moduleOp, StringRef funcName) {
+  Estimate estimate;
+  moduleOp.walk([&](hir::FuncOp funcOp) {
+    estimateResources(funcOp, estimate);
+    if (funcOp.sym_name() != funcName)
+      return;
+    llvm::DenseMap<Value, int64_t> timeOffsets;
+    timeOffsets[funcOp.getRegionTimeVar()] = 0;
+    estimate.latency =
+        estimateLatency(funcOp.getFuncBody().front(), timeOffsets);
+  });
+  return estimate;
+}
+
+//-----------------------------------------------------------------------------
+// DesignSpaceExplorer methods.
+//-----------------------------------------------------------------------------
+
+std::string DesignSpaceExplorer::getSchedulePipeline() {
+  std::string pipeline = "hir-pragma{function=" + options.topLevelFuncName;
+  if (!options.operatorLibrary.empty())
+    pipeline += " operator-library=" + options.operatorLibrary;
+  return pipeline + "},affine-to-hir,hir-opt";
+}
+
+bool DesignSpaceExplorer::isDominated(const Estimate &estimate) {
+  std::lock_guard<std::mutex> const lock(frontMutex);
+  return llvm::any_of(front, [&estimate](Candidate *candidate) {
+    return candidate->estimate.dominates(estimate);
+  });
+}
+
+/// Candidates that leave the front are marked Pruned as well, so in the end
+/// the Compiled ones are exactly the front, whatever order the threads
+/// finished in.
+void DesignSpaceExplorer::addToFront(Candidate &candidate) {
+  std::lock_guard<std::mutex> const lock(frontMutex);
+  if (llvm::any_of(front, [&candidate](Candidate *other) {
+        return other->estimate.dominates(candidate.estimate);
+      })) {
+    candidate.status = Candidate::Pruned;
+    return;
+  }
+  llvm::erase_if(front, [&candidate](Candidate *other) {
+    if (!candidate.estimate.dominates(other->estimate))
+      return false;
+    other->status = Candidate::Pruned;
+    return true;
+  });
+  front.push_back(&candidate);
+}
+
+void DesignSpaceExplorer::compile(Candidate &candidate) {
+  MLIRContext context(registry, MLIRContext::Threading::DISABLED);
+  context.allowUnregisteredDialects();
+  ScopedDiagnosticHandler const diagHandler(
+      &context, [&candidate](Diagnostic &diag) {
+        if (diag.getSeverity() == DiagnosticSeverity::Error &&
+            candidate.error.empty())
+          candidate.error = diag.str();
+        return success();
+      });
+  std::string pipelineError;
+  llvm::raw_string_ostream errorStream(pipelineError);
+  auto runPipeline = [&](StringRef pipeline, ModuleOp moduleOp) {
+    PassManager pm(&context);
+    if (succeeded(parsePassPipeline(pipeline, pm, errorStream)) &&
+        succeeded(pm.run(moduleOp)))
+      return success();
+    if (candidate.error.empty())
+      candidate.error = errorStream.str();
+    candidate.status = Candidate::Failed;
+    return failure();
+  };
+
+  auto moduleOp = parseSourceString<ModuleOp>(input, &context);
+  if (!moduleOp || failed(applyConfig(*moduleOp, knobs, candidate.config,
+                                      options.topLevelFuncName))) {
+    candidate.status = Candidate::Failed;
+    return;
+  }
+
+  // The estimates are taken on the scheduled HIR, where the loops are still
+  // structured.
+  if (failed(runPipeline(getSchedulePipeline(), *moduleOp)))
+    return;
+  candidate.estimate = estimate(*moduleOp, options.topLevelFuncName);
+  if (isDominated(candidate.estimate)) {
+    candidate.status = Candidate::Pruned;
+    return;
+  }
+
+  if (failed(runPipeline("hir-simplify", *moduleOp)))
+    return;
+  candidate.status = Candidate::Compiled;
+  addToFront(candidate);
+}
+
+void DesignSpaceExplorer::run() {
+  // Enumerate the configurations as a mixed-radix counter over the knobs.
+  size_t numCandidates = 1;
+  for (auto &knob : knobs)
+    numCandidates *= knob.values.size();
+  candidates.resize(numCandidates);
+  for (size_t n = 0; n < numCandidates; n++) {
+    size_t rest = n;
+    for (auto &knob : knobs) {
+      candidates[n].config.push_back(knob.values[rest % knob.values.size()]);
+      rest /= knob.values.size();
+    }
+  }
+
+  llvm::ThreadPool threadPool(llvm::hardware_concurrency(options.numThreads));
+  for (auto &candidate : candidates)
+    threadPool.async([this, &candidate] { compile(candidate); });
+  threadPool.wait();
+}
+
+void DesignSpaceExplorer::printResults(raw_ostream &os) {
+  llvm::sort(front, [](Candidate *a, Candidate *b) {
+    return a->estimate.getCosts() < b->estimate.getCosts();
+  });
+  int64_t numCompiled = 0;
+  int64_t numPruned = 0;
+  int64_t numFailed = 0;
+  for (auto &candidate : candidates) {
+    if (candidate.status == Candidate::Compiled)
+      numCompiled++;
+    else if (candidate.status == Candidate::Pruned)
+      numPruned++;
+    else if (candidate.status == Candidate::Failed)
+      numFailed++;
+  }
+
+  llvm::json::OStream json(os, 2);
+  auto printConfig = [&](Candidate &candidate) {
+    json.attributeObject("config", [&] {
+      for (size_t i = 0; i < knobs.size(); i++) {
+        if (knobs[i].kind == Knob::Partition)
+          json.attribute(knobs[i].getName(), candidate.config[i] != 0);
+        else
+          json.attribute(knobs[i].getName(), candidate.config[i]);
+      }
+    });
+  };
+  json.object([&] {
+    json.attribute("candidates", (int64_t)candidates.size());
+    json.attribute("compiled", numCompiled);
+    json.attribute("pruned", numPruned);
+    json.attribute("failed", numFailed);
+    json.attributeArray("pareto", [&] {
+      for (auto *candidate : front) {
+        auto &estimate = candidate->estimate;
+        json.object([&] {
+          printConfig(*candidate);
+          if (estimate.latency)
+            json.attribute("latency", *estimate.latency);
+          else
+            json.attribute("latency", nullptr);
+          json.attribute("comb_bits", estimate.combBits);
+          json.attribute("reg_bits", estimate.regBits);
+          json.attribute("mem_bits", estimate.memBits);
+          json.attribute("instances", estimate.instances);
+        });
+      }
+    });
+    json.attributeArray("failures", [&] {
+      for (auto &candidate : candidates) {
+        if (candidate.status != Candidate::Failed)
+          continue;
+        json.object([&] {
+          printConfig(candidate);
+          json.attribute("error", candidate.error);
+        });
+      }
+    });
+  });
+  os << "\n";
+}
+
+LogicalResult circt::hir::runDesignSpaceExploration(
+    StringRef input, StringRef searchSpace, const DSEOptions &options,
+    const DialectRegistry &registry, raw_ostream &os) {
+  if (options.topLevelFuncName.empty())
+    return llvm::errs() << "Design space exploration needs a top level "
+                           "function (-dse-function).\n",
+           failure();
+  SmallVector<Knob> knobs;
+  if (failed(parseSearchSpace(searchSpace, knobs)))
+    return failure();
+
+  DesignSpaceExplorer explorer(input, options, registry, knobs);
+  explorer.run();
+  explorer.printResults(os);
+  return success();
+}
@@ -0,0 +1,53 @@
+//===- DesignSpaceExploration.h ---------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the design-space exploration mode of hirtool. It compiles
+// an affine input under many pragma configurations and reports the
+// configurations that are Pareto-optimal in latency and resources.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_HIRTOOL_DESIGNSPACEEXPLORATION_H
+#define CIRCT_HIRTOOL_DESIGNSPACEEXPLORATION_H
+
+#include "mlir/IR/DialectRegistry.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+
+namespace circt {
+namespace hir {
+
+struct DSEOptions {
+  /// The function that is compiled to hardware (see -hir-pragma).
+  std::string topLevelFuncName;
+  /// Optional json operator library (see -hir-pragma).
+  std::string operatorLibrary;
+  /// Number of candidates compiled concurrently. Zero uses all cores.
+  unsigned numThreads = 0;
+};
+
+/// Compile `input` under every configuration of the pragma search space and
+/// print the Pareto front as json. The search space is a json file of the
+/// form:
+///   {"loops":   [{"loop": 0, "ii": [1, 2], "unroll": [1, 2, 4]}],
+///    "memrefs": [{"alloca": 0, "partition": [false, true]}]}
+/// where loops and allocas are numbered in pre-order within the top level
+/// function.
+mlir::LogicalResult
+runDesignSpaceExploration(llvm::StringRef input, llvm::StringRef searchSpace,
+                          const DSEOptions &options,
+                          const mlir::DialectRegistry &registry,
+                          llvm::raw_ostream &os);
+
+} // namespace hir
+} // namespace circt
+
+#endif // CIRCT_HIRTOOL_DESIGNSPACEEXPLORATION_H
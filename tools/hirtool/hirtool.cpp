@@ -11,6 +11,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "DesignSpaceExploration.h"
+#include "circt/Conversion/Passes.h"
 #include "circt/Dialect/Comb/CombDialect.h"
 #include "circt/Dialect/HIR/IR/HIRDialect.h"
 #include "circt/Dialect/HIR/Transforms/Passes.h"
@@ -74,6 +76,26 @@ LogicalResult hirOptMain(int argc, char **argv, llvm::StringRef toolName,
       "show-dialects", cl::desc("Print the list of registered dialects"),
       cl::init(false));
 
+  static cl::opt<std::string> const dseSpaceFilename(
+      "dse-space",
+      cl::desc("Explore the pragma search space in this json file and print "
+               "the Pareto-optimal configurations"),
+      cl::value_desc("filename"), cl::init(""));
+
+  static cl::opt<std::string> const dseFunction(
+      "dse-function", cl::desc("Top level function for -dse-space"),
+      cl::init(""));
+
+  static cl::opt<std::string> const dseOperatorLibrary(
+      "dse-operator-library",
+      cl::desc("Json operator library for -dse-space (see -hir-pragma)"),
+      cl::value_desc("filename"), cl::init(""));
+
+  static cl::opt<unsigned> const dseJobs(
+      "dse-jobs",
+      cl::desc("Number of configurations compiled in parallel (0 = all cores)"),
+      cl::init(0));
+
   InitLLVM const y(argc, argv);
 
   // Register any command line options.
@@ -116,6 +138,24 @@ LogicalResult hirOptMain(int argc, char **argv, llvm::StringRef toolName,
     return failure();
   }
 
+  if (!dseSpaceFilename.empty()) {
+    auto searchSpace = openInputFile(dseSpaceFilename, &errorMessage);
+    if (!searchSpace) {
+      llvm::errs() << errorMessage << "\n";
+      return failure();
+    }
+    circt::hir::DSEOptions options;
+    options.topLevelFuncName = dseFunction;
+    options.operatorLibrary = dseOperatorLibrary;
+    options.numThreads = dseJobs;
+    if (failed(circt::hir::runDesignSpaceExploration(
+            file->getBuffer(), searchSpace->getBuffer(), options, registry,
+            output->os())))
+      return failure();
+    output->keep();
+    return success();
+  }
+
   if (failed(MlirOptMain(output->os(), std::move(file), passPipeline, registry,
                          /*splitInputFile*/ false, verifyDiagnostics,
                          verifyPasses,
@@ -144,6 +184,8 @@ int main(int argc, char **argv) {
   registry.insert<circt::sv::SVDialect>();
 
   circt::hir::initHIRTransformationPasses();
+  circt::registerHIRPragmaPass();
+  circt::registerAffineToHIRPass();
 
   // Register the standard passes we want.
   mlir::registerCSEPass();
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+##===- utils/hir-vcd-profile.py - Profile from a VCD dump ----*- Script -*-===##
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+##===----------------------------------------------------------------------===##
+#
+# This script writes the json profile read by hir-annotate-profile from a VCD
+# dump of a simulation of a design instrumented with hir-instrument-profile.
+#
+# Each profiled hir.while has a `<name>_start` and a `<name>_iter` probe wire,
+# which are one cycle pulses. They are sampled on the rising edges of the clock
+# of their scope. An execution of the loop begins at a start pulse and its trip
+# count is the number of iter pulses until the next start of the loop in the
+# same scope, or until the end of the dump. The profile has the form
+#   {"loops": {"<name>": {"<trip count>": <number of executions>, ...}}}
+#
+# Usage hir-vcd-profile.py dump.vcd [--clock clk] [-o profile.json]
+#
+##===----------------------------------------------------------------------===##
+import argparse
+import collections
+import json
+import sys
+
+
+def parse_vcd(f, clock):
+  """Returns, for each scope, the clock id and the probe ids by loop name, and
+  the list of (time, [(id, value)]) value changes."""
+  scope = []
+  clocks = {}
+  probes = collections.defaultdict(dict)
+  tokens = iter(f.read().split())
+  for token in tokens:
+    if token == "$enddefinitions":
+      break
+    if token == "$scope":
+      next(tokens)
+      scope.append(next(tokens))
+    elif token == "$upscope":
+      scope.pop()
+    elif token == "$var":
+      next(tokens)
+      next(tokens)
+      id = next(tokens)
+      name = next(tokens)
+      path = ".".join(scope)
+      if name == clock:
+        clocks[path] = id
+      elif name.endswith("_start") or name.endswith("_iter"):
+        probes[path][name] = id
+
+  # Initial values may be dumped before the first timestamp.
+  changes = [(0, [])]
+  for token in tokens:
+    if token.startswith("#"):
+      changes.append((int(token[1:]), []))
+    elif token.startswith("$"):
+      continue
+    elif token[0] in "bBrR":
+      changes[-1][1].append((next(tokens), token[1:]))
+    else:
+      changes[-1][1].append((token[1:], token[0]))
+  return clocks, probes, changes
+
+
+def get_loops(probes):
+  """Returns the (name, start id, iter id) of each loop that has both
+  probes."""
+  loops = []
+  for name, start in probes.items():
+    if not name.endswith("_start"):
+      continue
+    loop = name[:-len("_start")]
+    iter = probes.get(loop + "_iter")
+    if iter is not None:
+      loops.append((loop, start, iter))
+  return loops
+
+
+def profile(f, clock):
+  clocks, probes, changes = parse_vcd(f, clock)
+  loops = {
+      path: get_loops(probes[path]) for path in clocks if path in probes
+  }
+  histograms = collections.defaultdict(collections.Counter)
+  trip_counts = {}
+  values = {}
+
+  def is_set(id):
+    return values.get(id, "0").lstrip("0") not in ("", "x", "z")
+
+  def close(path, loop):
+    count = trip_counts.pop((path, loop), None)
+    if count is not None:
+      histograms[loop][count] += 1
+
+  for _, block in changes:
+    new_values = dict(block)
+    for path, clock_id in clocks.items():
+      # The probes are sampled with the values they had before the edge.
+      if new_values.get(clock_id) != "1" or values.get(clock_id) != "0":
+        continue
+      for loop, start, iter in loops.get(path, []):
+        if is_set(start):
+          close(path, loop)
+          trip_counts[(path, loop)] = 0
+        if is_set(iter) and (path, loop) in trip_counts:
+          trip_counts[(path, loop)] += 1
+    values.update(new_values)
+
+  for path, loop in list(trip_counts):
+    close(path, loop)
+  return {
+      "loops": {
+          loop: {str(count): n for count, n in sorted(histogram.items())
+                } for loop, histogram in sorted(histograms.items())
+      }
+  }
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description="Write an hir-annotate-profile profile from a VCD dump.")
+  parser.add_argument("vcd", help="VCD dump of the instrumented design.")
+  parser.add_argument("--clock", default="clk", help="Name of the clock.")
+  parser.add_argument("-o", "--output", help="Output json file.")
+  args = parser.parse_args()
+  with open(args.vcd) as f:
+    result = profile(f, args.clock)
+  if args.output:
+    with open(args.output, "w") as f:
+      json.dump(result, f, indent=2)
+  else:
+    json.dump(result, sys.stdout, indent=2)
+    print()
+
+
+if __name__ == "__main__":
+  main()